@@ -0,0 +1,82 @@
+#!/bin/sh
+# Runs the bench scenarios on a hostile host and counts wrong outcomes.
+#
+# Usage: bench/chaos_harness.sh [path/to/philo_chaos]   (or: make chaos)
+#
+# Every scenario of SCENARIOS (default bench/scenarios.txt) runs RUNS
+# times (default 5) under each of CONDITIONS:
+#   idle    nothing else running
+#   cpu     tools/chaos_load --cpu=HOGS (default: one per CPU)
+#   mem     tools/chaos_load --mem=MEM_MB (default 512), pages churned
+#   inject  PHILO_CHAOS=$INJECT in the philo build with injection points
+#   all     cpu + mem + inject
+# A false death is a "live" scenario that printed "died", a missed death
+# a "die" scenario that did not. Detection latency is death_latency_us
+# from --stats (death printed minus deadline), shown as p50/p90/max over
+# the runs that had a death. yields/sleeps are the injections per run.
+
+PHILO=${1:-./philo_chaos}
+LOAD=${LOAD:-tools/chaos_load}
+RUNS=${RUNS:-5}
+SCENARIOS=${SCENARIOS:-bench/scenarios.txt}
+CONDITIONS=${CONDITIONS:-"idle cpu mem inject all"}
+HOGS=${HOGS:-$(getconf _NPROCESSORS_ONLN)}
+MEM_MB=${MEM_MB:-512}
+INJECT=${INJECT:-"yield=0.05,sleep=0.02,max=2ms,seed=42"}
+TMP=${TMPDIR:-/tmp}/philo_chaos.$$
+[ -x "$PHILO" ] || { echo "chaos_harness: $PHILO not found" >&2; exit 2; }
+[ -x "$LOAD" ] || { echo "chaos_harness: $LOAD not found" >&2; exit 2; }
+mkdir -p "$TMP" || exit 2
+LOADPID=""
+stop_load() {
+	[ -n "$LOADPID" ] && kill "$LOADPID" 2>/dev/null && wait "$LOADPID"
+	LOADPID=""
+}
+trap 'stop_load; rm -rf "$TMP"' EXIT INT TERM
+
+printf "%-14s %-7s %-5s %7s %7s %8s %8s %8s %8s %8s\n" scenario cond \
+	want false missed lat_p50 lat_p90 lat_max yields sleeps
+for cond in $CONDITIONS; do
+	spec=""
+	case $cond in
+	idle) ;;
+	cpu) "$LOAD" --cpu="$HOGS" 2>/dev/null & LOADPID=$! ;;
+	mem) "$LOAD" --mem="$MEM_MB" 2>/dev/null & LOADPID=$! ;;
+	inject) spec=$INJECT ;;
+	all) "$LOAD" --cpu="$HOGS" --mem="$MEM_MB" 2>/dev/null & LOADPID=$!
+		spec=$INJECT ;;
+	*) echo "chaos_harness: unknown condition $cond" >&2; exit 2 ;;
+	esac
+	grep -v '^#' "$SCENARIOS" | while read -r name want args; do
+		[ -n "$name" ] || continue
+		i=0; died=0; : > "$TMP/stats"
+		while [ $i -lt "$RUNS" ]; do
+			# shellcheck disable=SC2086
+			PHILO_CHAOS=$spec "$PHILO" --stats $args > "$TMP/out" \
+				2> "$TMP/err"
+			grep -q died "$TMP/out" && died=$((died + 1))
+			cat "$TMP/err" >> "$TMP/stats"
+			i=$((i + 1))
+		done
+		awk -F= -v n="$name" -v c="$cond" -v w="$want" -v d="$died" \
+			-v r="$RUNS" '
+		function pct(a, k, p,    i, j, x) {
+			if (k == 0) return "-"
+			for (i = 1; i <= k; i++) for (j = i + 1; j <= k; j++)
+				if (a[j] < a[i]) { x = a[i]; a[i] = a[j]; a[j] = x }
+			return a[int((k - 1) * p + 0.5) + 1]
+		}
+		$1 == "death_latency_us" && $2 >= 0 { lat[++nl] = $2 }
+		$1 == "chaos_yields" { y += $2 }
+		$1 == "chaos_sleeps" { s += $2 }
+		END {
+			f = (w == "live") ? d : 0
+			m = (w == "die") ? r - d : 0
+			printf "%-14s %-7s %-5s %4d/%-2d %4d/%-2d %8s %8s %8s %8d %8d\n",
+				n, c, w, f, r, m, r, pct(lat, nl, 0.5), pct(lat, nl, 0.9),
+				pct(lat, nl, 1), y / r, s / r
+		}' "$TMP/stats"
+	done
+	stop_load
+done
+exit 0
@@ -0,0 +1,40 @@
+#!/bin/sh
+# Cost per call and drift of the clocks behind every timestamp.
+#
+# Usage: bench/clock_bench.sh [path/to/philo]   (or: make bench-clock)
+#
+# Runs --clock-bench once per --clock mode in MODES (default "tsc vdso"),
+# with a drift test of DURATION seconds (default 3600, one hour) each,
+# and prints their key=value results side by side. drift_max_us is the
+# largest gap between the clock and CLOCK_MONOTONIC; tsc_free_drift_*
+# is what the TSC alone, without the periodic resync, would have drifted
+# by the end.
+
+PHILO=${1:-./philo}
+DURATION=${DURATION:-3600}
+MODES=${MODES:-"tsc vdso"}
+TMP=${TMPDIR:-/tmp}/philo_clock.$$
+[ -x "$PHILO" ] || { echo "clock_bench: $PHILO not found" >&2; exit 2; }
+mkdir -p "$TMP" || exit 2
+trap 'rm -rf "$TMP"' EXIT INT TERM
+
+for mode in $MODES; do
+	"$PHILO" --clock=$mode --clock-bench="$DURATION" > "$TMP/$mode" || exit 1
+done
+# shellcheck disable=SC2086
+awk -F= '
+	FNR == 1 { col++; name[col] = FILENAME; sub(/.*\//, "", name[col]) }
+	!($1 in row) { row[$1] = ++nrow; key[nrow] = $1 }
+	{ val[row[$1], col] = $2 }
+	END {
+		printf "%-32s", "requested"
+		for (c = 1; c <= col; c++) printf " %12s", name[c]
+		printf "\n"
+		for (r = 1; r <= nrow; r++) {
+			printf "%-32s", key[r]
+			for (c = 1; c <= col; c++)
+				printf " %12s", ((r, c) in val) ? val[r, c] : "-"
+			printf "\n"
+		}
+	}' $(for mode in $MODES; do echo "$TMP/$mode"; done)
+exit 0
@@ -0,0 +1,51 @@
+#!/bin/sh
+# Compares death detection by the monitor thread with self-detection.
+#
+# Usage: bench/detect_bench.sh [path/to/philo]   (or: make bench-detect)
+#
+# Runs each TABLE RUNS times (default 10) with --detect=monitor and
+# --detect=self, with both phase timers. The default tables die waiting
+# for a fork, in the middle of a sleep phase, alone with one fork, and
+# with 200 philosophers. Latency is death_latency_us from --stats (death
+# printed minus deadline), shown as p50/p90/max over the runs;
+# cpu_us is the CPU time of all pool threads per run (median).
+
+PHILO=${1:-./philo}
+RUNS=${RUNS:-10}
+TABLES=${TABLES:-"4 310 200 100|5 300 100 250|1 800 200 200|200 390 200 200"}
+TMP=${TMPDIR:-/tmp}/philo_detect.$$
+[ -x "$PHILO" ] || { echo "detect_bench: $PHILO not found" >&2; exit 2; }
+mkdir -p "$TMP" || exit 2
+trap 'rm -rf "$TMP"' EXIT INT TERM
+
+printf "%-18s %-6s %-8s %6s %8s %8s %8s %8s\n" table timer detect deaths \
+	lat_p50 lat_p90 lat_max cpu_us
+echo "$TABLES" | tr '|' '\n' | while read -r table; do
+	for timer in wheel sleep; do
+		for detect in monitor self; do
+			i=0; : > "$TMP/stats"
+			while [ $i -lt "$RUNS" ]; do
+				# shellcheck disable=SC2086
+				"$PHILO" --stats --timer=$timer --detect=$detect $table \
+					> /dev/null 2>> "$TMP/stats"
+				i=$((i + 1))
+			done
+			awk -F= -v t="$table" -v tm=$timer -v d=$detect -v r="$RUNS" '
+			function sort(a, n,    i, j, x) {
+				for (i = 1; i <= n; i++) for (j = i + 1; j <= n; j++)
+					if (a[j] < a[i]) { x = a[i]; a[i] = a[j]; a[j] = x }
+			}
+			$1 == "death_latency_us" && $2 >= 0 { lat[++nl] = $2 }
+			$1 == "philo_cpu_us" { cpu[++nc] = $2 }
+			$1 == "monitor_cpu_us" || $1 == "timer_cpu_us" { cpu[nc] += $2 }
+			END {
+				sort(lat, nl); sort(cpu, nc)
+				printf "%-18s %-6s %-8s %3d/%-2d %8s %8s %8s %8d\n", t, tm, d,
+					nl, r, nl ? lat[int((nl - 1) * 0.5 + 0.5) + 1] : "-",
+					nl ? lat[int((nl - 1) * 0.9 + 0.5) + 1] : "-",
+					nl ? lat[nl] : "-", cpu[int((nc + 1) / 2)]
+			}' "$TMP/stats"
+		done
+	done
+done
+exit 0
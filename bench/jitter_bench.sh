@@ -0,0 +1,69 @@
+#!/bin/sh
+# Compares eat-phase overshoot with and without --realtime.
+#
+# Usage: bench/jitter_bench.sh [path/to/philo]
+#
+# Runs each TABLE RUNS times (default 3) in both modes, alone and next to
+# LOAD busy loops (default: one per CPU) standing in for the other tenants
+# of a shared host. Overshoot is how much longer than time_to_eat a meal
+# took (eat_overshoot_* in --stats, 10 us resolution); the table shows the
+# median over the runs of p50, p99 and p99.9, and deaths.
+# Without root, --realtime only gets what the limits allow; its warnings
+# are listed once at the end.
+
+PHILO=${1:-./philo}
+RUNS=${RUNS:-3}
+LOAD=${LOAD:-$(getconf _NPROCESSORS_ONLN)}
+TABLES=${TABLES:-"200 410 200 200 10|4 410 200 200 30"}
+TMP=${TMPDIR:-/tmp}/philo_jitter.$$
+[ -x "$PHILO" ] || { echo "jitter_bench: $PHILO not found" >&2; exit 2; }
+mkdir -p "$TMP" || exit 2
+HOGS=""
+stop_hogs() {
+	[ -n "$HOGS" ] && kill $HOGS 2>/dev/null
+	HOGS=""
+}
+trap 'stop_hogs; rm -rf "$TMP"' EXIT INT TERM
+
+printf "%-20s %-5s %-9s %7s %8s %8s %9s\n" table load mode deaths \
+	p50_us p99_us p999_us
+for load in 0 "$LOAD"; do
+	i=0
+	while [ $i -lt "$load" ]; do
+		sh -c 'while :; do :; done' &
+		HOGS="$HOGS $!"
+		i=$((i + 1))
+	done
+	echo "$TABLES" | tr '|' '\n' | while read -r table; do
+		for mode in default realtime; do
+			flag=""
+			[ $mode = realtime ] && flag=--realtime
+			i=0; deaths=0; : > "$TMP/stats"
+			while [ $i -lt "$RUNS" ]; do
+				# shellcheck disable=SC2086
+				"$PHILO" --stats $flag $table > "$TMP/out" 2> "$TMP/err"
+				grep -q died "$TMP/out" && deaths=$((deaths + 1))
+				grep '^Warning' "$TMP/err" >> "$TMP/warnings"
+				cat "$TMP/err" >> "$TMP/stats"
+				i=$((i + 1))
+			done
+			awk -F= -v t="$table" -v l="$load" -v m=$mode -v d="$deaths" \
+				-v r="$RUNS" '
+			function median(a, n,    i, j, x) {
+				for (i = 1; i <= n; i++) for (j = i + 1; j <= n; j++)
+					if (a[j] < a[i]) { x = a[i]; a[i] = a[j]; a[j] = x }
+				return a[int((n + 1) / 2)]
+			}
+			$1 == "eat_overshoot_p50_us" { a[++na] = $2 }
+			$1 == "eat_overshoot_p99_us" { b[++nb] = $2 }
+			$1 == "eat_overshoot_p999_us" { c[++nc] = $2 }
+			END {
+				printf "%-20s %-5s %-9s %4d/%-2d %8d %8d %9d\n", t, l, m, d, r,
+					median(a, na), median(b, nb), median(c, nc)
+			}' "$TMP/stats"
+		done
+	done
+	stop_hogs
+done
+[ -s "$TMP/warnings" ] && sort -u "$TMP/warnings" >&2
+exit 0
@@ -0,0 +1,56 @@
+#!/bin/sh
+# Compares fork handoff between processes (--procs) with the in-process
+# designs: one thread per philosopher on mutexes, and --shards.
+#
+# Usage: bench/procs_bench.sh [path/to/philo]   (or: make bench-procs)
+#
+# Runs "N DIE EAT SLEEP MEALS" for each N in SIZES (default 200 and 10k)
+# with threads, --shards=P and --procs=P (P default 4), RUNS times each
+# (default 3), output to /dev/null through --sink=write. Reports the
+# median meals_per_sec and philo_cpu_us per meal, the median handoff
+# latency of a boundary fork (futex wake-up for --shards, socket message
+# for --procs; threads hand forks over inside pthread mutexes and report
+# "-"), and how many runs ended without a death.
+
+PHILO=${1:-./philo}
+RUNS=${RUNS:-3}
+SIZES=${SIZES:-"200 10000"}
+TIMES=${TIMES:-"800 200 200 5"}
+PROCS=${PROCS:-4}
+TMP=${TMPDIR:-/tmp}/philo_procs.$$
+[ -x "$PHILO" ] || { echo "procs_bench: $PHILO not found" >&2; exit 2; }
+mkdir -p "$TMP" || exit 2
+trap 'rm -rf "$TMP"' EXIT INT TERM
+
+printf "%-8s %-8s %8s %14s %12s %12s %12s\n" philos mode alive \
+	meals_per_sec cpu_us/meal handoff_us handoff_max
+for n in $SIZES; do
+	for mode in threads shards procs; do
+		opt=""
+		[ "$mode" != threads ] && opt="--$mode=$PROCS"
+		i=0; : > "$TMP/stats"
+		while [ $i -lt "$RUNS" ]; do
+			# shellcheck disable=SC2086
+			"$PHILO" --stats --sink=write --max-philos=$n $opt $n $TIMES \
+				> /dev/null 2>> "$TMP/stats" || echo "failed=1" >> "$TMP/stats"
+			i=$((i + 1))
+		done
+		awk -F= -v n="$n" -v m="$mode" -v r="$RUNS" '
+		function sort(a, k,    i, j, x) {
+			for (i = 1; i <= k; i++) for (j = i + 1; j <= k; j++)
+				if (a[j] < a[i]) { x = a[i]; a[i] = a[j]; a[j] = x }
+		}
+		function med(a, k) { sort(a, k); return k ? a[int((k + 1) / 2)] : "-" }
+		$1 == "meals_per_sec" { mps[++nm] = $2 }
+		$1 == "philo_cpu_us_per_meal" { cpu[++nc] = $2 }
+		$1 == "fork_handoff_us_mean" { hm[++nh] = $2 }
+		$1 == "fork_handoff_us_max" { hx[++nx] = $2 }
+		$1 == "death_latency_us" && $2 < 0 { alive++ }
+		END {
+			printf "%-8s %-8s %5d/%-2d %14s %12s %12s %12s\n", n, m,
+				alive, r, med(mps, nm), med(cpu, nc), med(hm, nh),
+				med(hx, nx)
+		}' "$TMP/stats"
+	done
+done
+exit 0
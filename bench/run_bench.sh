@@ -0,0 +1,166 @@
+#!/bin/sh
+# Runs the scenarios in bench/scenarios.txt and compares the results with
+# bench/baselines.txt.
+#
+# Usage: bench/run_bench.sh [--update] [--runs=N] [path/to/philo]
+#
+# Each scenario runs N times (default 3) with --stats; the median of every
+# metric is kept. Metrics:
+#   wall_ms        wall-clock time of the run
+#   cpu_ms         user + system CPU time
+#   ctx_switches   voluntary + involuntary context switches
+#   meals_per_sec  meals eaten per wall-clock second (higher is better)
+#   detect_us      death detection latency past the deadline (die scenarios)
+#   jitter_ms      worst eat-phase overshoot: "is sleeping" - "is eating"
+#                  - time_to_eat, taken from the printed timestamps
+#   us_per_meal    CPU time of the philosopher, monitor and timer threads
+#                  per meal (0 without meals)
+#   wake_per_meal  their voluntary switches (wake-ups) per meal
+# A metric regresses when it is worse than its baseline by more than both
+# the relative tolerance and the absolute slack stored next to it.
+# An unexpected outcome (death in a "live" scenario or the reverse) is
+# always a failure. --update rewrites the baselines from this run.
+# The scenario file is validated first (philo --check-scenarios).
+
+BENCH_DIR=$(dirname "$0")
+SCENARIOS="$BENCH_DIR/scenarios.txt"
+BASELINES="$BENCH_DIR/baselines.txt"
+PHILO=./philo
+RUNS=3
+UPDATE=0
+TMP=${TMPDIR:-/tmp}/philo_bench.$$
+
+for arg in "$@"; do
+	case "$arg" in
+		--update) UPDATE=1 ;;
+		--runs=*) RUNS=${arg#--runs=} ;;
+		*) PHILO=$arg ;;
+	esac
+done
+[ -x "$PHILO" ] || { echo "bench: $PHILO not found, run make first" >&2; exit 2; }
+mkdir -p "$TMP" || exit 2
+trap 'rm -rf "$TMP"' EXIT INT TERM
+"$PHILO" --check-scenarios="$SCENARIOS" > "$TMP/check" \
+	|| { cat "$TMP/check" >&2; exit 2; }
+
+# Extracts one run's metrics from the --stats output ($1) and the simulation
+# output ($2). $3 is time_to_eat in ms. Prints "metric value" lines.
+collect() {
+	awk -v eat="$3" -v out="$2" '
+	BEGIN { FS = "=" }
+	{ s[$1] = $2 }
+	END {
+		print "wall_ms", s["wall_us"] / 1000
+		print "cpu_ms", (s["cpu_user_us"] + s["cpu_sys_us"]) / 1000
+		print "ctx_switches", s["voluntary_ctx_switches"] + s["involuntary_ctx_switches"]
+		print "meals_per_sec", s["meals_per_sec"] + 0
+		print "detect_us", (s["death_latency_us"] < 0) ? 0 : s["death_latency_us"]
+		m = s["meals"] + 0
+		print "us_per_meal", m ? (s["philo_cpu_us"] + s["monitor_cpu_us"] \
+			+ s["timer_cpu_us"]) / m : 0
+		print "wake_per_meal", m ? (s["philo_voluntary_switches"] \
+			+ s["monitor_voluntary_switches"] \
+			+ s["timer_voluntary_switches"]) / m : 0
+		FS = " "; jitter = 0; died = 0
+		while ((getline line < out) > 0) {
+			n = split(line, f, " ")
+			if (f[3] == "is" && f[4] == "eating") start[f[2]] = f[1]
+			else if (f[3] == "is" && f[4] == "sleeping" && (f[2] in start)) {
+				d = f[1] - start[f[2]] - eat
+				if (d < 0) d = -d
+				if (d > jitter) jitter = d
+			}
+			else if (f[3] == "died") died = 1
+		}
+		print "jitter_ms", jitter
+		print "outcome", died ? "die" : "live"
+	}' "$1"
+}
+
+# Time to eat is the third positional (non --option) argument.
+time_to_eat() {
+	n=0
+	for a in "$@"; do
+		case "$a" in --*) continue ;; esac
+		n=$((n + 1))
+		[ $n -eq 3 ] && { echo "$a"; return; }
+	done
+}
+
+status=0
+[ $UPDATE -eq 1 ] && {
+	echo "# scenario metric baseline tolerance_pct abs_slack" > "$TMP/new_baselines"
+}
+printf "%-14s %-6s %10s %10s %8s %12s %10s %9s %8s %8s\n" scenario result \
+	wall_ms cpu_ms ctx meals/sec detect_us jitter_ms us/meal wake/meal
+grep -v '^#' "$SCENARIOS" | grep -v '^[[:space:]]*$' > "$TMP/scenarios"
+while read -r name expect args; do
+	: > "$TMP/runs"
+	i=0
+	while [ $i -lt "$RUNS" ]; do
+		# shellcheck disable=SC2086
+		timeout 120 "$PHILO" --stats $args > "$TMP/out" 2> "$TMP/stats"
+		# shellcheck disable=SC2086
+		collect "$TMP/stats" "$TMP/out" "$(time_to_eat $args)" >> "$TMP/runs"
+		i=$((i + 1))
+	done
+	# Median of each metric; the outcome is "die" if any run died.
+	awk -v name="$name" -v expect="$expect" -v runs="$RUNS" '
+	$1 == "outcome" { if ($2 == "die") died = 1; next }
+	{ v[$1, ++c[$1]] = $2; keys[$1] = 1 }
+	END {
+		for (k in keys) {
+			n = c[k]
+			for (i = 1; i <= n; i++) for (j = i + 1; j <= n; j++)
+				if (v[k, j] < v[k, i]) { t = v[k, i]; v[k, i] = v[k, j]; v[k, j] = t }
+			print name, k, v[k, int((n + 1) / 2)]
+		}
+		print name, "outcome", (died ? "die" : "live"), expect
+	}' "$TMP/runs" > "$TMP/median"
+	awk -v baselines="$BASELINES" -v update="$UPDATE" -v newb="$TMP/new_baselines" '
+	BEGIN {
+		while ((getline line < baselines) > 0) {
+			split(line, f, " ")
+			if (f[1] ~ /^#/) continue
+			base[f[1], f[2]] = f[3]; tol[f[1], f[2]] = f[4]; slack[f[1], f[2]] = f[5]
+		}
+		dtol["wall_ms"] = 25; dslack["wall_ms"] = 50
+		dtol["cpu_ms"] = 50; dslack["cpu_ms"] = 20
+		dtol["ctx_switches"] = 50; dslack["ctx_switches"] = 200
+		dtol["meals_per_sec"] = 20; dslack["meals_per_sec"] = 5
+		dtol["detect_us"] = 100; dslack["detect_us"] = 1000
+		dtol["jitter_ms"] = 100; dslack["jitter_ms"] = 3
+		dtol["us_per_meal"] = 50; dslack["us_per_meal"] = 10
+		dtol["wake_per_meal"] = 30; dslack["wake_per_meal"] = 1
+	}
+	$2 == "outcome" { name = $1; got = $3; expect = $4; next }
+	{ name = $1; m[$2] = $3 }
+	END {
+		bad = ""
+		if (got != expect) bad = bad " outcome(" got ")"
+		for (k in m) {
+			if (update == 1) {
+				print name, k, m[k], dtol[k], dslack[k] >> newb
+				continue
+			}
+			if (!((name, k) in base)) continue
+			b = base[name, k]; t = tol[name, k]; s = slack[name, k]
+			if (k == "meals_per_sec")
+				worse = (b - m[k] > b * t / 100 && b - m[k] > s)
+			else
+				worse = (m[k] - b > b * t / 100 && m[k] - b > s)
+			if (worse) bad = bad " " k "(" m[k] " vs " b ")"
+		}
+		printf "%-14s %-6s %10.1f %10.1f %8d %12.1f %10d %9d %8.1f %8.2f\n", \
+			name, (bad == "" ? "ok" : "FAIL"), m["wall_ms"], m["cpu_ms"], \
+			m["ctx_switches"], m["meals_per_sec"], m["detect_us"], \
+			m["jitter_ms"], m["us_per_meal"], m["wake_per_meal"]
+		if (bad != "") { print "  regression:" bad; exit 1 }
+	}' "$TMP/median" || status=1
+done < "$TMP/scenarios"
+if [ $UPDATE -eq 1 ]; then
+	sort -k1,1 -k2,2 "$TMP/new_baselines" > "$BASELINES"
+	echo "bench: baselines written to $BASELINES"
+	exit 0
+fi
+exit $status
@@ -0,0 +1,53 @@
+#!/bin/sh
+# Compares thread-per-philosopher runs with --shards runs on large tables.
+#
+# Usage: bench/shard_bench.sh [path/to/philo]   (or: make bench-shard)
+#
+# Runs "N DIE EAT SLEEP MEALS" for each N in SIZES (default 200 to 100k)
+# with one thread per philosopher and with --shards=K (default: the
+# number of CPUs), RUNS times each (default 3), output to /dev/null
+# through --sink=write. Reports the median meals_per_sec and philo_cpu_us
+# per meal from --stats, and how many runs ended without a death. A mode
+# that cannot start (too many threads for the host) shows "-".
+
+PHILO=${1:-./philo}
+RUNS=${RUNS:-3}
+SIZES=${SIZES:-"200 1000 10000 100000"}
+TIMES=${TIMES:-"800 200 200 5"}
+SHARDS=${SHARDS:-$(nproc 2>/dev/null || echo 4)}
+TMP=${TMPDIR:-/tmp}/philo_shard.$$
+[ -x "$PHILO" ] || { echo "shard_bench: $PHILO not found" >&2; exit 2; }
+mkdir -p "$TMP" || exit 2
+trap 'rm -rf "$TMP"' EXIT INT TERM
+
+printf "%-8s %-10s %8s %14s %14s\n" philos mode alive meals_per_sec \
+	cpu_us/meal
+for n in $SIZES; do
+	for mode in threads shards; do
+		opt=""
+		[ "$mode" = shards ] && opt="--shards=$SHARDS"
+		[ "$mode" = shards ] && [ "$SHARDS" -gt "$n" ] && opt="--shards=$n"
+		i=0; : > "$TMP/stats"
+		while [ $i -lt "$RUNS" ]; do
+			# shellcheck disable=SC2086
+			"$PHILO" --stats --sink=write --max-philos=$n $opt $n $TIMES \
+				> /dev/null 2>> "$TMP/stats" || echo "failed=1" >> "$TMP/stats"
+			i=$((i + 1))
+		done
+		awk -F= -v n="$n" -v m="$mode" -v r="$RUNS" '
+		function sort(a, k,    i, j, x) {
+			for (i = 1; i <= k; i++) for (j = i + 1; j <= k; j++)
+				if (a[j] < a[i]) { x = a[i]; a[i] = a[j]; a[j] = x }
+		}
+		$1 == "meals_per_sec" { mps[++nm] = $2 }
+		$1 == "philo_cpu_us_per_meal" { cpu[++nc] = $2 }
+		$1 == "death_latency_us" && $2 < 0 { alive++ }
+		END {
+			sort(mps, nm); sort(cpu, nc)
+			printf "%-8s %-10s %5d/%-2d %14s %14s\n", n, m, alive, r,
+				nm ? mps[int((nm + 1) / 2)] : "-",
+				nc ? cpu[int((nc + 1) / 2)] : "-"
+		}' "$TMP/stats"
+	done
+done
+exit 0
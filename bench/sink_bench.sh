@@ -0,0 +1,67 @@
+#!/bin/sh
+# Compares the output backends (--sink=stdio|write|uring).
+#
+# Usage: bench/sink_bench.sh [path/to/philo]
+#
+# Runs TABLE (default "200 410 200 200 10") with every backend, RUNS times
+# (default 3), writing the simulation output
+#   file  to a regular file;
+#   pipe  to a slow consumer reading CHUNK bytes (default 1024) every 20 ms,
+#         about 50 KB/s, less than the table produces.
+# Reports the number of runs that ended in a death, the median wall time
+# (until the output was fully handed to the kernel), the median meals/sec
+# and the median number of stalls (a printer waiting for a free buffer).
+# A backend that blocks the printing philosopher on a full pipe shows up as
+# deaths or a lower meals/sec.
+
+PHILO=${1:-./philo}
+RUNS=${RUNS:-3}
+TABLE=${TABLE:-200 410 200 200 10}
+CHUNK=${CHUNK:-1024}
+TMP=${TMPDIR:-/tmp}/philo_sink.$$
+[ -x "$PHILO" ] || { echo "sink_bench: $PHILO not found" >&2; exit 2; }
+mkdir -p "$TMP" || exit 2
+trap 'rm -rf "$TMP"' EXIT INT TERM
+
+# Reads stdin CHUNK bytes at a time, every 20 ms, appending to $1.
+slow_reader() {
+	: > "$1"
+	while [ "$(dd bs="$CHUNK" count=1 2>/dev/null | tee -a "$1" | wc -c)" -gt 0 ]
+	do
+		sleep 0.02
+	done
+}
+
+printf "%-6s %-6s %7s %9s %10s %7s\n" target sink deaths wall_ms meals/sec stalls
+for target in file pipe; do
+	for sink in stdio write uring; do
+		i=0; deaths=0; : > "$TMP/stats"
+		while [ $i -lt "$RUNS" ]; do
+			if [ $target = file ]; then
+				# shellcheck disable=SC2086
+				"$PHILO" --stats --sink=$sink $TABLE > "$TMP/out" 2> "$TMP/err"
+				grep -q died "$TMP/out" && deaths=$((deaths + 1))
+			else
+				# shellcheck disable=SC2086
+				"$PHILO" --stats --sink=$sink $TABLE 2> "$TMP/err" \
+					| slow_reader "$TMP/out"
+				grep -q died "$TMP/out" && deaths=$((deaths + 1))
+			fi
+			cat "$TMP/err" >> "$TMP/stats"
+			i=$((i + 1))
+		done
+		awk -F= -v t=$target -v s=$sink -v d="$deaths" -v r="$RUNS" '
+		function median(a, n,    i, j, x) {
+			for (i = 1; i <= n; i++) for (j = i + 1; j <= n; j++)
+				if (a[j] < a[i]) { x = a[i]; a[i] = a[j]; a[j] = x }
+			return a[int((n + 1) / 2)]
+		}
+		$1 == "wall_us" { w[++n] = $2 / 1000 }
+		$1 == "meals_per_sec" { m[++k] = $2 }
+		$1 == "sink_stalls" { st[++q] = $2 }
+		END {
+			printf "%-6s %-6s %4d/%-2d %9.1f %10.1f %7s\n", t, s, d, r,
+				median(w, n), median(m, k), q ? median(st, q) : "-"
+		}' "$TMP/stats"
+	done
+done
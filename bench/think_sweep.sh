@@ -0,0 +1,49 @@
+#!/bin/sh
+# Compares the static and adaptive think-delay policies (--think=...).
+#
+# Usage: bench/think_sweep.sh [path/to/philo]
+#
+# For every table in the grid below, runs both policies RUNS times (default
+# 3) and reports the number of runs that ended in a death, the median
+# meals/sec and the smallest slack left at any meal (min over the runs,
+# from --stats). Slack only covers meals actually eaten, so it is only
+# meaningful for runs without deaths.
+
+PHILO=${1:-./philo}
+RUNS=${RUNS:-3}
+MEALS=${MEALS:-10}
+[ -x "$PHILO" ] || { echo "think_sweep: $PHILO not found" >&2; exit 2; }
+
+GRID="4 410 200 200
+4 800 200 200
+5 800 200 200
+5 610 200 100
+5 800 300 100
+3 700 200 200
+3 610 200 100
+199 610 200 200
+200 410 200 200"
+
+printf "%-18s %-9s %7s %12s %13s\n" table think deaths meals/sec min_slack_ms
+echo "$GRID" | while read -r table; do
+	for mode in static adaptive; do
+		i=0; deaths=0; : > /tmp/think_sweep.$$
+		while [ $i -lt "$RUNS" ]; do
+			# shellcheck disable=SC2086
+			"$PHILO" --stats --think=$mode $table $MEALS 2>/tmp/think_stats.$$ \
+				| grep -q died && deaths=$((deaths + 1))
+			cat /tmp/think_stats.$$ >> /tmp/think_sweep.$$
+			i=$((i + 1))
+		done
+		awk -F= -v t="$table" -v m="$mode" -v d="$deaths" -v r="$RUNS" '
+		$1 == "meals_per_sec" { v[++n] = $2 }
+		$1 == "min_slack_us" { if (s == "" || $2 < s) s = $2 }
+		END {
+			for (i = 1; i <= n; i++) for (j = i + 1; j <= n; j++)
+				if (v[j] < v[i]) { x = v[i]; v[i] = v[j]; v[j] = x }
+			printf "%-18s %-9s %4d/%-2d %12.1f %13.1f\n", t, m, d, r,
+				v[int((n + 1) / 2)], s / 1000
+		}' /tmp/think_sweep.$$
+	done
+done
+rm -f /tmp/think_sweep.$$ /tmp/think_stats.$$
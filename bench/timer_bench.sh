@@ -0,0 +1,63 @@
+#!/bin/sh
+# Compares the shared timer service with per-thread sleeps
+# (--timer=wheel|sleep).
+#
+# Usage: bench/timer_bench.sh [path/to/philo]
+#
+# Runs each TABLE (default: 200, 100 and 20 philosophers) RUNS times
+# (default 3) per mode and reports medians of: the syscalls made to wait
+# out phases, voluntary and involuntary context switches, system CPU time
+# and how late philosophers woke up past their deadline. With `perf` on
+# the PATH, `perf stat` also counts every syscall and context switch of
+# the process (PERF=0 disables it).
+
+PHILO=${1:-./philo}
+RUNS=${RUNS:-3}
+TABLES=${TABLES:-"200 410 200 200 10|100 410 200 200 10|20 410 200 200 20"}
+TMP=${TMPDIR:-/tmp}/philo_timer.$$
+[ -x "$PHILO" ] || { echo "timer_bench: $PHILO not found" >&2; exit 2; }
+mkdir -p "$TMP" || exit 2
+trap 'rm -rf "$TMP"' EXIT INT TERM
+PERF=${PERF:-1}
+[ "$PERF" = 1 ] && command -v perf >/dev/null 2>&1 || PERF=0
+
+printf "%-20s %-6s %9s %9s %8s %8s %8s %9s\n" table timer syscalls \
+	perf_sys vol_cs invol_cs sys_ms late_us
+echo "$TABLES" | tr '|' '\n' | while read -r table; do
+	for timer in sleep wheel; do
+		i=0; : > "$TMP/stats"
+		while [ $i -lt "$RUNS" ]; do
+			if [ "$PERF" = 1 ]; then
+				# shellcheck disable=SC2086
+				perf stat -x, -e raw_syscalls:sys_enter,context-switches \
+					-o "$TMP/perf" "$PHILO" --stats --timer=$timer $table \
+					> /dev/null 2> "$TMP/err"
+				awk -F, '/sys_enter/ { print "perf_syscalls=" $1 }' \
+					"$TMP/perf" >> "$TMP/stats"
+			else
+				# shellcheck disable=SC2086
+				"$PHILO" --stats --timer=$timer $table > /dev/null \
+					2> "$TMP/err"
+			fi
+			cat "$TMP/err" >> "$TMP/stats"
+			i=$((i + 1))
+		done
+		awk -F= -v t="$table" -v m=$timer '
+		function median(a, n,    i, j, x) {
+			for (i = 1; i <= n; i++) for (j = i + 1; j <= n; j++)
+				if (a[j] < a[i]) { x = a[i]; a[i] = a[j]; a[j] = x }
+			return a[int((n + 1) / 2)]
+		}
+		$1 == "sleep_syscalls" { s[++ns] = $2 }
+		$1 == "perf_syscalls" { p[++np] = $2 }
+		$1 == "voluntary_ctx_switches" { v[++nv] = $2 }
+		$1 == "involuntary_ctx_switches" { iv[++ni] = $2 }
+		$1 == "cpu_sys_us" { c[++nc] = $2 / 1000 }
+		$1 == "sleep_late_avg_us" { l[++nl] = $2 }
+		END {
+			printf "%-20s %-6s %9d %9s %8d %8d %8.1f %9d\n", t, m,
+				median(s, ns), np ? median(p, np) : "-", median(v, nv),
+				median(iv, ni), median(c, nc), median(l, nl)
+		}' "$TMP/stats"
+	done
+done
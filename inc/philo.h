@@ -6,7 +6,7 @@
 /*   By: vrads <vrads@student.42.fr>                +#+  +:+       +#+        */
 /*                                                +#+#+#+#+#+   +#+           */
 /*   Created: 2025/06/17 16:05:43 by vrads             #+#    #+#             */
-/*   Updated: 2025/06/17 16:07:25 by vrads            ###   ########.fr       */
+/*   Updated: 2025/07/15 16:57:21 by vrads            ###   ########.fr       */
 /*                                                                            */
 /* ************************************************************************** */
 
@@ -18,7 +18,95 @@
 # include <stdlib.h>
 # include <unistd.h>
 # include <pthread.h>
+# include <string.h>
+# include <time.h>
+# include <fcntl.h>
+# include <signal.h>
 # include <sys/time.h>
+# include <sys/mman.h>
+# include <sys/resource.h>
+# include <stdint.h>
+# include <limits.h>
+# include <sys/syscall.h>
+# include <linux/futex.h>
+# include <sys/epoll.h>
+# include <sys/eventfd.h>
+# include <sys/timerfd.h>
+# include <sys/stat.h>
+# include <sys/uio.h>
+# include <errno.h>
+# include <linux/io_uring.h>
+# include <sys/prctl.h>
+# include <sched.h>
+# include <poll.h>
+# include <stddef.h>
+# include <sys/socket.h>
+# include <sys/wait.h>
+# if defined(__x86_64__) || defined(__i386__)
+#  include <x86intrin.h>
+#  include <cpuid.h>
+# endif
+# include "philo_trace.h"
+# include "philo_chaos.h"
+
+# define CKPT_MAGIC "PHCK"
+# define CKPT_VERSION 1
+# define REPLAY_MAGIC "PHRP"
+# define REPLAY_VERSION 2
+# define REPLAY_MAX_RECORDS 16777216 // 256 MiB log, sparse until written
+# define REPLAY_POLL_US 10000 // Replay turn waits recheck the end flag
+# define REPLAY_WAKE -1 // Record: a phase wait ended
+# define REPLAY_END -2 // Record: the monitor found the table full
+# define REPLAY_DIED(id) (-2 - (id)) // Record: the monitor declared a death
+# define REPLAY_LINE 0x7fffffff // Record: a philosopher printed a line
+
+# define TSC_CALIBRATE_NS 2000000 // Each of the two startup calibrations
+# define TSC_AGREE_PPM 200 // Calibrations further apart: TSC not used
+# define TSC_RESYNC_NS 1000000000LL // Re-anchor on CLOCK_MONOTONIC
+# define TSC_PAIR_TRIES 5 // Readings per TSC/monotonic pair
+# define TSC_PAIR_MAX_NS 20000 // Widest pair accepted on a resync
+# define TSC_SLEW_PPM 1000 // Largest rate change accepted on a resync
+# define TSC_RESYNC_FAILS 8 // Resyncs rejected in a row: TSC given up
+# define CLOCK_BENCH_CALLS 10000000 // Readings timed per source
+# define CLOCK_BENCH_SECONDS 3600 // Default length of the drift test
+
+# define PROC_REQ 1 // Link message: the other side wants the fork
+# define PROC_TOKEN 2 // Link message: the fork itself
+# define PROC_LINES 3 // To the coordinator: a record of output lines
+# define PROC_DIED 4 // To the coordinator: a record ending in a death
+# define PROC_FULL 5 // To the coordinator: every philosopher of a slice
+# define PROC_STOP 6 // From the coordinator: the run is over
+# define PROC_START 7 // From the coordinator: the start time of the run
+# define PROC_PING 8 // From the coordinator: send the time you are at
+# define PROC_TICK 9 // To the coordinator: the answer to PROC_PING
+
+# define ARENA_LINE 64 // Cache line alignment for arena arrays
+# define ARENA_HUGE_PAGE 2097152
+# define PHILO_STACK_SIZE 65536 // Stack of each pool thread, from the arena
+# define DEFAULT_MAX_PHILOS 200
+# define THINK_WAIT_EPS_US 200 // Fork waits below this count as no wait
+# define THINK_GUARD_US 2000 // Slack the adaptive think delay never uses
+# define THINK_YIELD_STEP_US 250 // Poll step while yielding to a neighbour
+# define DEADLOCK_CONFIRM_US 1000 // A wait-for cycle must persist this long
+# define EVENT_BATCH_MAX 3 // Lines per output record: fork, fork, eating
+# define SINK_BUFFERS 4 // Output buffers for --sink=write|uring
+# define SINK_BUFFER_SIZE 65536
+# define LOG_RING_SIZE 1048576 // Bytes queued by --log=drop|sample (power of 2)
+# define TRACE_FRAME_MAGIC "PHZ1"
+# define TRACE_FRAME_RAW 262144 // Text per --compress frame
+# define LZ_HASH_BITS 12
+# define LZ_BOUND(n) ((n) + (n) / 255 + 16) // Worst-case lz_compress output
+# define DURATION_MAX_US 1000000000000000000LL // 10^18 us, sums stay in range
+# define SCENARIO_MAX_TOKENS 64 // Words on one scenario file line
+# define OVERSHOOT_BUCKET_US 10 // Eat-phase overshoot histogram (--stats)
+# define OVERSHOOT_BUCKETS 1024 // Last bucket collects everything above
+# define FORK_HELD 1 // --shards fork state bits (see shard.c)
+# define FORK_WANTED 2 // Boundary fork: the other shard failed to take it
+# define SCHED_WAITER 0x80000000u // --scheduled: a neighbour waits on sched_next
+# define WHEEL_TICK_US 50 // Resolution of the --timer=wheel service
+# define WHEEL_BITS 6
+# define WHEEL_SLOTS 64 // Slots per wheel level (1 << WHEEL_BITS)
+# define WHEEL_LEVELS 4 // 64^4 ticks: about 14 simulated minutes
 
 // Enum for philosopher states
 typedef enum e_state
@@ -30,14 +118,514 @@ typedef enum e_state
 	FULL
 }	t_state;
 
+// Think delay policy (--think=static|adaptive)
+typedef enum e_think_mode
+{
+	THINK_STATIC,
+	THINK_ADAPTIVE
+}	t_think_mode;
+
+// Output backend (--sink=stdio|write|uring), see output_sink.c
+typedef enum e_sink_mode
+{
+	SINK_STDIO,
+	SINK_WRITE,
+	SINK_URING
+}	t_sink_mode;
+
+// Output policy under backpressure (--log=...), see log_policy.c
+typedef enum e_log_mode
+{
+	LOG_BLOCK,
+	LOG_DROP,
+	LOG_SAMPLE
+}	t_log_mode;
+
+// How philosophers wait out eat/sleep/think (--timer=wheel|sleep)
+typedef enum e_timer_mode
+{
+	TIMER_WHEEL,
+	TIMER_SLEEP
+}	t_timer_mode;
+
+// Raw clock behind every timestamp (--clock=tsc|vdso)
+typedef enum e_clock_mode
+{
+	CLOCKSRC_TSC, // Calibrated TSC when reliable, else the vDSO clock
+	CLOCKSRC_VDSO // clock_gettime(CLOCK_MONOTONIC)
+}	t_clock_mode;
+
+// Who notices a starving philosopher (--detect=monitor|self)
+typedef enum e_detect_mode
+{
+	DETECT_MONITOR,
+	DETECT_SELF // Deadline-bounded waits, no monitor thread
+}	t_detect_mode;
+
+// --analyze: prediction only, or prediction checked against a run
+typedef enum e_analyze_mode
+{
+	ANALYZE_OFF,
+	ANALYZE_ONLY,
+	ANALYZE_RUN
+}	t_analyze_mode;
+
+// Kinds of status lines, for the per-type --log counters
+typedef enum e_event_type
+{
+	EV_FORK,
+	EV_EAT,
+	EV_SLEEP,
+	EV_THINK,
+	EV_DIED,
+	EVENT_TYPES
+}	t_event_type;
+
+// Command-line `--options`, parsed before the positional arguments
+typedef struct s_options
+{
+	double			time_scale; // Wall-clock seconds per simulated second
+	int				real_timestamps; // Print wall-clock instead of simulated ms
+	const char		*checkpoint_file; // NULL when checkpoints are disabled
+	long long		checkpoint_interval; // Simulated us, 0 = SIGUSR1 only
+	const char		*resume_file;
+	int				hugepages; // Back the arena with huge pages if possible
+	int				max_philos;
+	int				stats; // Print run statistics to stderr at exit
+	t_think_mode	think_mode;
+	int				repeat; // Simulations run back to back on one thread pool
+	t_sink_mode		sink_mode;
+	t_log_mode		log_mode;
+	int				log_sample; // N of --log=sample:N
+	int				compress; // Write LZ-compressed trace frames
+	t_timer_mode	timer_mode;
+	const char		*check_file; // --check-scenarios: validate and exit
+	int				realtime; // Locked memory, SCHED_FIFO, pinned writer
+	t_analyze_mode	analyze;
+	t_detect_mode	detect_mode;
+	int				shards; // Cooperative workers, 0 = one thread per philosopher
+	int				procs; // --procs: one process per shard, 0 = threads
+	int				scheduled; // Eat in precomputed slots, no fork race
+	const char		*record_file; // --record: log for --replay, or NULL
+	const char		*replay_file;
+	t_clock_mode	clock_mode;
+	double			clock_bench; // --clock-bench: drift test seconds, or 0
+}	t_options;
+
+// Entry of the `--option` dispatch table in options.c
+typedef struct s_option_def
+{
+	const char		*name;
+	int				(*handler)(t_options *opts, const char *value);
+}	t_option_def;
+
+// Single page-aligned region holding all per-philosopher state
+typedef struct s_arena
+{
+	char			*base;
+	size_t			size;
+	size_t			used;
+	int				hugepages; // 1 if backed by MAP_HUGETLB
+}	t_arena;
+
+// What one pool thread cost in a round (see thread_pool.c)
+typedef struct s_thread_cost
+{
+	long long		cpu_us; // CLOCK_THREAD_CPUTIME_ID
+	long long		nvcsw; // Voluntary switches: blocked, then woken up
+	long long		nivcsw; // Involuntary switches: preempted
+}	t_thread_cost;
+
+// Roles of the pool threads, for the per-role --stats cost totals
+typedef enum e_cost_role
+{
+	COST_PHILO,
+	COST_MONITOR,
+	COST_TIMER,
+	COST_ROLES
+}	t_cost_role;
+
+// Run statistics reported by --stats
+typedef struct s_stats
+{
+	long long		startup_begin_us;
+	long long		startup_us;
+	long			minor_faults;
+	long			major_faults;
+	long long		death_latency_us; // Detection delay past the deadline, -1 if none
+	long long		run_begin_us; // Real time the current run was requested
+	long long		first_event_us; // First status line of this run, 0 if none yet
+	long long		cold_first_event_us; // Process start to first event of run 1
+	long long		warm_first_event_us; // Sum over runs 2..N (restart latency)
+	long long		meals; // Meals eaten over all finished runs
+	long long		min_slack_us; // Smallest slack over all finished runs
+	int				runs;
+	long long		sleep_syscalls; // usleep/futex calls made to wait out phases
+	long long		sleeps; // Phases waited out over all finished runs
+	long long		sleep_late_us; // Sum of wake-up delays past the deadline
+	long long		sleep_late_max_us;
+	long long		overshoot[OVERSHOOT_BUCKETS]; // Eat phases per 10 us of overshoot
+	t_thread_cost	cost[COST_ROLES]; // Pool threads, summed per role
+}	t_stats;
+
+// Steady-state schedule predicted by --analyze (see analyze.c)
+typedef enum e_verdict
+{
+	VERDICT_SURVIVES,
+	VERDICT_AT_RISK, // Survives only if no fork race is lost
+	VERDICT_DIES
+}	t_verdict;
+
+typedef struct s_analysis
+{
+	long long		think_us; // Think delay of the steady state
+	long long		cycle_us; // eat + sleep + think: own pace
+	long long		rotation_us; // Fastest pace the fork order allows
+	long long		period_us; // Longest gap between two meal starts
+	long long		mean_period_us; // Average gap: sets the throughput
+	long long		first_meal_us[3]; // Odd ids, even ids, id N (odd N)
+	long long		slack_us; // Steady-state slack
+	long long		contended_slack_us; // After one lost fork race, or slack_us
+	long long		min_slack_us;
+	long long		duration_us; // Until all are full, -1 without a meal count
+	double			meals_per_sec;
+	double			max_meals_per_sec; // floor(N/2) eating at all times
+	t_verdict		verdict;
+	long long		run_begin_us; // --analyze=run: real time before the run
+}	t_analysis;
+
+// Fault injection settings and counters (see chaos.c)
+typedef struct s_chaos
+{
+	int				enabled; // PHILO_CHAOS set in a -DPHILO_CHAOS build
+	uint32_t		yield_below; // Draw below this: sched_yield()
+	uint32_t		sleep_below; // Draw below this (and above yield): sleep
+	long long		sleep_max_us;
+	uint64_t		seed;
+	long long		yields;
+	long long		sleeps;
+}	t_chaos;
+
+// How much memory --realtime could lock
+typedef enum e_rt_lock
+{
+	RT_LOCK_NONE,
+	RT_LOCK_ARENA, // RLIMIT_MEMLOCK too small for the whole process
+	RT_LOCK_ALL
+}	t_rt_lock;
+
+// What --realtime managed to set up (see realtime.c)
+typedef struct s_realtime
+{
+	long			prefault_pages;
+	t_rt_lock		mlock;
+	int				fifo; // 1 if every pool thread got SCHED_FIFO
+	int				pinned; // 1 if the writer has a CPU of its own
+}	t_realtime;
+
+// Pool thread; runs `job(arg)` once per pool_run()
+typedef struct s_worker
+{
+	pthread_t		thread;
+	void			*(*job)(void *);
+	void			*arg;
+	struct s_pool	*pool;
+	t_thread_cost	cost; // Of the job of the last round
+}	t_worker;
+
+// Persistent executor parked on a futex (see thread_pool.c)
+typedef struct s_pool
+{
+	t_worker		*workers; // Carved from the table arena
+	char			*guards; // Guard page below each stack, NULL if none
+	int				count; // Threads actually created
+	uint32_t		generation; // Futex: bumped to start a round
+	uint32_t		running; // Futex: workers still busy in this round
+	int				shutdown;
+}	t_pool;
+
+// One worker's contiguous slice of the ring with --shards (see shard.c)
+typedef struct s_shard
+{
+	int				first; // Index of its first philosopher
+	int				count;
+	int				*heap; // Local indices, earliest `due` first
+	int				*pos; // Heap slot of each local philosopher
+	long long		*due; // Next event: end of phase or death
+	long long		*phase_end; // LLONG_MAX while waiting for forks
+	uint32_t		seq; // Futex: bumped when a boundary fork is freed
+	long long		woken_ns; // When a neighbour freed a fork for it, or 0
+	long long		handoffs; // Boundary forks received after a wait
+	long long		handoff_ns; // Sum of their delivery delays
+	long long		handoff_max_ns;
+	struct s_table	*table;
+}	t_shard;
+
+// Deadline a philosopher sleeps on (see timer_wheel.c)
+typedef struct s_timer
+{
+	uint32_t		fired; // Futex: 0 while armed, 1 once expired
+	long long		tick; // Expiry in WHEEL_TICK_US units
+	struct s_timer	*next; // Slot list, owned by the wheel while armed
+}	t_timer;
+
+// Hierarchical timing wheel run by one service thread
+typedef struct s_wheel
+{
+	t_timer			*slots[WHEEL_LEVELS][WHEEL_SLOTS];
+	long long		cur; // Next tick to expire
+	long long		next_tick; // Tick the service sleeps until, -1 if idle
+	int				pending; // Armed timers
+	int				stopped; // Run over: timers fire at once
+	int				sleeping; // Service parked on `seq`
+	uint32_t		seq; // Futex the service sleeps on
+	long long		wakeups; // Times the service woke up
+	pthread_mutex_t	mutex;
+	int				mutex_initialized;
+}	t_wheel;
+
+// One status line, timestamped when it happened (see print_events)
+typedef struct s_event
+{
+	long long		time_us; // Simulated us
+	const char		*status;
+}	t_event;
+
+// One side of a fork shared by two processes with --procs (see procs.c)
+typedef struct s_token
+{
+	int				fd; // Socket to the process on the other side
+	int				have; // The fork is on this side
+	int				held; // ... and in use
+	int				asked; // PROC_REQ sent, the fork not back yet
+	int				wanted; // The other side sent PROC_REQ
+}	t_token;
+
+// Message on a --procs socket; only the lines of PROC_LINES are variable
+typedef struct s_proc_msg
+{
+	int32_t			type;
+	int32_t			count; // Lines in `text`
+	long long		sent_ns; // real_time_ns() of the sender
+	t_event			events[EVENT_BATCH_MAX];
+	int				ends[EVENT_BATCH_MAX];
+	char			text[EVENT_BATCH_MAX * 64];
+}	t_proc_msg;
+
+// What a --procs child leaves for the coordinator (shared mapping)
+typedef struct s_proc_report
+{
+	long long		meals;
+	long long		min_slack_us;
+	long long		sleeps;
+	long long		sleep_late_us;
+	long long		sleep_late_max_us;
+	long long		death_latency_us;
+	long long		handoffs;
+	long long		handoff_ns;
+	long long		handoff_max_ns;
+	long long		messages; // Link messages sent
+	long long		overshoot[OVERSHOOT_BUCKETS];
+	t_thread_cost	cost; // The whole process
+}	t_proc_report;
+
+// What the coordinator knows of one --procs child (see merge_output)
+typedef struct s_proc_child
+{
+	t_proc_msg		head; // Oldest record not written yet
+	int				has_head;
+	int				pinged; // PROC_PING sent, no answer yet
+	long long		mark; // No later record of the child is older
+}	t_proc_child;
+
+// --procs state: the coordinator's children, or one child's sockets
+typedef struct s_procs
+{
+	int				index; // Slice run by this process, -1 in the coordinator
+	int				coord_fd; // Child: socket to the coordinator, else -1
+	t_token			left; // Fork `first` of the slice
+	t_token			right; // First fork of the next slice
+	long long		messages; // Link messages sent by this process
+	int				*fds; // Coordinator: child sockets, then the link pairs
+	pid_t			*pids;
+	struct pollfd	*polls; // Coordinator: its end of each child socket
+	t_proc_child	*children; // Coordinator: one per child
+	int				full; // Coordinator: slices that sent PROC_FULL
+	long long		full_at; // ... the latest of their times
+	t_proc_report	*reports; // MAP_SHARED, one per child
+}	t_procs;
+
+// io_uring mapped without liburing (see output_sink.c)
+typedef struct s_uring
+{
+	int					fd; // -1 if not set up
+	char				*map; // SQ and CQ rings (single mmap)
+	size_t				map_size;
+	struct io_uring_sqe	*sqes;
+	size_t				sqes_size;
+	unsigned			*sq_tail;
+	unsigned			*sq_mask;
+	unsigned			*sq_array;
+	unsigned			*cq_head;
+	unsigned			*cq_tail;
+	unsigned			*cq_mask;
+	struct io_uring_cqe	*cqes;
+	int					fixed; // Buffers registered (IORING_OP_WRITE_FIXED)
+}	t_uring;
+
+// Buffered output sink, used under print_mutex
+typedef struct s_sink
+{
+	t_sink_mode		mode; // Effective backend (uring may fall back to write)
+	int				fd;
+	char			*bufs; // SINK_BUFFERS * SINK_BUFFER_SIZE, from the arena
+	size_t			fill[SINK_BUFFERS]; // Bytes queued in each buffer
+	size_t			done[SINK_BUFFERS]; // Bytes already written (short writes)
+	long long		file_off[SINK_BUFFERS]; // Offset of each buffer in the file
+	int				busy[SINK_BUFFERS]; // Write in flight
+	int				current; // Buffer being filled
+	int				in_flight;
+	int				max_in_flight; // SINK_BUFFERS for files, 1 for streams
+	long long		offset; // Next file offset, -1 for streams
+	long long		bytes;
+	long long		writes;
+	long long		stalls; // Times a printer waited for a free buffer
+	long long		errors;
+	t_uring			ring;
+}	t_sink;
+
+// Ring drained by the log writer thread in --log=drop|sample modes
+typedef struct s_log
+{
+	t_log_mode		mode;
+	int				sample;
+	char			*ring; // LOG_RING_SIZE bytes from the arena
+	uint64_t		head; // Consumed by the writer
+	uint64_t		tail; // Produced under print_mutex
+	uint32_t		seq; // Futex the writer sleeps on
+	uint32_t		sleeping;
+	int				shutdown;
+	pthread_t		thread;
+	int				thread_valid;
+	long long		written[EVENT_TYPES];
+	long long		dropped[EVENT_TYPES]; // Ring full
+	long long		sampled_out[EVENT_TYPES];
+	long long		seen[EVENT_TYPES];
+}	t_log;
+
+// Header of a --compress frame (see trace_compress.c)
+typedef struct s_frame_header
+{
+	char			magic[4]; // TRACE_FRAME_MAGIC
+	uint32_t		raw_len; // Text bytes in the frame
+	uint32_t		comp_len; // Payload bytes following the header
+	uint32_t		checksum; // lz_checksum of the text
+	int64_t			first_ms; // Timestamp of the first line
+	int64_t			last_ms; // Timestamp of the last line
+}	t_frame_header;
+
+// Frame builder run by the log writer thread
+typedef struct s_compressor
+{
+	int				enabled;
+	char			*raw; // TRACE_FRAME_RAW bytes of text, from the arena
+	size_t			raw_len;
+	char			*out; // LZ_BOUND(TRACE_FRAME_RAW) bytes, from the arena
+	long long		frames;
+	long long		raw_bytes;
+	long long		comp_bytes; // Headers included
+	long long		cpu_ns; // Thread CPU time spent in lz_compress
+}	t_compressor;
+
+// Lock-free wait-for graph and deadlock detector state (see deadlock.c)
+typedef struct s_wfg
+{
+	int				*holder; // Id holding each fork, 0 if free (arena)
+	int				*mark; // Detector scratch, one per philosopher (arena)
+	long long		suspect_sig; // Signature of the cycle being confirmed
+	long long		suspect_at; // When it was first seen, -1 if none
+	int				reported; // Cycle already dumped in this run
+}	t_wfg;
+
+// --record log header (see replay.c)
+typedef struct s_replay_header
+{
+	char			magic[4];
+	int32_t			version;
+	int32_t			num_philos;
+	int32_t			num_must_eat;
+	int64_t			time_to_die;
+	int64_t			time_to_eat;
+	int64_t			time_to_sleep;
+	uint64_t		count; // Records following the header
+	uint64_t		dropped; // Records past REPLAY_MAX_RECORDS, not kept
+}	t_replay_header;
+
+// One event of a --record log
+typedef struct s_replay_rec
+{
+	int64_t			time_us; // Simulated us since the start
+	int32_t			thread; // Philosopher id, 0 for the monitor
+	int32_t			arg; // Fork index, REPLAY_WAKE/END/LINE or REPLAY_DIED(id)
+}	t_replay_rec;
+
+// --record / --replay state
+typedef struct s_replay
+{
+	int				recording;
+	int				replaying;
+	int				fd; // -1 if no log
+	void			*map; // Header and records, MAP_FAILED if none
+	size_t			map_size;
+	t_replay_rec	*recs;
+	uint64_t		cap; // Records the recording can keep
+	uint64_t		count; // Recorded (may exceed cap), or records to replay
+	uint32_t		cursor; // Replay: next record to take
+	uint32_t		*turn; // Replay: futex per thread (0 = monitor), arena
+}	t_replay;
+
+// Checkpoint file header (see checkpoint.c)
+typedef struct s_ckpt_header
+{
+	char			magic[4];
+	int32_t			version;
+	int32_t			num_philos;
+	int32_t			num_must_eat;
+	int64_t			time_to_die;
+	int64_t			time_to_eat;
+	int64_t			time_to_sleep;
+	int64_t			pause_latency_us;
+}	t_ckpt_header;
+
+// Checkpoint record, one per philosopher
+typedef struct s_ckpt_philo
+{
+	int64_t			remaining_us; // Time left until death when parked
+	int32_t			meals_eaten;
+	int32_t			state;
+}	t_ckpt_philo;
+
 // Structure for philosopher data
 typedef struct s_philo
 {
 	int				id;
 	int				meals_eaten;
-	long long		last_meal_time;
-	int				thread_valid; // 0 if creation failed or not attempted, 1 if successful
-	pthread_t		thread;
+	long long		last_meal_time; // Simulated microseconds
+	long long		paused_at; // When parked for a checkpoint, 0 otherwise
+	long long		resume_elapsed; // Time since last meal restored by --resume
+	long long		fork_wait_us; // Time blocked in the last take_forks()
+	long long		fork_wait_avg_us; // Smoothed fork_wait_us
+	long long		think_us; // Current adaptive think delay
+	long long		min_slack_us; // Smallest time left to die seen at a meal
+	int				waiting_fork; // Fork blocked on in take_forks(), -1 if none
+	long long		wait_since; // Start of that wait
+	t_event			pending[EVENT_BATCH_MAX]; // Fork lines queued for eat()
+	int				pending_count;
+	t_timer			timer;
+	long long		sleeps; // Phases waited out in this run
+	long long		sleep_late_us; // Sum of wake-up delays in this run
+	long long		sleep_late_max_us;
+	uint32_t		sched_next; // --scheduled: meal it eats next (futex)
 	t_state			state;
 	struct s_table	*table;
 	pthread_mutex_t	*left_fork;
@@ -48,14 +636,31 @@ typedef struct s_philo
 typedef struct s_table
 {
 	int				num_philos;
-	long long		time_to_die;
+	long long		time_to_die; // All durations in simulated microseconds
 	long long		time_to_eat;
 	long long		time_to_sleep;
 	int				num_must_eat;
-	long long		start_time;
+	long long		start_time; // Simulated microseconds
+	t_options		opts;
+	t_arena			arena;
+	t_stats			stats;
+	t_pool			pool; // Philosopher and monitor threads, reused by --repeat
+	t_wfg			wfg;
+	t_sink			sink;
+	t_log			log;
+	t_compressor	zip;
+	t_wheel			wheel;
+	t_realtime		rt;
+	t_chaos			chaos;
+	t_analysis		analysis;
+	t_replay		replay;
 	int				simulation_should_end;
 	t_philo			*philos;
 	pthread_mutex_t	*forks; // Array of fork mutexes
+	t_shard			*shards; // --shards only
+	t_procs			procs;
+	uint32_t		*fork_busy; // --shards: fork states, atomic at boundaries
+	long long		sched_gap_us; // --scheduled: period, the longest gap
 	int				forks_initialized_count; // How many fork mutexes were init'd
 	pthread_mutex_t	print_mutex;
 	int				print_mutex_initialized;
@@ -63,6 +668,17 @@ typedef struct s_table
 	int				sim_end_mutex_initialized;
 	pthread_mutex_t meal_time_mutex; // Added for protecting last_meal_time
 	int				meal_time_mutex_initialized;
+	int				deadline_owner; // Id owning the earliest death deadline
+	int				full_count; // --detect=self: philosophers done eating
+	int				monitor_epoll_fd; // -1 when polling every 1 ms
+	int				monitor_timer_fd;
+	int				monitor_wake_fd; // eventfd written by philosophers
+	int				pause_requested; // Philosophers park at the next safe point
+	int				paused_count;
+	pthread_mutex_t	pause_mutex;
+	pthread_cond_t	pause_cond;
+	int				pause_sync_initialized;
+	long long		next_checkpoint; // Relative to start_time, -1 if none
 }	t_table;
 
 // Function prototypes
@@ -75,34 +691,187 @@ void		cleanup(t_table *table);
 
 // thread_management.c
 int			initialize_simulation(t_table *table, int argc, char **argv);
-int			launch_threads(t_table *table, pthread_t *monitor_thread_id);
-int			create_monitor_thread(t_table *table, pthread_t *monitor_thread_id);
+int			run_simulations(t_table *table);
 
-// utils.c
+// futex.c
+void		futex_wait(uint32_t *addr, uint32_t expected);
+void		futex_wake(uint32_t *addr, int count);
+void		futex_wake_pair(uint32_t *a, uint32_t *b);
+void		futex_wait_us(uint32_t *addr, uint32_t expected, long long real_us);
+
+// thread_pool.c
+int			pool_init(t_pool *pool, t_arena *arena, int count);
+int			pool_is_guard(t_pool *pool, const void *addr);
+void		pool_run(t_pool *pool);
+void		pool_wait(t_pool *pool);
+void		pool_destroy(t_pool *pool);
+
+// clock.c
+void		clock_init(double time_scale, t_clock_mode mode);
+long long	monotonic_ns(void);
+uint64_t	tsc_ticks(void);
+long long	real_time_ns(void);
+long long	real_time_us(void);
+double		clock_tsc_mhz(void);
+long long	get_time_us(void);
 long long	get_time_ms(void); // Moved from main.c
-int			ft_atoi(const char *str);
+long long	sim_to_real_us(long long sim_us);
+long long	real_time_at(long long sim_us);
+void		clock_use_virtual(void);
+void		clock_set_virtual(long long sim_us);
+
+// clock_bench.c
+int			clock_bench(t_options *opts);
+
+// options.c
+int			parse_options(t_options *opts, int *argc, char **argv);
+
+// parse_num.c
+int			parse_count(const char *s, long long max, long long *out);
+int			parse_duration(const char *s, long long *us);
+int			parse_table_args(t_table *table, int argc, char **argv);
+const char	*table_arg_name(int index);
+
+// scenario_file.c
+int			check_scenario_file(const char *path);
+
+// utils.c
+void		print_events(t_philo *philo, const t_event *events, int count,
+				int override_sim_end);
 void		print_status(t_philo *philo, const char *status, int override_sim_end);
 int			is_simulation_over(t_table *table);
-void		precise_usleep(long long time_ms, t_table *table);
+void		precise_usleep(long long time_us, t_table *table);
+int			write_all(int fd, const void *buf, size_t len);
+
+// output_sink.c
+int			sink_init(t_table *table);
+void		sink_write(t_sink *sink, const char *buf, size_t len);
+void		sink_flush(t_sink *sink);
+void		sink_destroy(t_sink *sink);
+
+// log_policy.c
+int			log_init(t_table *table);
+int			log_record(t_table *table, const t_event *events, const char *buf,
+				const int *ends, int count, int override_sim_end);
+void		log_drain(t_table *table);
+void		log_destroy(t_table *table);
+const char	*event_type_name(int type);
+
+// lz.c
+size_t		lz_compress(const unsigned char *src, size_t n, unsigned char *dst);
+long		lz_decompress(const unsigned char *src, size_t n, unsigned char *dst,
+				size_t cap);
+uint32_t	lz_checksum(const unsigned char *p, size_t n);
+
+// trace_compress.c
+int			compress_init(t_table *table);
+void		compress_append(t_table *table, const char *data, size_t len);
+void		compress_flush(t_table *table);
+
+// timer_wheel.c
+int			init_timer_wheel(t_table *table);
+void		reset_timer_wheel(t_table *table);
+void		destroy_timer_wheel(t_table *table);
+long long	philo_sleep(t_philo *philo, long long time_us);
+void		timer_stop(t_table *table);
+void		*timer_routine(void *arg);
+
+// realtime.c
+void		realtime_setup(t_table *table);
+
+// analyze.c
+void		analyze_table(t_table *table, t_analysis *a);
+int			analyze_only(t_table *table, int argc, char **argv);
+void		analyze_begin(t_table *table);
+void		analyze_end(t_table *table);
+
+// chaos.c
+int			chaos_init(t_table *table);
+void		chaos_point(t_table *table);
 
 // init.c
+int			parse_args(t_table *table, int argc, char **argv);
 int			init_table(t_table *table, int argc, char **argv);
 
 // init_core.c
 int			init_philos(t_table *table);
 int			init_mutexes(t_table *table);
+void		reset_philo(t_philo *philo);
 
 // init_forks.c
 int			init_fork_mutexes(t_table *table);
-void		destroy_n_fork_mutexes(t_table *table, int n);
+
+// arena.c
+int			arena_init(t_arena *arena, size_t size, int hugepages);
+void		*arena_alloc(t_arena *arena, size_t size, size_t align);
+void		arena_destroy(t_arena *arena);
+int			init_table_arena(t_table *table);
+
+// stats.c
+void		stats_begin_startup(t_table *table);
+void		stats_end_startup(t_table *table);
+void		stats_end_run(t_table *table);
+void		stats_record_overshoot(t_table *table, long long us);
+void		print_stats(t_table *table);
 
 // init_utility_mutexes.c
 int			init_utility_mutexes(t_table *table);
 
+// think_control.c
+long long	static_think_delay(t_philo *philo, long long time_since_last_meal);
+long long	adaptive_think_delay(t_philo *philo, long long time_since_last_meal);
+long long	base_think_delay(t_table *table);
+void		yield_to_hungrier_neighbour(t_philo *philo);
+
+// self_detect.c
+long long	death_deadline(t_philo *philo);
+int			lock_fork(t_philo *philo, pthread_mutex_t *fork);
+void		note_full(t_table *table);
+
+// shard.c
+int			init_shards(t_table *table);
+void		start_shards(t_table *table);
+void		*shard_routine(void *arg);
+void		shard_note_handoff(t_shard *s, long long sent_ns);
+
+// procs.c
+int			init_procs(t_table *table);
+int			run_procs(t_table *table);
+void		destroy_procs(t_table *table);
+int			proc_fork_take(t_shard *s, int f);
+void		proc_fork_put(t_shard *s, int f);
+void		proc_wait(t_shard *s, long long real_us);
+void		proc_print(t_table *table, const t_event *events, const char *buf,
+				const int *ends, int count, int died);
+void		proc_note_full(t_shard *s);
+
+// schedule.c
+int			init_schedule(t_table *table);
+void		start_schedule(t_table *table);
+void		schedule_release(t_philo *philo);
+void		*scheduled_routine(void *arg);
+
+// replay.c
+int			init_replay(t_table *table);
+void		destroy_replay(t_table *table);
+void		replay_record(t_table *table, int thread, int arg);
+void		replay_record_at(t_table *table, int thread, int arg,
+				long long time_us);
+void		replay_record_lines(t_table *table, int thread,
+				const t_event *events, int count);
+int			replay_take_lines(t_philo *philo, const t_event *events,
+				t_event *timed, int count);
+const t_replay_rec	*replay_turn(t_table *table, int thread);
+void		replay_diverged(t_table *table, const char *why);
+int			replay_fork(t_philo *philo, int fork);
+int			replay_fork_busy(t_philo *philo, int fork);
+long long	replay_sleep(t_philo *philo, long long time_us);
+void		*replay_monitor_routine(void *arg);
+
 // routine.c
 void		*philosopher_routine(void *arg);
 // actions.c
-void		take_forks(t_philo *philo);
+int			take_forks(t_philo *philo);
 void		drop_forks(t_philo *philo);
 void		eat(t_philo *philo);
 void		sleep_philo(t_philo *philo);
@@ -111,6 +880,30 @@ void		think(t_philo *philo);
 // monitoring.c
 void		*monitoring_routine(void *arg);
 int			check_death(t_philo *philo);
+int			declare_death(t_philo *philo, long long late_us);
 int			check_all_full(t_table *table);
 
+// monitor_events.c
+int			init_monitor_events(t_table *table);
+void		destroy_monitor_events(t_table *table);
+void		signal_monitor(t_table *table);
+long long	next_death_deadline(t_table *table);
+void		wait_for_deadline(t_table *table, long long deadline);
+
+// deadlock.c
+int			init_wait_for_graph(t_table *table);
+void		reset_wait_for_graph(t_table *table);
+void		wfg_wait(t_philo *philo, int fork, long long since);
+void		wfg_acquired(t_philo *philo, int fork);
+void		wfg_release(t_philo *philo, int fork);
+long long	detect_deadlock(t_table *table);
+
+// checkpoint.c
+int			init_checkpoint(t_table *table);
+void		destroy_checkpoint(t_table *table);
+void		checkpoint_safe_point(t_philo *philo);
+void		maybe_checkpoint(t_table *table);
+int			load_checkpoint(t_table *table);
+void		reset_checkpoint(t_table *table);
+
 #endif
@@ -0,0 +1,36 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   philo_chaos.h                                      :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: vrads <vrads@student.42.fr>                +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/07/12 10:05:51 by vrads             #+#    #+#             */
+/*   Updated: 2025/07/12 11:40:22 by vrads            ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef PHILO_CHAOS_H
+# define PHILO_CHAOS_H
+
+/*
+** Fault injection points for the chaos harness (bench/chaos_harness.sh).
+**
+** Built with `make CHAOS=1` or `make philo_chaos` (-DPHILO_CHAOS), each
+** PHILO_CHAOS_POINT() may yield the CPU or sleep, at random, as a loaded
+** host would preempt the thread there. What happens is set at run time:
+**   PHILO_CHAOS="yield=0.05,sleep=0.01,max=2ms,seed=42" ./philo_chaos ...
+** yield/sleep are probabilities per point, max bounds each sleep (see
+** chaos.c). In a normal build the macro expands to nothing.
+**
+** Points: take_forks() before the first fork and while holding it,
+** precise_usleep() at every step, the timer wheel after each wake-up.
+*/
+
+# ifdef PHILO_CHAOS
+#  define PHILO_CHAOS_POINT(table) chaos_point(table)
+# else
+#  define PHILO_CHAOS_POINT(table)
+# endif
+
+#endif
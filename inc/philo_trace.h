@@ -0,0 +1,51 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   philo_trace.h                                      :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: vrads <vrads@student.42.fr>                +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/06/27 10:22:40 by vrads             #+#    #+#             */
+/*   Updated: 2025/06/27 16:41:55 by vrads            ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef PHILO_TRACE_H
+# define PHILO_TRACE_H
+
+/*
+** Static tracepoints (USDT, provider "philo") on the hot path.
+**
+** Built with `make TRACE=1` (-DPHILO_USDT), each PHILO_TRACEn() becomes a
+** <sys/sdt.h> probe: a single nop plus an ELF note that perf/bpftrace/
+** SystemTap use to attach, e.g.
+**   perf buildid-cache --add ./philo
+**   perf record -e 'sdt_philo:*' ./philo 5 800 200 200
+**   perf script | tools/trace_timeline.py --die 800
+** In a normal build the macros expand to nothing and their arguments are
+** not evaluated, so the probes cost nothing.
+**
+** Probes:
+**   fork_request(id, fork)  fork_acquire(id, fork)  fork_release(id, fork)
+**   eat_start(id)   eat_end(id)     sleep_start(id)  sleep_end(id)
+**   think_start(id) think_end(id)   monitor_scan(num_philos, deadline_us)
+*/
+
+# ifdef PHILO_USDT
+#  if defined(__has_include)
+#   if !__has_include(<sys/sdt.h>)
+#    error "TRACE=1 needs <sys/sdt.h> (systemtap-sdt-dev / systemtap-sdt-devel)"
+#   endif
+#  endif
+#  include <sys/sdt.h>
+#  define PHILO_TRACE1(name, a) DTRACE_PROBE1(philo, name, a)
+#  define PHILO_TRACE2(name, a, b) DTRACE_PROBE2(philo, name, a, b)
+# else
+#  define PHILO_TRACE1(name, a)
+#  define PHILO_TRACE2(name, a, b)
+# endif
+
+// Index of a fork in `table->forks`, as reported by the fork tracepoints
+# define PHILO_FORK_IDX(philo, fork) ((int)((fork) - (philo)->table->forks))
+
+#endif
@@ -6,7 +6,7 @@
 /*   By: vrads <vrads@student.42.fr>                +#+  +:+       +#+        */
 /*                                                +#+#+#+#+#+   +#+           */
 /*   Created: 2025/06/17 16:06:08 by vrads             #+#    #+#             */
-/*   Updated: 2025/06/17 16:06:09 by vrads            ###   ########.fr       */
+/*   Updated: 2025/07/15 17:30:31 by vrads            ###   ########.fr       */
 /*                                                                            */
 /* ************************************************************************** */
 
@@ -18,14 +18,36 @@
  * Unlocks the right fork first (if it exists and is held), then the left fork.
  * This order helps in preventing deadlocks, though primary deadlock prevention
  * is handled by the fork acquisition order in `take_forks`.
+ * Each fork is marked free in the wait-for graph just before its unlock,
+ * and fires the `fork_release` tracepoint.
  *
  * @param philo Pointer to the t_philo structure representing the philosopher.
  */
 void	drop_forks(t_philo *philo)
 {
 	if (philo->right_fork)
+	{
+		wfg_release(philo, PHILO_FORK_IDX(philo, philo->right_fork));
 		pthread_mutex_unlock(philo->right_fork);
+		PHILO_TRACE2(fork_release, philo->id,
+			PHILO_FORK_IDX(philo, philo->right_fork));
+	}
+	wfg_release(philo, PHILO_FORK_IDX(philo, philo->left_fork));
 	pthread_mutex_unlock(philo->left_fork);
+	PHILO_TRACE2(fork_release, philo->id,
+		PHILO_FORK_IDX(philo, philo->left_fork));
+}
+
+/**
+ * @brief Queues a "has taken a fork" line, to be printed by `eat()`.
+ *
+ * @param philo Pointer to the t_philo structure representing the philosopher.
+ */
+static void	defer_fork_status(t_philo *philo)
+{
+	philo->pending[philo->pending_count].time_us = get_time_us();
+	philo->pending[philo->pending_count].status = "has taken a fork";
+	philo->pending_count++;
 }
 
 /**
@@ -35,58 +57,139 @@ void	drop_forks(t_philo *philo)
  * fork acquisition based on philosopher ID (even/odd).
  * Even ID philosophers pick left then right.
  * Odd ID philosophers pick right then left.
- * Prints a status message after acquiring each fork.
+ * The "has taken a fork" lines are not printed here: they are queued with
+ * their timestamps and printed by `eat()` in the same record as
+ * "is eating". If the second fork is busy, the first line is printed
+ * right away instead, so a philosopher who waits (or dies waiting) still
+ * shows the fork they hold.
+ * Fires `fork_request` before and `fork_acquire` after each lock, so a
+ * trace shows how long the philosopher waited on every fork. The total
+ * wait is kept in `fork_wait_us` for the adaptive think controller.
+ * Every wait and acquisition is also recorded in the wait-for graph
+ * (deadlock.c) for the monitor's deadlock detector.
+ * Chaos points (philo_chaos.h) sit before the first lock and while the
+ * first fork is held, where preemption hurts the neighbours most.
+ * With `--detect=self`, both locks give up at the philosopher's death
+ * deadline (`lock_fork`); it then holds no fork.
+ * With `--record` each fork taken is logged while held; with `--replay`
+ * each lock first waits for its turn in the log (replay.c).
  *
  * @param philo Pointer to the t_philo structure representing the philosopher.
+ * @return 0 with both forks held, 1 if the philosopher died waiting.
  */
-void	take_forks(t_philo *philo)
+int	take_forks(t_philo *philo)
 {
+	pthread_mutex_t	*first;
+	pthread_mutex_t	*second;
+	long long		wait_start;
+
+	wait_start = get_time_us();
+	philo->pending_count = 0;
+	first = philo->right_fork;
+	second = philo->left_fork;
 	if (philo->id % 2 == 0)
 	{
-		pthread_mutex_lock(philo->left_fork);
-		print_status(philo, "has taken a fork", 0);
-		pthread_mutex_lock(philo->right_fork);
-		print_status(philo, "has taken a fork", 0);
+		first = philo->left_fork;
+		second = philo->right_fork;
 	}
-	else
+	PHILO_TRACE2(fork_request, philo->id, PHILO_FORK_IDX(philo, first));
+	PHILO_CHAOS_POINT(philo->table);
+	wfg_wait(philo, PHILO_FORK_IDX(philo, first), wait_start);
+	if (replay_fork(philo, PHILO_FORK_IDX(philo, first))
+		|| lock_fork(philo, first) != 0)
+		return (1);
+	wfg_acquired(philo, PHILO_FORK_IDX(philo, first));
+	replay_record(philo->table, philo->id, PHILO_FORK_IDX(philo, first));
+	PHILO_TRACE2(fork_acquire, philo->id, PHILO_FORK_IDX(philo, first));
+	PHILO_CHAOS_POINT(philo->table);
+	defer_fork_status(philo);
+	PHILO_TRACE2(fork_request, philo->id, PHILO_FORK_IDX(philo, second));
+	if (replay_fork_busy(philo, PHILO_FORK_IDX(philo, second))
+		|| pthread_mutex_trylock(second) != 0)
 	{
-		pthread_mutex_lock(philo->right_fork);
-		print_status(philo, "has taken a fork", 0);
-		pthread_mutex_lock(philo->left_fork);
-		print_status(philo, "has taken a fork", 0);
+		print_events(philo, philo->pending, philo->pending_count, 0);
+		philo->pending_count = 0;
+		wfg_wait(philo, PHILO_FORK_IDX(philo, second), wait_start);
+		if (replay_fork(philo, PHILO_FORK_IDX(philo, second))
+			|| lock_fork(philo, second) != 0)
+		{
+			wfg_release(philo, PHILO_FORK_IDX(philo, first));
+			pthread_mutex_unlock(first);
+			return (1);
+		}
 	}
+	wfg_acquired(philo, PHILO_FORK_IDX(philo, second));
+	replay_record(philo->table, philo->id, PHILO_FORK_IDX(philo, second));
+	PHILO_TRACE2(fork_acquire, philo->id, PHILO_FORK_IDX(philo, second));
+	philo->fork_wait_us = get_time_us() - wait_start;
+	defer_fork_status(philo);
+	return (0);
 }
 
 /**
  * @brief Simulates a philosopher eating.
  *
  * If the simulation is not over, this function:
- * 1. Prints an "is eating" status.
+ * 1. Prints an "is eating" status, in one record with the fork lines
+ *    queued by `take_forks`.
  * 2. Updates the philosopher's state to EATING.
- * 3. Locks the meal_time_mutex to safely update `last_meal_time` and `meals_eaten`.
- * 4. Simulates the eating duration using `precise_usleep`.
- * 5. Calls `drop_forks` to release the forks.
- * 6. Sets the philosopher's state to SLEEPING.
+ * 3. Locks the meal_time_mutex to safely update `last_meal_time` and `meals_eaten`,
+ *    recording the slack left before this meal in `min_slack_us`.
+ *    If this philosopher owned the earliest death deadline, or just became
+ *    full, the monitor is woken so it can re-arm its timer.
+ * 4. Simulates the eating duration using `philo_sleep`, and records how
+ *    much longer than `time_to_eat` the meal took for `--stats`.
+ * 5. Calls `drop_forks` to release the forks, or `schedule_release` with
+ *    `--scheduled`, where no fork mutex is held.
+ * 6. Sets the philosopher's state to SLEEPING. With no fork held, this is
+ *    a checkpoint safe point, which keeps the philosopher's phase in the
+ *    snapshot.
  *
  * @param philo Pointer to the t_philo structure representing the philosopher.
  */
 void	eat(t_philo *philo)
 {
+	long long	now;
+
 	if (is_simulation_over(philo->table))
 		return ;
 
-	print_status(philo, "is eating", 0);
+	PHILO_TRACE1(eat_start, philo->id);
+	philo->pending[philo->pending_count].time_us = get_time_us();
+	philo->pending[philo->pending_count].status = "is eating";
+	print_events(philo, philo->pending, philo->pending_count + 1, 0);
+	philo->pending_count = 0;
 	philo->state = EATING;
 
 	pthread_mutex_lock(&philo->table->meal_time_mutex);
-	philo->last_meal_time = get_time_ms();
+	now = get_time_us();
+	if (philo->table->time_to_die - (now - philo->last_meal_time)
+		< philo->min_slack_us)
+		philo->min_slack_us = philo->table->time_to_die
+			- (now - philo->last_meal_time);
+	__atomic_store_n(&philo->last_meal_time, now, __ATOMIC_RELEASE);
 	philo->meals_eaten++;
 	pthread_mutex_unlock(&philo->table->meal_time_mutex);
+	if (philo->table->opts.detect_mode == DETECT_SELF)
+	{
+		if (philo->meals_eaten == philo->table->num_must_eat)
+			note_full(philo->table);
+	}
+	else if (__atomic_load_n(&philo->table->deadline_owner, __ATOMIC_ACQUIRE)
+		== philo->id || philo->meals_eaten == philo->table->num_must_eat)
+		signal_monitor(philo->table);
 
-	precise_usleep(philo->table->time_to_eat, philo->table);
+	if (philo_sleep(philo, philo->table->time_to_eat) >= 0)
+		stats_record_overshoot(philo->table,
+			get_time_us() - now - philo->table->time_to_eat);
+	PHILO_TRACE1(eat_end, philo->id);
 
-	drop_forks(philo);
+	if (philo->table->opts.scheduled)
+		schedule_release(philo);
+	else
+		drop_forks(philo);
 	philo->state = SLEEPING;
+	checkpoint_safe_point(philo);
 }
 
 /**
@@ -94,7 +197,7 @@ void	eat(t_philo *philo)
  *
  * If the simulation is not over, this function:
  * 1. Prints an "is sleeping" status.
- * 2. Simulates the sleeping duration using `precise_usleep`.
+ * 2. Simulates the sleeping duration using `philo_sleep`.
  * The philosopher's state is expected to be set to SLEEPING prior to calling this,
  * typically after eating.
  *
@@ -104,8 +207,10 @@ void	sleep_philo(t_philo *philo)
 {
 	if (is_simulation_over(philo->table))
 		return ;
+	PHILO_TRACE1(sleep_start, philo->id);
 	print_status(philo, "is sleeping", 0);
-	precise_usleep(philo->table->time_to_sleep, philo->table);
+	philo_sleep(philo, philo->table->time_to_sleep);
+	PHILO_TRACE1(sleep_end, philo->id);
 }
 
 /**
@@ -114,9 +219,15 @@ void	sleep_philo(t_philo *philo)
  * If the simulation is not over, this function:
  * 1. Prints an "is thinking" status.
  * 2. Sets the philosopher's state to THINKING.
- * 3. Optionally, introduces a small delay to make thinking phase more explicit
- *    and to potentially improve fairness if `time_to_eat > time_to_sleep`.
- *    This delay is calculated to be short and not cause starvation.
+ * 3. Optionally, introduces a delay before the philosopher competes for
+ *    forks again. With `--think=static`, `static_think_delay` sleeps a short
+ *    fixed time if `time_to_eat > time_to_sleep`; with `--think=adaptive`
+ *    (the default), `adaptive_think_delay` derives it from the observed
+ *    fork waits and the remaining slack, then lets a hungrier neighbour
+ *    go first (`yield_to_hungrier_neighbour`). Neither can cause starvation.
+ *    A zero delay still goes through `philo_sleep`, so `--record` logs
+ *    every think phase; `--replay` skips the yield, whose outcome is
+ *    already in the log.
  *
  * @param philo Pointer to the t_philo structure representing the philosopher.
  */
@@ -127,18 +238,22 @@ void	think(t_philo *philo)
 
 	if (is_simulation_over(philo->table))
 		return ;
+	PHILO_TRACE1(think_start, philo->id);
 	print_status(philo, "is thinking", 0);
 	philo->state = THINKING;
-	if (philo->table->num_philos > 1 && philo->table->time_to_eat > philo->table->time_to_sleep)
+	if (philo->table->num_philos > 1)
 	{
-		think_time = (philo->table->time_to_eat - philo->table->time_to_sleep) / 2;
-		if (think_time <=0) think_time = 1;
 		pthread_mutex_lock(&philo->table->meal_time_mutex);
-		time_since_last_meal = get_time_ms() - philo->last_meal_time;
+		time_since_last_meal = get_time_us() - philo->last_meal_time;
 		pthread_mutex_unlock(&philo->table->meal_time_mutex);
-		if (time_since_last_meal + think_time < philo->table->time_to_die)
-		{
-			precise_usleep(think_time, philo->table);
-		}
+		if (philo->table->opts.think_mode == THINK_ADAPTIVE)
+			think_time = adaptive_think_delay(philo, time_since_last_meal);
+		else
+			think_time = static_think_delay(philo, time_since_last_meal);
+		philo_sleep(philo, think_time);
+		if (philo->table->opts.think_mode == THINK_ADAPTIVE
+			&& !philo->table->replay.replaying)
+			yield_to_hungrier_neighbour(philo);
 	}
+	PHILO_TRACE1(think_end, philo->id);
 }
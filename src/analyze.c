@@ -0,0 +1,262 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   analyze.c                                          :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: vrads <vrads@student.42.fr>                +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/07/12 14:12:45 by vrads             #+#    #+#             */
+/*   Updated: 2025/07/15 11:04:26 by vrads            ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "philo.h"
+
+/*
+** --analyze: the schedule the fork order and the think delay lead to,
+** computed from the arguments alone.
+**
+** take_forks() has odd ids lock right first and even ids left first, so
+** with even N the two parities take turns and a philosopher can eat
+** every 2 * time_to_eat. With odd N, philosopher N is odd like its
+** neighbour 1 and has to wait for a third turn: 3 * time_to_eat. That
+** rotation is the fastest pace; a philosopher whose own cycle (eat +
+** sleep + think) is longer sets a slower one. It then starves if the
+** period between two meal starts reaches time_to_die. On average odd
+** tables do better: the third turn moves around the table, so meals
+** start every N * time_to_eat / floor(N/2) (base_think_delay's cycle),
+** which is what the throughput follows.
+** With odd N and a cycle shorter than the rotation, philosophers come
+** back hungry before their turn and race for forks; losing one race costs
+** one more time_to_eat. A table that only survives if no race is lost is
+** reported as at risk, as is one with less than THINK_GUARD_US of slack.
+*/
+
+static const char	*g_verdicts[] = {"survives", "at_risk", "dies"};
+
+/**
+ * @brief Think delay of the steady state, as `think()` would pick it.
+ *
+ * At that point the last meal started eat + sleep ago. The adaptive
+ * controller settles on its structural delay when fork waits vanish,
+ * within the limit it keeps before `time_to_die`.
+ *
+ * @param table Pointer to the t_table structure (arguments parsed).
+ * @return The think delay in simulated microseconds.
+ */
+static long long	steady_think(t_table *table)
+{
+	t_philo		philo;
+	long long	since_meal;
+	long long	think;
+	long long	limit;
+
+	since_meal = table->time_to_eat + table->time_to_sleep;
+	if (table->opts.think_mode == THINK_STATIC)
+	{
+		memset(&philo, 0, sizeof(philo));
+		philo.table = table;
+		return (static_think_delay(&philo, since_meal));
+	}
+	think = base_think_delay(table);
+	limit = table->time_to_die - since_meal - THINK_GUARD_US;
+	if (think > limit)
+		think = limit;
+	if (think < 0)
+		think = 0;
+	return (think);
+}
+
+/**
+ * @brief When each group of philosophers starts its first meal.
+ *
+ * Odd ids eat at once; even ids are staggered and wait for the odd
+ * neighbours; with odd N, id N waits for both of its (odd and even)
+ * neighbours.
+ *
+ * @param table Pointer to the t_table structure.
+ * @param a The analysis to fill.
+ * @return The latest first meal.
+ */
+static long long	first_meals(t_table *table, t_analysis *a)
+{
+	a->first_meal_us[0] = 0;
+	a->first_meal_us[1] = table->time_to_eat;
+	a->first_meal_us[2] = -1;
+	if (table->num_philos % 2 == 0)
+		return (a->first_meal_us[1]);
+	a->first_meal_us[2] = 2 * table->time_to_eat;
+	return (a->first_meal_us[2]);
+}
+
+/**
+ * @brief Picks the verdict from the slacks.
+ *
+ * @param table Pointer to the t_table structure.
+ * @param a The analysis, slacks filled in.
+ */
+static void	set_verdict(t_table *table, t_analysis *a)
+{
+	long long	last_first;
+
+	last_first = a->first_meal_us[1];
+	if (a->first_meal_us[2] > last_first)
+		last_first = a->first_meal_us[2];
+	a->min_slack_us = a->slack_us;
+	if (a->contended_slack_us < a->min_slack_us)
+		a->min_slack_us = a->contended_slack_us;
+	if (table->time_to_die - last_first < a->min_slack_us)
+		a->min_slack_us = table->time_to_die - last_first;
+	if (a->slack_us <= 0 || table->time_to_die - last_first <= 0)
+		a->verdict = VERDICT_DIES;
+	else if (a->min_slack_us < THINK_GUARD_US)
+		a->verdict = VERDICT_AT_RISK;
+	else
+		a->verdict = VERDICT_SURVIVES;
+}
+
+/**
+ * @brief Computes the steady-state schedule of the table.
+ *
+ * A lone philosopher has one fork and dies at `time_to_die`.
+ *
+ * @param table Pointer to the t_table structure (arguments and options
+ *        parsed, nothing else needed).
+ * @param a The analysis to fill.
+ */
+void	analyze_table(t_table *table, t_analysis *a)
+{
+	long long	last_first;
+	long long	diners;
+
+	memset(a, 0, sizeof(*a));
+	a->duration_us = -1;
+	if (table->num_philos < 2)
+	{
+		a->period_us = -1;
+		a->min_slack_us = 0;
+		a->first_meal_us[1] = -1;
+		a->first_meal_us[2] = -1;
+		a->verdict = VERDICT_DIES;
+		return ;
+	}
+	a->think_us = steady_think(table);
+	a->cycle_us = table->time_to_eat + table->time_to_sleep + a->think_us;
+	a->rotation_us = (2 + table->num_philos % 2) * table->time_to_eat;
+	a->period_us = a->rotation_us;
+	if (a->cycle_us > a->period_us)
+		a->period_us = a->cycle_us;
+	diners = table->num_philos / 2;
+	a->mean_period_us = (table->num_philos * table->time_to_eat + diners - 1)
+		/ diners;
+	if (a->cycle_us > a->mean_period_us)
+		a->mean_period_us = a->cycle_us;
+	a->slack_us = table->time_to_die - a->period_us;
+	a->contended_slack_us = a->slack_us;
+	if (table->num_philos % 2 && a->cycle_us < a->rotation_us)
+		a->contended_slack_us -= table->time_to_eat;
+	last_first = first_meals(table, a);
+	set_verdict(table, a);
+	a->meals_per_sec = table->num_philos * 1e6 / a->mean_period_us;
+	a->max_meals_per_sec = (table->num_philos / 2) * 1e6 / table->time_to_eat;
+	if (table->num_must_eat > 0)
+		a->duration_us = last_first
+			+ (table->num_must_eat - 1LL) * a->mean_period_us;
+}
+
+/**
+ * @brief Prints an analysis, one `predicted_key=value` per line.
+ *
+ * @param table Pointer to the t_table structure.
+ * @param a The analysis.
+ * @param out Where to print it.
+ */
+static void	print_analysis(t_table *table, t_analysis *a, FILE *out)
+{
+	fprintf(out, "predicted_verdict=%s\n", g_verdicts[a->verdict]);
+	if (table->num_philos < 2)
+	{
+		fprintf(out, "predicted_death_us=%lld\n", table->time_to_die);
+		return ;
+	}
+	fprintf(out, "predicted_think_us=%lld\n", a->think_us);
+	fprintf(out, "predicted_cycle_us=%lld\n", a->cycle_us);
+	fprintf(out, "predicted_rotation_us=%lld\n", a->rotation_us);
+	fprintf(out, "predicted_period_us=%lld\n", a->period_us);
+	fprintf(out, "predicted_mean_period_us=%lld\n", a->mean_period_us);
+	fprintf(out, "predicted_first_meal_odd_us=%lld\n", a->first_meal_us[0]);
+	fprintf(out, "predicted_first_meal_even_us=%lld\n", a->first_meal_us[1]);
+	if (a->first_meal_us[2] >= 0)
+		fprintf(out, "predicted_first_meal_last_us=%lld\n",
+			a->first_meal_us[2]);
+	fprintf(out, "predicted_slack_us=%lld\n", a->slack_us);
+	fprintf(out, "predicted_contended_slack_us=%lld\n",
+		a->contended_slack_us);
+	fprintf(out, "predicted_min_slack_us=%lld\n", a->min_slack_us);
+	fprintf(out, "predicted_meals_per_sec=%.1f\n", a->meals_per_sec);
+	fprintf(out, "predicted_max_meals_per_sec=%.1f\n", a->max_meals_per_sec);
+	if (a->duration_us >= 0)
+		fprintf(out, "predicted_duration_us=%lld\n", a->duration_us);
+}
+
+/**
+ * @brief `--analyze`: prints the prediction and exits, no thread started.
+ *
+ * The arguments go through the same checks as for a run (`parse_args`).
+ *
+ * @param table Pointer to the t_table structure (options parsed).
+ * @param argc Argument count (5 or 6).
+ * @param argv Positional arguments.
+ * @return 0 on success, 1 on invalid arguments.
+ */
+int	analyze_only(t_table *table, int argc, char **argv)
+{
+	if (parse_args(table, argc, argv) != 0)
+		return (1);
+	analyze_table(table, &table->analysis);
+	print_analysis(table, &table->analysis, stdout);
+	return (0);
+}
+
+/**
+ * @brief `--analyze=run`: prints the prediction to stderr before the run.
+ *
+ * @param table Pointer to the t_table structure (initialized).
+ */
+void	analyze_begin(t_table *table)
+{
+	if (table->opts.analyze != ANALYZE_RUN)
+		return ;
+	analyze_table(table, &table->analysis);
+	print_analysis(table, &table->analysis, stderr);
+	table->analysis.run_begin_us = real_time_us();
+}
+
+/**
+ * @brief `--analyze=run`: prints what the runs did next to the prediction.
+ *
+ * Throughput and duration are per run, in simulated time, thread
+ * start-up included. A table at risk matches either outcome.
+ *
+ * @param table Pointer to the t_table structure, all runs finished.
+ */
+void	analyze_end(t_table *table)
+{
+	t_analysis	*a;
+	double		sim_us;
+	int			died;
+
+	a = &table->analysis;
+	if (table->opts.analyze != ANALYZE_RUN || table->stats.runs == 0)
+		return ;
+	sim_us = (real_time_us() - a->run_begin_us) / table->opts.time_scale
+		/ table->stats.runs;
+	died = table->stats.death_latency_us >= 0;
+	fprintf(stderr, "observed_outcome=%s\n", died ? "died" : "survived");
+	fprintf(stderr, "observed_min_slack_us=%lld\n", table->stats.min_slack_us);
+	fprintf(stderr, "observed_meals_per_sec=%.1f\n",
+		(double)table->stats.meals / table->stats.runs * 1e6 / sim_us);
+	fprintf(stderr, "observed_duration_us=%.0f\n", sim_us);
+	fprintf(stderr, "prediction_matched=%d\n", a->verdict == VERDICT_AT_RISK
+		|| died == (a->verdict == VERDICT_DIES));
+}
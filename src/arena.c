@@ -0,0 +1,171 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   arena.c                                            :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: vrads <vrads@student.42.fr>                +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/06/25 09:14:26 by vrads             #+#    #+#             */
+/*   Updated: 2025/07/15 16:57:21 by vrads            ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "philo.h"
+
+/**
+ * @brief Maps a page-aligned, zero-filled region for the arena.
+ *
+ * With `hugepages` set, explicit huge pages (`MAP_HUGETLB`) are tried
+ * first; if none are reserved on the host, a regular mapping is used and
+ * transparent huge pages are requested with `madvise`. Regular mappings
+ * use `MAP_NORESERVE`: thread stacks are mostly untouched, so large tables
+ * should not be refused by overcommit accounting for memory never used.
+ *
+ * @param arena Pointer to the t_arena structure to initialize.
+ * @param size Requested size in bytes (rounded up to the page size).
+ * @param hugepages Non-zero to back the arena with huge pages if possible.
+ * @return 0 on success, 1 if the mapping failed.
+ */
+int	arena_init(t_arena *arena, size_t size, int hugepages)
+{
+	size_t	page;
+
+	page = sysconf(_SC_PAGESIZE);
+	arena->size = (size + page - 1) / page * page;
+	arena->used = 0;
+	arena->hugepages = 0;
+	arena->base = MAP_FAILED;
+	if (hugepages)
+	{
+		arena->size = (arena->size + ARENA_HUGE_PAGE - 1)
+			/ ARENA_HUGE_PAGE * ARENA_HUGE_PAGE;
+		arena->base = mmap(NULL, arena->size, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		arena->hugepages = (arena->base != MAP_FAILED);
+	}
+	if (arena->base == MAP_FAILED)
+		arena->base = mmap(NULL, arena->size, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (arena->base == MAP_FAILED)
+	{
+		arena->base = NULL;
+		return (1);
+	}
+	if (hugepages && !arena->hugepages)
+		madvise(arena->base, arena->size, MADV_HUGEPAGE);
+	return (0);
+}
+
+/**
+ * @brief Carves `size` bytes aligned to `align` out of the arena.
+ *
+ * There is no per-allocation free: everything is released at once by
+ * `arena_destroy`.
+ *
+ * @param arena Pointer to an initialized t_arena structure.
+ * @param size Number of bytes to allocate.
+ * @param align Required alignment (a power of two).
+ * @return Pointer to zero-filled memory, or NULL if the arena is exhausted.
+ */
+void	*arena_alloc(t_arena *arena, size_t size, size_t align)
+{
+	size_t	offset;
+
+	offset = (arena->used + align - 1) & ~(align - 1);
+	if (!arena->base || offset + size > arena->size)
+		return (NULL);
+	arena->used = offset + size;
+	return (arena->base + offset);
+}
+
+/**
+ * @brief Unmaps the arena. Safe to call on an arena that was never mapped.
+ *
+ * @param arena Pointer to the t_arena structure.
+ */
+void	arena_destroy(t_arena *arena)
+{
+	if (arena->base)
+		munmap(arena->base, arena->size);
+	arena->base = NULL;
+	arena->size = 0;
+	arena->used = 0;
+}
+
+/**
+ * @brief Computes how much memory the table needs, with alignment slack.
+ *
+ * The arena holds:
+ * - the philosophers;
+ * - the fork mutexes;
+ * - the two arrays of the wait-for graph;
+ * - the pool workers, one per philosopher plus the monitor and the timer
+ *   service, or one per shard with `--shards`;
+ * - a stack for each worker, above a guard page;
+ * - the output buffers, unless `--sink=stdio`;
+ * - the log ring, with `--log=drop|sample`, `--compress` or `--realtime`;
+ * - the raw and compressed frame buffers, with `--compress`;
+ * - the shards and their per-fork state, with `--shards`;
+ * - the turn counters, with `--replay`;
+ * - the sockets, pids and per-child state, with `--procs`.
+ *
+ * @param table Pointer to the t_table structure (arguments parsed).
+ * @return Size in bytes to pass to `arena_init`.
+ */
+static size_t	table_arena_size(t_table *table)
+{
+	t_options	*opts;
+	size_t		n;
+	size_t		page;
+	size_t		threads;
+	size_t		size;
+
+	opts = &table->opts;
+	n = table->num_philos;
+	page = sysconf(_SC_PAGESIZE);
+	threads = n + 2;
+	if (opts->shards)
+		threads = opts->shards;
+	size = n * sizeof(t_philo) + ARENA_LINE;
+	size += n * sizeof(pthread_mutex_t) + ARENA_LINE;
+	size += 2 * (n * sizeof(int) + ARENA_LINE);
+	size += threads * sizeof(t_worker) + ARENA_LINE;
+	size += threads * (page + PHILO_STACK_SIZE) + page;
+	if (opts->sink_mode != SINK_STDIO)
+		size += (size_t)SINK_BUFFERS * SINK_BUFFER_SIZE + page;
+	if (opts->log_mode != LOG_BLOCK || opts->compress || opts->realtime)
+		size += LOG_RING_SIZE + page;
+	if (opts->compress)
+		size += TRACE_FRAME_RAW + LZ_BOUND(TRACE_FRAME_RAW) + 2 * ARENA_LINE;
+	if (opts->shards)
+		size += opts->shards * sizeof(t_shard) + n * (sizeof(uint32_t)
+				+ 2 * sizeof(int) + 2 * sizeof(long long)) + 4 * ARENA_LINE;
+	if (opts->replay_file)
+		size += (n + 1) * sizeof(uint32_t) + ARENA_LINE;
+	if (opts->procs)
+		size += opts->procs * (4 * sizeof(int) + sizeof(pid_t)
+				+ sizeof(struct pollfd) + sizeof(t_proc_child))
+			+ 4 * ARENA_LINE;
+	return (size);
+}
+
+/**
+ * @brief Maps the arena holding all per-philosopher simulation state.
+ *
+ * Per-philosopher arrays are carved from it by `init_fork_mutexes`,
+ * `init_philos` and `create_philosopher_threads`; `cleanup` releases it.
+ *
+ * @param table Pointer to the t_table structure (arguments parsed).
+ * @return 0 on success, 1 if the arena could not be mapped.
+ */
+int	init_table_arena(t_table *table)
+{
+	if (arena_init(&table->arena, table_arena_size(table),
+			table->opts.hugepages) != 0)
+	{
+		printf("Error: Could not map memory for %d philosophers.\n",
+			table->num_philos);
+		return (1);
+	}
+	return (0);
+}
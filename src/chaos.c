@@ -0,0 +1,195 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   chaos.c                                            :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: vrads <vrads@student.42.fr>                +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/07/12 10:18:37 by vrads             #+#    #+#             */
+/*   Updated: 2025/07/12 11:40:22 by vrads            ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "philo.h"
+
+/*
+** Fault injection for the chaos harness. PHILO_CHAOS_POINT() (see
+** philo_chaos.h) calls chaos_point() in a -DPHILO_CHAOS build, which
+** yields or sleeps at random to stand in for a host that preempts the
+** thread at that point. The draw is a per-thread xorshift, so points do
+** not share a cache line; the seed makes the injection rate, not the
+** interleaving, reproducible.
+*/
+
+#define CHAOS_SPEC_MAX 256
+
+static __thread uint64_t	g_chaos_rng;
+
+/**
+ * @brief Converts a probability in [0, 1] into a 32-bit draw threshold.
+ *
+ * @param s The probability, as a decimal number.
+ * @param out Receives the threshold (out of 2^32).
+ * @return 0 on success, 1 if `s` is not a number in [0, 1].
+ */
+static int	parse_probability(const char *s, uint64_t *out)
+{
+	char	*end;
+	double	p;
+
+	errno = 0;
+	p = strtod(s, &end);
+	if (end == s || *end || errno || !(p >= 0.0 && p <= 1.0))
+		return (1);
+	*out = (uint64_t)(p * 4294967296.0);
+	return (0);
+}
+
+/**
+ * @brief Applies one `key=value` pair of PHILO_CHAOS.
+ *
+ * @param c The chaos settings.
+ * @param item The pair (modified in place).
+ * @param yield Receives the yield threshold.
+ * @param sleep Receives the sleep threshold.
+ * @return 0 on success, 1 on an unknown key or a bad value.
+ */
+static int	chaos_item(t_chaos *c, char *item, uint64_t *yield,
+		uint64_t *sleep)
+{
+	char		*val;
+	long long	n;
+
+	val = strchr(item, '=');
+	if (!val)
+		return (1);
+	*val++ = '\0';
+	if (strcmp(item, "yield") == 0)
+		return (parse_probability(val, yield));
+	if (strcmp(item, "sleep") == 0)
+		return (parse_probability(val, sleep));
+	if (strcmp(item, "max") == 0)
+		return (parse_duration(val, &c->sleep_max_us)
+			|| c->sleep_max_us < 1);
+	if (strcmp(item, "seed") == 0)
+	{
+		if (parse_count(val, LLONG_MAX, &n) != 0)
+			return (1);
+		c->seed = n;
+		return (0);
+	}
+	return (1);
+}
+
+/**
+ * @brief Parses `yield=P,sleep=P,max=DURATION,seed=N` into `c`.
+ *
+ * @param c The chaos settings.
+ * @param spec The value of PHILO_CHAOS.
+ * @return 0 on success, 1 on a malformed spec.
+ */
+static int	chaos_parse(t_chaos *c, const char *spec)
+{
+	char		buf[CHAOS_SPEC_MAX];
+	char		*item;
+	char		*next;
+	uint64_t	yield;
+	uint64_t	sleep;
+
+	if (strlen(spec) >= sizeof(buf))
+		return (1);
+	strcpy(buf, spec);
+	yield = 0;
+	sleep = 0;
+	item = buf;
+	while (item && *item)
+	{
+		next = strchr(item, ',');
+		if (next)
+			*next++ = '\0';
+		if (chaos_item(c, item, &yield, &sleep) != 0)
+			return (1);
+		item = next;
+	}
+	if (yield + sleep > 4294967296ULL)
+		return (1);
+	c->yield_below = yield > UINT32_MAX ? UINT32_MAX : yield;
+	c->sleep_below = yield + sleep > UINT32_MAX
+		? UINT32_MAX : yield + sleep;
+	return (0);
+}
+
+/**
+ * @brief Reads the PHILO_CHAOS environment variable.
+ *
+ * Defaults: no yields, no sleeps, `max=1ms`, `seed=1`. In a build
+ * without -DPHILO_CHAOS there are no injection points, so a valid
+ * spec only earns a warning.
+ *
+ * @param table Pointer to the t_table structure.
+ * @return 0 on success, 1 if PHILO_CHAOS is malformed.
+ */
+int	chaos_init(t_table *table)
+{
+	const char	*spec;
+	t_chaos		*c;
+
+	c = &table->chaos;
+	memset(c, 0, sizeof(*c));
+	c->sleep_max_us = 1000;
+	c->seed = 1;
+	spec = getenv("PHILO_CHAOS");
+	if (!spec)
+		return (0);
+	if (chaos_parse(c, spec) != 0)
+	{
+		fprintf(stderr, "Error: PHILO_CHAOS: expected "
+			"yield=P,sleep=P,max=DURATION,seed=N, got \"%s\".\n", spec);
+		return (1);
+	}
+#ifdef PHILO_CHAOS
+	c->enabled = 1;
+#else
+	fprintf(stderr, "Warning: PHILO_CHAOS ignored: build with "
+		"`make CHAOS=1` (or `make philo_chaos`).\n");
+#endif
+	return (0);
+}
+
+/**
+ * @brief Maybe yields or sleeps, as configured by PHILO_CHAOS.
+ *
+ * Sleeps last 1 µs to `max` of real time, uniformly: they stand for
+ * preemption by the host, which does not follow `--time-scale`.
+ *
+ * @param table Pointer to the t_table structure.
+ */
+void	chaos_point(t_table *table)
+{
+	t_chaos		*c;
+	uint64_t	x;
+	uint32_t	draw;
+
+	c = &table->chaos;
+	if (!c->enabled)
+		return ;
+	x = g_chaos_rng;
+	if (x == 0)
+		x = (c->seed ^ (uint64_t)(uintptr_t)&g_chaos_rng)
+			* 0x9E3779B97F4A7C15ULL | 1;
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	g_chaos_rng = x;
+	draw = (uint32_t)(x >> 32);
+	if (draw < c->yield_below)
+	{
+		sched_yield();
+		__atomic_fetch_add(&c->yields, 1, __ATOMIC_RELAXED);
+	}
+	else if (draw < c->sleep_below)
+	{
+		usleep(1 + (uint32_t)x % (uint64_t)c->sleep_max_us);
+		__atomic_fetch_add(&c->sleeps, 1, __ATOMIC_RELAXED);
+	}
+}
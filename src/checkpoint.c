@@ -0,0 +1,403 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   checkpoint.c                                       :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: vrads <vrads@student.42.fr>                +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/06/23 14:02:51 by vrads             #+#    #+#             */
+/*   Updated: 2025/07/06 15:37:09 by vrads            ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "philo.h"
+
+/*
+** Set from the SIGUSR1 handler. The handler also writes to the monitor's
+** eventfd (copied into `g_checkpoint_wake_fd`) so a monitor blocked in
+** epoll_wait notices the request immediately.
+*/
+static volatile sig_atomic_t	g_checkpoint_requested = 0;
+static int						g_checkpoint_wake_fd = -1;
+
+/**
+ * @brief SIGUSR1 handler: requests a checkpoint at the next safe point.
+ *
+ * Only async-signal-safe operations are used (flag store and `write`).
+ *
+ * @param sig The signal number (unused).
+ */
+static void	on_checkpoint_signal(int sig)
+{
+	uint64_t	one;
+
+	(void)sig;
+	g_checkpoint_requested = 1;
+	one = 1;
+	if (g_checkpoint_wake_fd >= 0)
+	{
+		if (write(g_checkpoint_wake_fd, &one, sizeof(one)) < 0)
+			return ;
+	}
+}
+
+/**
+ * @brief Prepares checkpoint support when `--checkpoint=FILE` is given.
+ *
+ * Initializes the pause mutex/condition used to park philosophers at the
+ * safe point, installs the SIGUSR1 handler and schedules the first
+ * periodic snapshot if `--checkpoint-interval` was set.
+ * Must run after `init_monitor_events` so the handler can wake the monitor.
+ *
+ * @param table Pointer to the t_table structure.
+ * @return 0 on success (or if checkpoints are disabled), 1 on error.
+ */
+int	init_checkpoint(t_table *table)
+{
+	struct sigaction	sa;
+
+	reset_checkpoint(table);
+	if (!table->opts.checkpoint_file)
+		return (0);
+	if (table->num_philos == 1)
+	{
+		printf("Error: Checkpoints need at least 2 philosophers.\n");
+		return (1);
+	}
+	if (pthread_mutex_init(&table->pause_mutex, NULL) != 0)
+		return (1);
+	if (pthread_cond_init(&table->pause_cond, NULL) != 0)
+	{
+		pthread_mutex_destroy(&table->pause_mutex);
+		return (1);
+	}
+	table->pause_sync_initialized = 1;
+	g_checkpoint_wake_fd = table->monitor_wake_fd;
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = on_checkpoint_signal;
+	sigemptyset(&sa.sa_mask);
+	sa.sa_flags = SA_RESTART;
+	sigaction(SIGUSR1, &sa, NULL);
+	return (0);
+}
+
+/**
+ * @brief Clears the pause state and schedules the first periodic snapshot.
+ *
+ * Called at initialization and before every warm restart (`--repeat`).
+ *
+ * @param table Pointer to the t_table structure.
+ */
+void	reset_checkpoint(t_table *table)
+{
+	table->pause_requested = 0;
+	table->paused_count = 0;
+	table->next_checkpoint = -1;
+	if (table->opts.checkpoint_file && table->opts.checkpoint_interval > 0)
+		table->next_checkpoint = table->opts.checkpoint_interval;
+}
+
+/**
+ * @brief Releases the pause mutex/condition if they were initialized.
+ *
+ * @param table Pointer to the t_table structure.
+ */
+void	destroy_checkpoint(t_table *table)
+{
+	if (!table->pause_sync_initialized)
+		return ;
+	signal(SIGUSR1, SIG_DFL);
+	g_checkpoint_wake_fd = -1;
+	pthread_cond_destroy(&table->pause_cond);
+	pthread_mutex_destroy(&table->pause_mutex);
+	table->pause_sync_initialized = 0;
+}
+
+/**
+ * @brief Parks the calling philosopher while a checkpoint is in progress.
+ *
+ * Called where the philosopher holds no fork: at the top of each cycle
+ * (state THINKING, about to take forks) and right after eating (state
+ * SLEEPING). Parking at either point keeps each philosopher's phase, so
+ * a resumed table does not start with everyone hungry at once. Either
+ * point is reached within one eat + sleep + think period, which bounds
+ * the pause latency. The common path is a single acquire load of
+ * `pause_requested`.
+ * The time at which the philosopher parked is recorded so its remaining
+ * time until death can be frozen in the snapshot.
+ *
+ * @param philo Pointer to the t_philo structure for the philosopher.
+ */
+void	checkpoint_safe_point(t_philo *philo)
+{
+	t_table	*table;
+
+	table = philo->table;
+	if (!__atomic_load_n(&table->pause_requested, __ATOMIC_ACQUIRE))
+		return ;
+	pthread_mutex_lock(&table->pause_mutex);
+	philo->paused_at = get_time_us();
+	table->paused_count++;
+	pthread_cond_broadcast(&table->pause_cond);
+	while (table->pause_requested)
+		pthread_cond_wait(&table->pause_cond, &table->pause_mutex);
+	table->paused_count--;
+	pthread_mutex_unlock(&table->pause_mutex);
+}
+
+/**
+ * @brief Asks every philosopher to park and waits until they all did.
+ *
+ * The wait is bounded by `time_to_die` (converted to wall-clock time):
+ * a pause that takes longer than that would already distort the model.
+ *
+ * @param table Pointer to the t_table structure.
+ * @param latency_us Receives the pause-to-snapshot latency (wall-clock us).
+ * @return 1 if all philosophers are parked, 0 if the bound was exceeded.
+ */
+static int	pause_table(t_table *table, long long *latency_us)
+{
+	struct timespec	abs;
+	long long		start;
+	long long		deadline;
+	int				all_parked;
+
+	pthread_mutex_lock(&table->pause_mutex);
+	__atomic_store_n(&table->pause_requested, 1, __ATOMIC_RELEASE);
+	start = real_time_us();
+	clock_gettime(CLOCK_REALTIME, &abs);
+	deadline = abs.tv_sec * 1000000LL + abs.tv_nsec / 1000
+		+ sim_to_real_us(table->time_to_die);
+	abs.tv_sec = deadline / 1000000;
+	abs.tv_nsec = (deadline % 1000000) * 1000;
+	while (table->paused_count < table->num_philos)
+	{
+		if (pthread_cond_timedwait(&table->pause_cond, &table->pause_mutex,
+				&abs) != 0)
+			break ;
+	}
+	all_parked = (table->paused_count == table->num_philos);
+	*latency_us = real_time_us() - start;
+	pthread_mutex_unlock(&table->pause_mutex);
+	return (all_parked);
+}
+
+/**
+ * @brief Lets parked philosophers continue, preserving their deadlines.
+ *
+ * Each philosopher's `last_meal_time` is shifted by the time it spent
+ * parked, so the pause neither brings a death closer nor pushes it away.
+ *
+ * @param table Pointer to the t_table structure.
+ */
+static void	resume_table(t_table *table)
+{
+	long long	now;
+	int			i;
+
+	pthread_mutex_lock(&table->pause_mutex);
+	now = get_time_us();
+	pthread_mutex_lock(&table->meal_time_mutex);
+	i = 0;
+	while (i < table->num_philos)
+	{
+		if (table->philos[i].paused_at > 0)
+			table->philos[i].last_meal_time += now
+				- table->philos[i].paused_at;
+		table->philos[i].paused_at = 0;
+		i++;
+	}
+	pthread_mutex_unlock(&table->meal_time_mutex);
+	__atomic_store_n(&table->pause_requested, 0, __ATOMIC_RELEASE);
+	pthread_cond_broadcast(&table->pause_cond);
+	pthread_mutex_unlock(&table->pause_mutex);
+}
+
+/**
+ * @brief Writes one 16-byte record per philosopher to `fd`.
+ *
+ * The remaining time until death is frozen at the moment each
+ * philosopher parked (`paused_at`).
+ *
+ * @param table Pointer to the t_table structure (all philosophers parked).
+ * @param fd Destination file descriptor.
+ * @return 0 on success, 1 on I/O error.
+ */
+static int	write_philo_records(t_table *table, int fd)
+{
+	t_ckpt_philo	rec;
+	int				i;
+
+	i = 0;
+	while (i < table->num_philos)
+	{
+		pthread_mutex_lock(&table->meal_time_mutex);
+		rec.remaining_us = table->time_to_die - (table->philos[i].paused_at
+				- table->philos[i].last_meal_time);
+		rec.meals_eaten = table->philos[i].meals_eaten;
+		rec.state = table->philos[i].state;
+		pthread_mutex_unlock(&table->meal_time_mutex);
+		if (write_all(fd, &rec, sizeof(rec)) != 0)
+			return (1);
+		i++;
+	}
+	return (0);
+}
+
+/**
+ * @brief Serializes the parked table to `--checkpoint` atomically.
+ *
+ * The file holds a fixed header followed by one record per philosopher
+ * (native byte order). It is written to `FILE.tmp` and then renamed so a
+ * crash mid-write never leaves a truncated checkpoint.
+ *
+ * @param table Pointer to the t_table structure (all philosophers parked).
+ * @param latency_us Pause latency stored in the header for later analysis.
+ * @return 0 on success, 1 on I/O error.
+ */
+static int	write_checkpoint(t_table *table, long long latency_us)
+{
+	t_ckpt_header	hdr;
+	char			tmp[4096];
+	int				fd;
+	int				failed;
+
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, CKPT_MAGIC, 4);
+	hdr.version = CKPT_VERSION;
+	hdr.num_philos = table->num_philos;
+	hdr.time_to_die = table->time_to_die;
+	hdr.time_to_eat = table->time_to_eat;
+	hdr.time_to_sleep = table->time_to_sleep;
+	hdr.num_must_eat = table->num_must_eat;
+	hdr.pause_latency_us = latency_us;
+	snprintf(tmp, sizeof(tmp), "%s.tmp", table->opts.checkpoint_file);
+	fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		return (1);
+	failed = write_all(fd, &hdr, sizeof(hdr)) != 0
+		|| write_philo_records(table, fd) != 0 || fsync(fd) != 0;
+	if (close(fd) != 0 || failed)
+		return (1);
+	return (rename(tmp, table->opts.checkpoint_file) != 0);
+}
+
+/**
+ * @brief Takes a checkpoint if one was requested or is due.
+ *
+ * Called by the monitor after each scan. Requests come from SIGUSR1 or
+ * from the `--checkpoint-interval` schedule. The outcome and the measured
+ * pause latency are reported on stderr so they never mix with the
+ * simulation output.
+ *
+ * @param table Pointer to the t_table structure.
+ */
+void	maybe_checkpoint(t_table *table)
+{
+	long long	latency_us;
+	int			failed;
+
+	if (!table->pause_sync_initialized)
+		return ;
+	if (!g_checkpoint_requested && (table->next_checkpoint < 0
+			|| get_time_us() - table->start_time < table->next_checkpoint))
+		return ;
+	g_checkpoint_requested = 0;
+	if (table->next_checkpoint >= 0)
+		table->next_checkpoint += table->opts.checkpoint_interval;
+	if (!pause_table(table, &latency_us))
+	{
+		resume_table(table);
+		fprintf(stderr, "checkpoint: aborted, table not parked after %lld us\n",
+			latency_us);
+		return ;
+	}
+	failed = write_checkpoint(table, latency_us);
+	resume_table(table);
+	if (failed)
+		fprintf(stderr, "checkpoint: failed to write %s\n",
+			table->opts.checkpoint_file);
+	else
+		fprintf(stderr, "checkpoint: wrote %s (pause latency %lld us)\n",
+			table->opts.checkpoint_file, latency_us);
+}
+
+/**
+ * @brief Checks that a checkpoint header matches the current table.
+ *
+ * @param table Pointer to the t_table structure.
+ * @param hdr The header read from the checkpoint file.
+ * @return 1 if the checkpoint was taken with the same arguments, 0 otherwise.
+ */
+static int	header_matches(t_table *table, t_ckpt_header *hdr)
+{
+	return (memcmp(hdr->magic, CKPT_MAGIC, 4) == 0
+		&& hdr->version == CKPT_VERSION
+		&& hdr->num_philos == table->num_philos
+		&& hdr->time_to_die == table->time_to_die
+		&& hdr->time_to_eat == table->time_to_eat
+		&& hdr->time_to_sleep == table->time_to_sleep
+		&& hdr->num_must_eat == table->num_must_eat);
+}
+
+/**
+ * @brief Reads the per-philosopher records of a checkpoint.
+ *
+ * @param table Pointer to the t_table structure (philosophers initialized).
+ * @param fd File descriptor positioned right after the header.
+ * @return 0 on success, 1 if the file is truncated.
+ */
+static int	read_philo_records(t_table *table, int fd)
+{
+	t_ckpt_philo	rec;
+	int				i;
+
+	i = 0;
+	while (i < table->num_philos)
+	{
+		if (read(fd, &rec, sizeof(rec)) != sizeof(rec))
+			return (1);
+		table->philos[i].meals_eaten = rec.meals_eaten;
+		table->philos[i].state = rec.state;
+		table->philos[i].resume_elapsed = table->time_to_die - rec.remaining_us;
+		i++;
+	}
+	return (0);
+}
+
+/**
+ * @brief Restores philosopher state from a `--resume` checkpoint.
+ *
+ * The checkpoint must have been taken with the same positional arguments.
+ * Each philosopher gets back its meal count, state (SLEEPING if it was
+ * parked right after eating, THINKING otherwise) and the time already
+ * elapsed since its last meal (`resume_elapsed`), which `run_simulations`
+ * applies relative to the new start time.
+ *
+ * @param table Pointer to the t_table structure (philosophers initialized).
+ * @return 0 on success, 1 if the file is unreadable or does not match.
+ */
+int	load_checkpoint(t_table *table)
+{
+	t_ckpt_header	hdr;
+	int				fd;
+	int				failed;
+
+	fd = open(table->opts.resume_file, O_RDONLY);
+	if (fd < 0)
+	{
+		printf("Error: Cannot open checkpoint %s.\n", table->opts.resume_file);
+		return (1);
+	}
+	failed = read(fd, &hdr, sizeof(hdr)) != sizeof(hdr)
+		|| !header_matches(table, &hdr)
+		|| read_philo_records(table, fd) != 0;
+	close(fd);
+	if (failed)
+	{
+		printf("Error: %s is not a checkpoint of this table.\n",
+			table->opts.resume_file);
+		return (1);
+	}
+	return (0);
+}
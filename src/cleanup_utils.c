@@ -6,40 +6,18 @@
 /*   By: vrads <vrads@student.42.fr>                +#+  +:+       +#+        */
 /*                                                +#+#+#+#+#+   +#+           */
 /*   Created: 2025/06/17 16:07:44 by vrads             #+#    #+#             */
-/*   Updated: 2025/06/17 16:07:45 by vrads            ###   ########.fr       */
+/*   Updated: 2025/07/14 18:27:05 by vrads            ###   ########.fr       */
 /*                                                                            */
 /* ************************************************************************** */
 
 #include "philo.h"
 
-/**
- * @brief Joins all valid philosopher threads.
- *
- * Iterates through all philosophers in the table. If a philosopher's
- * thread is marked as valid (i.e., successfully created), this function
- * waits for that thread to terminate using `pthread_join`.
- *
- * @param table Pointer to the t_table structure containing philosopher data.
- */
-static void	join_philosopher_threads(t_table *table)
-{
-	int	i;
-
-	i = 0;
-	while (i < table->num_philos)
-	{
-		if (table->philos[i].thread_valid)
-			pthread_join(table->philos[i].thread, NULL);
-		i++;
-	}
-}
-
 /**
  * @brief Destroys all initialized fork mutexes.
  *
  * Iterates up to `table->forks_initialized_count`, destroying each fork mutex.
- * After destroying the mutexes, it frees the memory allocated for the forks array
- * and resets `table->forks` to NULL and `table->forks_initialized_count` to 0.
+ * The forks array itself lives in the arena, so it is only forgotten here:
+ * `table->forks` is reset to NULL and `table->forks_initialized_count` to 0.
  * This function was originally in main.c and is specific to cleanup.
  *
  * @param table Pointer to the t_table structure.
@@ -54,7 +32,6 @@ static void	destroy_main_fork_mutexes(t_table *table)
 		pthread_mutex_destroy(&table->forks[i]);
 		i++;
 	}
-	free(table->forks);
 	table->forks = NULL;
 	table->forks_initialized_count = 0;
 }
@@ -89,11 +66,20 @@ static void	destroy_all_utility_mutexes(t_table *table)
 /**
  * @brief Cleans up all resources used by the simulation.
  *
- * This function performs the following cleanup steps:
- * 1. Joins all philosopher threads if philosophers array is allocated.
- * 2. Frees the philosophers array.
- * 3. Destroys and frees fork mutexes if they were initialized.
+ * This is the single teardown path, used both at the end of a run and
+ * after a partial initialization failure. It performs the following steps:
+ * 1. Stops and joins the thread pool (philosophers and monitor) and the
+ *    log writer, then flushes the last compressed frame and the output
+ *    sink, and closes it.
+ * 2. Prints `--stats` if the run got past startup, while the per-philosopher
+ *    state is still mapped, then forgets the philosophers array (its memory
+ *    belongs to the arena).
+ * 3. Destroys fork mutexes if they were initialized.
  * 4. Destroys utility mutexes (print, simulation end, meal time) if initialized.
+ * 5. Closes the monitor's timerfd/eventfd/epoll descriptors.
+ * 6. Releases checkpoint synchronization objects, completes the
+ *    `--record` log and closes the `--procs` sockets.
+ * 7. Unmaps the arena holding philosophers, forks and thread stacks.
  *
  * @param table Pointer to the t_table structure containing all simulation data.
  *              If NULL, the function returns immediately.
@@ -103,10 +89,15 @@ void	cleanup(t_table *table)
 	if (!table)
 		return ;
 
+	pool_destroy(&table->pool);
+	log_destroy(table);
+	compress_flush(table);
+	sink_flush(&table->sink);
+	sink_destroy(&table->sink);
 	if (table->philos)
 	{
-		join_philosopher_threads(table);
-		free(table->philos);
+		if (table->stats.startup_us > 0)
+			print_stats(table);
 		table->philos = NULL;
 	}
 
@@ -116,4 +107,10 @@ void	cleanup(t_table *table)
 	}
 
 	destroy_all_utility_mutexes(table);
+	destroy_monitor_events(table);
+	destroy_checkpoint(table);
+	destroy_replay(table);
+	destroy_procs(table);
+	destroy_timer_wheel(table);
+	arena_destroy(&table->arena);
 }
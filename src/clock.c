@@ -0,0 +1,406 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   clock.c                                            :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: vrads <vrads@student.42.fr>                +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/06/20 09:31:44 by vrads             #+#    #+#             */
+/*   Updated: 2025/07/15 14:48:02 by vrads            ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "philo.h"
+
+/*
+** Simulation clock state. `g_time_scale` is the wall-clock duration of one
+** simulated microsecond; `g_clock_origin` anchors the simulated timeline
+** so that scaling never overflows. Both are written once by `clock_init`
+** before any thread is started and only read afterwards.
+*/
+static double		g_time_scale = 1.0;
+static long long	g_clock_origin = 0;
+
+/*
+** With --replay the simulated clock is virtual: each thread reads the time
+** of the last log record it took (see replay.c), starting at 0.
+*/
+static int				g_virtual = 0;
+static __thread long long	g_virtual_us = 0;
+
+/*
+** --clock=tsc (default): `real_time_ns` reads the TSC and converts it with
+** `g_tsc_mult` (nanoseconds per tick, 32.32 fixed point) from the anchor
+** (`g_tsc_base`, `g_ns_base`), a CLOCK_MONOTONIC reading. The anchor and
+** the rate are taken again from CLOCK_MONOTONIC every TSC_RESYNC_NS, so
+** kernel timeouts computed from our time (timerfd, clock_nanosleep) stay
+** in step with NTP slewing; `g_tsc_seq` is the seqlock that publishes
+** them. Readers never see time go back on their own thread. If the TSC
+** stops tracking CLOCK_MONOTONIC (e.g. its rate changed after a VM
+** migration), every resync is rejected and the TSC is given up.
+*/
+static int					g_tsc = 0;
+static uint32_t				g_tsc_seq = 0;
+static uint64_t				g_tsc_base = 0;
+static long long			g_ns_base = 0;
+static uint64_t				g_tsc_mult = 0;
+static double				g_tsc_mhz = 0;
+static int					g_tsc_rejects = 0;
+static __thread long long	g_last_ns = 0;
+
+/**
+ * @brief Reads CLOCK_MONOTONIC (through the vDSO) in nanoseconds.
+ */
+long long	monotonic_ns(void)
+{
+	struct timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((ts.tv_sec * 1000000000LL) + ts.tv_nsec);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+/**
+ * @brief Reads the time stamp counter.
+ */
+uint64_t	tsc_ticks(void)
+{
+	return (__rdtsc());
+}
+
+/**
+ * @brief Tells whether the TSC can stand in for CLOCK_MONOTONIC.
+ *
+ * The CPU must advertise an invariant TSC (constant rate, runs in every
+ * power state) and the kernel must still be using it as its own clock
+ * source: it switches away when it finds the TSC unsynchronised between
+ * CPUs or unstable.
+ */
+static int	tsc_reliable(void)
+{
+	unsigned int	regs[4];
+	char			name[16];
+	int				fd;
+	ssize_t			len;
+
+	if (!__get_cpuid(0x80000007, &regs[0], &regs[1], &regs[2], &regs[3])
+		|| !(regs[3] & (1u << 8)))
+		return (0);
+	fd = open("/sys/devices/system/clocksource/clocksource0/"
+			"current_clocksource", O_RDONLY);
+	if (fd < 0)
+		return (0);
+	len = read(fd, name, sizeof(name));
+	close(fd);
+	return (len >= 3 && memcmp(name, "tsc", 3) == 0
+		&& (len == 3 || name[3] == '\n'));
+}
+
+#else
+
+uint64_t	tsc_ticks(void)
+{
+	return (0);
+}
+
+static int	tsc_reliable(void)
+{
+	return (0);
+}
+
+#endif
+
+/**
+ * @brief Reads CLOCK_MONOTONIC and the TSC at the same instant.
+ *
+ * Of TSC_PAIR_TRIES readings bracketed by two TSC reads, keeps the one
+ * with the tightest bracket, so an interrupt in between does not skew it.
+ *
+ * @param ns Set to the monotonic time.
+ * @param tsc Set to the TSC in the middle of the bracket.
+ * @return The width of the bracket, in ticks.
+ */
+static uint64_t	tsc_pair(long long *ns, uint64_t *tsc)
+{
+	uint64_t	before;
+	uint64_t	after;
+	uint64_t	best;
+	long long	now;
+	int			i;
+
+	best = UINT64_MAX;
+	i = 0;
+	while (i++ < TSC_PAIR_TRIES)
+	{
+		before = tsc_ticks();
+		now = monotonic_ns();
+		after = tsc_ticks();
+		if (after - before < best)
+		{
+			best = after - before;
+			*ns = now;
+			*tsc = before + best / 2;
+		}
+	}
+	return (best);
+}
+
+/**
+ * @brief Measures the TSC rate against CLOCK_MONOTONIC.
+ *
+ * @param span_ns How long to measure for.
+ * @return Nanoseconds per tick in 32.32 fixed point, 0 if implausible.
+ */
+static uint64_t	tsc_calibrate(long long span_ns)
+{
+	long long	ns0;
+	uint64_t	tsc0;
+	long long	ns;
+	uint64_t	tsc;
+
+	tsc_pair(&ns0, &tsc0);
+	ns = ns0;
+	while (ns - ns0 < span_ns)
+		ns = monotonic_ns();
+	tsc_pair(&ns, &tsc);
+	if (tsc <= tsc0 || (tsc - tsc0) * 10 < (uint64_t)(ns - ns0)
+		|| (tsc - tsc0) > (uint64_t)(ns - ns0) * 10)
+		return (0);
+	return ((uint64_t)(((unsigned __int128)(ns - ns0) << 32) / (tsc - tsc0)));
+}
+
+/**
+ * @brief Selects the clock behind `real_time_ns`.
+ *
+ * The TSC is used only if `tsc_reliable` and two calibrations agree within
+ * TSC_AGREE_PPM; otherwise the vDSO clock is.
+ *
+ * @param mode CLOCKSRC_TSC or CLOCKSRC_VDSO.
+ */
+static void	clock_select(t_clock_mode mode)
+{
+	uint64_t	a;
+	uint64_t	b;
+
+	g_tsc = 0;
+	if (mode != CLOCKSRC_TSC || !tsc_reliable())
+		return ;
+	a = tsc_calibrate(TSC_CALIBRATE_NS);
+	b = tsc_calibrate(TSC_CALIBRATE_NS);
+	if (!a || !b || (a > b ? a - b : b - a) > a / 1000000 * TSC_AGREE_PPM)
+		return ;
+	g_tsc_mult = (a + b) / 2;
+	g_tsc_mhz = 4294967296.0 * 1e3 / g_tsc_mult;
+	g_ns_base = monotonic_ns();
+	g_tsc_base = tsc_ticks();
+	g_tsc = 1;
+}
+
+/**
+ * @brief Takes a new anchor and rate from CLOCK_MONOTONIC.
+ *
+ * Done by whichever reader first finds the anchor TSC_RESYNC_NS old; the
+ * others keep the old one meanwhile. A pair wider than TSC_PAIR_MAX_NS,
+ * or a rate off by more than TSC_SLEW_PPM (NTP slews at most 500 ppm),
+ * is dropped and retried by a later reader. After TSC_RESYNC_FAILS drops
+ * in a row the anchor is too old to trust, and `real_time_ns` falls back
+ * to the vDSO clock as when the TSC fails at startup; its per-thread
+ * clamp absorbs the step if the TSC had run ahead.
+ */
+static void	tsc_resync(uint32_t seq)
+{
+	long long	ns;
+	uint64_t	tsc;
+	uint64_t	width;
+	uint64_t	mult;
+
+	if (!__atomic_compare_exchange_n(&g_tsc_seq, &seq, seq + 1, 0,
+			__ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+		return ;
+	width = tsc_pair(&ns, &tsc);
+	mult = (uint64_t)(((unsigned __int128)(ns - g_ns_base) << 32)
+			/ (tsc - g_tsc_base + 1));
+	if (((unsigned __int128)width * g_tsc_mult >> 32) < TSC_PAIR_MAX_NS
+		&& (mult > g_tsc_mult ? mult - g_tsc_mult : g_tsc_mult - mult)
+		< g_tsc_mult / 1000000 * TSC_SLEW_PPM)
+	{
+		__atomic_store_n(&g_tsc_mult, mult, __ATOMIC_RELAXED);
+		__atomic_store_n(&g_ns_base, ns, __ATOMIC_RELAXED);
+		__atomic_store_n(&g_tsc_base, tsc, __ATOMIC_RELAXED);
+		g_tsc_rejects = 0;
+	}
+	else if (++g_tsc_rejects >= TSC_RESYNC_FAILS)
+		__atomic_store_n(&g_tsc, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&g_tsc_seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Reads the raw clock in nanoseconds.
+ *
+ * The TSC with `--clock=tsc` when reliable, otherwise CLOCK_MONOTONIC,
+ * which `real_time_ns` tracks in both cases.
+ *
+ * @return Monotonic time in nanoseconds.
+ */
+long long	real_time_ns(void)
+{
+	uint32_t	seq;
+	long long	base;
+	long long	ns;
+
+	if (!__atomic_load_n(&g_tsc, __ATOMIC_RELAXED))
+	{
+		ns = monotonic_ns();
+		if (ns < g_last_ns)
+			return (g_last_ns);
+		g_last_ns = ns;
+		return (ns);
+	}
+	seq = 1;
+	while (seq & 1 || seq != __atomic_load_n(&g_tsc_seq, __ATOMIC_RELAXED))
+	{
+		seq = __atomic_load_n(&g_tsc_seq, __ATOMIC_ACQUIRE);
+		base = __atomic_load_n(&g_ns_base, __ATOMIC_RELAXED);
+		ns = base + (long long)(((unsigned __int128)(tsc_ticks()
+						- __atomic_load_n(&g_tsc_base, __ATOMIC_RELAXED))
+					* __atomic_load_n(&g_tsc_mult, __ATOMIC_RELAXED)) >> 32);
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	}
+	if (ns - base > TSC_RESYNC_NS)
+		tsc_resync(seq);
+	if (ns < g_last_ns)
+		return (g_last_ns);
+	g_last_ns = ns;
+	return (ns);
+}
+
+/**
+ * @brief Reads the raw monotonic clock in microseconds.
+ *
+ * Follows CLOCK_MONOTONIC, which is immune to wall-clock adjustments and
+ * is the clock the monitor's timerfd is armed against.
+ *
+ * @return Monotonic time in microseconds.
+ */
+long long	real_time_us(void)
+{
+	return (real_time_ns() / 1000);
+}
+
+/**
+ * @brief Rate of the TSC behind `real_time_ns`, for `--stats`.
+ *
+ * @return Ticks per microsecond, or 0 when the vDSO clock is used.
+ */
+double	clock_tsc_mhz(void)
+{
+	if (!__atomic_load_n(&g_tsc, __ATOMIC_RELAXED))
+		return (0);
+	return (g_tsc_mhz);
+}
+
+/**
+ * @brief Initializes the simulation clock with a time-scale factor.
+ *
+ * With a scale of F, every simulated duration takes F times as long in
+ * wall-clock time: F = 0.01 runs `time_to_die=60000` in 600 ms, F = 2
+ * runs everything twice as slowly. The raw clock is selected first
+ * (`--clock`); calibrating the TSC takes 2 * TSC_CALIBRATE_NS.
+ *
+ * @param time_scale Wall-clock seconds per simulated second (> 0).
+ * @param mode Raw clock requested with `--clock`.
+ */
+void	clock_init(double time_scale, t_clock_mode mode)
+{
+	clock_select(mode);
+	g_time_scale = time_scale;
+	g_clock_origin = real_time_us();
+}
+
+/**
+ * @brief Gets the current simulated time in microseconds.
+ *
+ * All internal timing (meal times, deadlines, phase durations) uses this
+ * clock, so small scaled durations keep sub-millisecond accuracy.
+ *
+ * @return Simulated microseconds since `clock_init`, or the calling
+ *         thread's virtual time with `--replay`.
+ */
+long long	get_time_us(void)
+{
+	long long	elapsed;
+
+	if (g_virtual)
+		return (g_virtual_us);
+	elapsed = real_time_us() - g_clock_origin;
+	if (g_time_scale == 1.0)
+		return (elapsed);
+	return ((long long)(elapsed / g_time_scale));
+}
+
+/**
+ * @brief Gets the current simulated time in milliseconds.
+ *
+ * @return Simulated milliseconds since `clock_init`.
+ */
+long long	get_time_ms(void)
+{
+	return (get_time_us() / 1000);
+}
+
+/**
+ * @brief Converts a simulated duration into wall-clock microseconds.
+ *
+ * Used wherever the kernel has to wait on our behalf (`usleep`, timerfd).
+ * Scaled values are capped at DURATION_MAX_US so that a slowed-down
+ * long duration cannot overflow.
+ *
+ * @param sim_us Simulated duration in microseconds.
+ * @return The matching wall-clock duration in microseconds.
+ */
+long long	sim_to_real_us(long long sim_us)
+{
+	double	real_us;
+
+	if (g_time_scale == 1.0)
+		return (sim_us);
+	real_us = sim_us * g_time_scale;
+	if (real_us > (double)DURATION_MAX_US)
+		return (DURATION_MAX_US);
+	return ((long long)real_us);
+}
+
+/**
+ * @brief Converts a simulated instant into `real_time_us` time.
+ *
+ * For absolute timeouts on `CLOCK_MONOTONIC`, such as the fork waits of
+ * `--detect=self`.
+ *
+ * @param sim_us Simulated time in microseconds (as `get_time_us`).
+ * @return The monotonic time at which the simulated clock reads `sim_us`.
+ */
+long long	real_time_at(long long sim_us)
+{
+	return (g_clock_origin + sim_to_real_us(sim_us));
+}
+
+/**
+ * @brief Switches the simulated clock to virtual time (`--replay`).
+ *
+ * Called once, before any pool thread runs.
+ */
+void	clock_use_virtual(void)
+{
+	g_virtual = 1;
+}
+
+/**
+ * @brief Sets the virtual time of the calling thread.
+ *
+ * @param sim_us Simulated time in microseconds.
+ */
+void	clock_set_virtual(long long sim_us)
+{
+	g_virtual_us = sim_us;
+}
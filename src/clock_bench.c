@@ -0,0 +1,130 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   clock_bench.c                                      :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: vrads <vrads@student.42.fr>                +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/07/14 15:12:40 by vrads             #+#    #+#             */
+/*   Updated: 2025/07/15 17:14:50 by vrads            ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "philo.h"
+
+/*
+** --clock-bench[=SECONDS]: what a timestamp costs and how far the clock
+** wanders. Prints key=value lines on stdout:
+**   clock, clock_tsc_mhz         the clock selected as for a run
+**   ns_per_call_<source>         mean cost of one reading, over
+**                                CLOCK_BENCH_CALLS calls of each source
+**   drift_seconds                length of the drift test
+**   drift_max_us                 largest gap seen between `real_time_ns`
+**                                and CLOCK_MONOTONIC, sampled each second
+**   tsc_free_drift_us            gap at the end for the TSC extrapolated
+**                                from its startup calibration alone, i.e.
+**                                without the periodic resync (TSC only)
+**   tsc_free_drift_ppm           the same as a rate
+*/
+
+static volatile long long	g_sink; // Keeps the timed loops alive
+
+static long long	read_monotonic_raw(void)
+{
+	struct timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+	return ((ts.tv_sec * 1000000000LL) + ts.tv_nsec);
+}
+
+static long long	read_gettimeofday(void)
+{
+	struct timeval	tv;
+
+	gettimeofday(&tv, NULL);
+	return ((tv.tv_sec * 1000000000LL) + tv.tv_usec * 1000LL);
+}
+
+/**
+ * @brief Prints the mean cost of one call of `read_ns`.
+ */
+static void	bench_cost(const char *name, long long (*read_ns)(void))
+{
+	long long	start;
+	long long	i;
+	long long	sum;
+
+	sum = 0;
+	i = 0;
+	start = monotonic_ns();
+	while (i++ < CLOCK_BENCH_CALLS)
+		sum += read_ns();
+	g_sink = sum;
+	printf("ns_per_call_%s=%.1f\n", name,
+		(double)(monotonic_ns() - start) / CLOCK_BENCH_CALLS);
+}
+
+/**
+ * @brief Samples `real_time_ns` and the free-running TSC against
+ *        CLOCK_MONOTONIC once a second for `seconds`.
+ *
+ * Each sample averages two `real_time_ns` readings taken around the
+ * CLOCK_MONOTONIC one, so the cost of a call does not count as drift.
+ */
+static void	bench_drift(double seconds)
+{
+	long long	mono0;
+	uint64_t	tsc0;
+	long long	mono;
+	long long	sample;
+	long long	max_gap;
+	long long	free_drift;
+
+	mono0 = monotonic_ns();
+	tsc0 = tsc_ticks();
+	max_gap = 0;
+	free_drift = 0;
+	mono = mono0;
+	while (mono - mono0 < (long long)(seconds * 1e9))
+	{
+		usleep(1000000);
+		sample = real_time_ns();
+		mono = monotonic_ns();
+		sample = (sample + real_time_ns()) / 2;
+		if (llabs(sample - mono) > max_gap)
+			max_gap = llabs(sample - mono);
+		if (clock_tsc_mhz() > 0)
+			free_drift = (long long)(mono0 + (tsc_ticks() - tsc0) * 1e3
+					/ clock_tsc_mhz()) - mono;
+	}
+	printf("drift_seconds=%.0f\n", (mono - mono0) / 1e9);
+	printf("drift_max_us=%.3f\n", max_gap / 1e3);
+	if (clock_tsc_mhz() <= 0)
+		return ;
+	printf("tsc_free_drift_us=%.1f\n", free_drift / 1e3);
+	printf("tsc_free_drift_ppm=%.2f\n",
+		free_drift * 1e6 / (double)(mono - mono0));
+}
+
+/**
+ * @brief Runs the clock benchmark instead of a simulation.
+ *
+ * @param opts Parsed options (`--clock`, `--clock-bench`).
+ * @return 0.
+ */
+int	clock_bench(t_options *opts)
+{
+	clock_init(1.0, opts->clock_mode);
+	if (clock_tsc_mhz() > 0)
+		printf("clock=tsc\nclock_tsc_mhz=%.3f\n", clock_tsc_mhz());
+	else
+		printf("clock=vdso\n");
+	bench_cost("real_time_ns", real_time_ns);
+	bench_cost("clock_monotonic", monotonic_ns);
+	bench_cost("clock_monotonic_raw", read_monotonic_raw);
+	bench_cost("gettimeofday", read_gettimeofday);
+	bench_cost("get_time_us", get_time_us);
+	fflush(stdout);
+	bench_drift(opts->clock_bench);
+	return (0);
+}
@@ -0,0 +1,253 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   deadlock.c                                         :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: vrads <vrads@student.42.fr>                +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/07/04 09:12:37 by vrads             #+#    #+#             */
+/*   Updated: 2025/07/04 10:40:02 by vrads            ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "philo.h"
+
+/*
+** Wait-for graph of the table, maintained without locks by take_forks()
+** and drop_forks():
+**   philo->waiting_fork   fork a philosopher is blocked on, -1 if none
+**   wfg.holder[fork]      id of the philosopher holding it, 0 if free
+** Every philosopher waits on at most one fork and every fork has at most
+** one holder, so following "waits on -> held by" from any philosopher is
+** a single path and a cycle is found in O(N) per scan. The graph is read
+** while it changes, so a cycle is only reported once it has stayed
+** identical for DEADLOCK_CONFIRM_US: a real deadlock never changes.
+*/
+
+/**
+ * @brief Carves the fork holder and detector scratch arrays from the arena.
+ *
+ * @param table Pointer to the t_table structure (arena mapped).
+ * @return 0 on success, 1 if the arena is exhausted.
+ */
+int	init_wait_for_graph(t_table *table)
+{
+	table->wfg.holder = arena_alloc(&table->arena,
+			sizeof(int) * table->num_philos, ARENA_LINE);
+	table->wfg.mark = arena_alloc(&table->arena,
+			sizeof(int) * table->num_philos, ARENA_LINE);
+	if (!table->wfg.holder || !table->wfg.mark)
+	{
+		printf("Error: Allocation failed for the wait-for graph.\n");
+		return (1);
+	}
+	reset_wait_for_graph(table);
+	return (0);
+}
+
+/**
+ * @brief Marks every fork free and forgets any suspected cycle.
+ *
+ * @param table Pointer to the t_table structure, no thread running.
+ */
+void	reset_wait_for_graph(t_table *table)
+{
+	memset(table->wfg.holder, 0, sizeof(int) * table->num_philos);
+	table->wfg.suspect_sig = 0;
+	table->wfg.suspect_at = -1;
+	table->wfg.reported = 0;
+}
+
+/**
+ * @brief Records that `philo` is about to block on `fork`.
+ *
+ * @param philo Pointer to the waiting philosopher.
+ * @param fork Index of the fork in `table->forks`.
+ * @param since Start of the wait (simulated us).
+ */
+void	wfg_wait(t_philo *philo, int fork, long long since)
+{
+	__atomic_store_n(&philo->wait_since, since, __ATOMIC_RELAXED);
+	__atomic_store_n(&philo->waiting_fork, fork, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Records that `philo` now holds `fork` and waits on nothing.
+ *
+ * @param philo Pointer to the philosopher that locked the fork.
+ * @param fork Index of the fork in `table->forks`.
+ */
+void	wfg_acquired(t_philo *philo, int fork)
+{
+	__atomic_store_n(&philo->table->wfg.holder[fork], philo->id,
+		__ATOMIC_RELEASE);
+	__atomic_store_n(&philo->waiting_fork, -1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Records that `fork` is free again. Called before the unlock.
+ *
+ * @param philo Pointer to the philosopher releasing the fork.
+ * @param fork Index of the fork in `table->forks`.
+ */
+void	wfg_release(t_philo *philo, int fork)
+{
+	__atomic_store_n(&philo->table->wfg.holder[fork], 0, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Follows one "waits on -> held by" edge.
+ *
+ * @param table Pointer to the t_table structure.
+ * @param i Index of a philosopher.
+ * @return Index of the philosopher `i` waits for, or -1 if none.
+ */
+static int	next_in_graph(t_table *table, int i)
+{
+	int	fork;
+	int	holder;
+
+	fork = __atomic_load_n(&table->philos[i].waiting_fork, __ATOMIC_ACQUIRE);
+	if (fork < 0)
+		return (-1);
+	holder = __atomic_load_n(&table->wfg.holder[fork], __ATOMIC_ACQUIRE);
+	return (holder - 1);
+}
+
+/**
+ * @brief Finds a cycle in the wait-for graph.
+ *
+ * Walks the path starting at each philosopher not visited yet, stamping
+ * nodes with the walk number; meeting a node stamped by the current walk
+ * means a cycle. Each node is visited once, so the scan is O(N).
+ *
+ * @param table Pointer to the t_table structure.
+ * @return Index of a philosopher on a cycle, or -1 if there is none.
+ */
+static int	find_cycle(t_table *table)
+{
+	int	start;
+	int	i;
+
+	memset(table->wfg.mark, 0, sizeof(int) * table->num_philos);
+	start = 0;
+	while (start < table->num_philos)
+	{
+		i = start;
+		while (i >= 0 && table->wfg.mark[i] == 0)
+		{
+			table->wfg.mark[i] = start + 1;
+			i = next_in_graph(table, i);
+		}
+		if (i >= 0 && table->wfg.mark[i] == start + 1)
+			return (i);
+		start++;
+	}
+	return (-1);
+}
+
+/**
+ * @brief Computes a value that changes whenever a cycle member moves.
+ *
+ * @param table Pointer to the t_table structure.
+ * @param first Index of a philosopher on the cycle.
+ * @return Sum of the members' wait start times and awaited forks.
+ */
+static long long	cycle_signature(t_table *table, int first)
+{
+	long long	sig;
+	int			i;
+
+	sig = 0;
+	i = first;
+	while (1)
+	{
+		sig += __atomic_load_n(&table->philos[i].wait_since, __ATOMIC_RELAXED)
+			+ table->philos[i].waiting_fork;
+		i = next_in_graph(table, i);
+		if (i < 0 || i == first)
+			break ;
+	}
+	return (sig);
+}
+
+/**
+ * @brief Prints the confirmed cycle to stderr, one line per member.
+ *
+ * Example:
+ *   deadlock at 200 ms: 1 -> 2 -> 3 -> 1
+ *     1 waits fork 1 held by 2 for 200 ms
+ *
+ * @param table Pointer to the t_table structure.
+ * @param first Index of a philosopher on the cycle.
+ * @param now Current simulated time (us).
+ */
+static void	dump_cycle(t_table *table, int first, long long now)
+{
+	t_philo	*philo;
+	int		i;
+
+	fprintf(stderr, "deadlock at %lld ms: %d", (now - table->start_time)
+		/ 1000, table->philos[first].id);
+	i = next_in_graph(table, first);
+	while (i >= 0 && i != first)
+	{
+		fprintf(stderr, " -> %d", table->philos[i].id);
+		i = next_in_graph(table, i);
+	}
+	fprintf(stderr, " -> %d\n", table->philos[first].id);
+	i = first;
+	while (1)
+	{
+		philo = &table->philos[i];
+		fprintf(stderr, "  %d waits fork %d held by %d for %lld ms\n",
+			philo->id, philo->waiting_fork,
+			table->wfg.holder[philo->waiting_fork],
+			(now - philo->wait_since) / 1000);
+		i = next_in_graph(table, i);
+		if (i < 0 || i == first)
+			break ;
+	}
+}
+
+/**
+ * @brief Runs the detector once; called by the monitor after each scan.
+ *
+ * A cycle first becomes a suspect. If the same cycle (same signature) is
+ * still there DEADLOCK_CONFIRM_US later, it is a deadlock and is dumped
+ * once per run. The simulation itself goes on; the monitor reports the
+ * resulting death as usual.
+ *
+ * @param table Pointer to the t_table structure.
+ * @return Absolute simulated time at which the monitor must scan again to
+ *         confirm a suspect, or -1 if nothing is pending.
+ */
+long long	detect_deadlock(t_table *table)
+{
+	long long	now;
+	long long	sig;
+	int			first;
+
+	if (table->wfg.reported)
+		return (-1);
+	first = find_cycle(table);
+	if (first < 0)
+	{
+		table->wfg.suspect_at = -1;
+		return (-1);
+	}
+	now = get_time_us();
+	sig = cycle_signature(table, first);
+	if (table->wfg.suspect_at < 0 || sig != table->wfg.suspect_sig)
+	{
+		table->wfg.suspect_sig = sig;
+		table->wfg.suspect_at = now;
+	}
+	else if (now - table->wfg.suspect_at >= DEADLOCK_CONFIRM_US)
+	{
+		dump_cycle(table, first, now);
+		table->wfg.reported = 1;
+		return (-1);
+	}
+	return (table->wfg.suspect_at + DEADLOCK_CONFIRM_US);
+}
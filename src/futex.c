@@ -0,0 +1,78 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   futex.c                                            :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: vrads <vrads@student.42.fr>                +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/07/03 10:05:41 by vrads             #+#    #+#             */
+/*   Updated: 2025/07/09 14:02:51 by vrads            ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "philo.h"
+
+/**
+ * @brief Sleeps while `*addr` still equals `expected`.
+ *
+ * Thin wrapper over `FUTEX_WAIT_PRIVATE`. Like any futex wait it may
+ * return spuriously, so callers re-check their condition in a loop.
+ *
+ * @param addr The futex word.
+ * @param expected The value the caller last observed.
+ */
+void	futex_wait(uint32_t *addr, uint32_t expected)
+{
+	syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+}
+
+/**
+ * @brief Wakes up to `count` threads sleeping on `addr`.
+ *
+ * @param addr The futex word.
+ * @param count Maximum number of waiters to wake (INT_MAX for all).
+ */
+void	futex_wake(uint32_t *addr, int count)
+{
+	syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0);
+}
+
+/**
+ * @brief Like `futex_wait`, but gives up after `real_us` microseconds.
+ *
+ * The timeout is relative and measured on `CLOCK_MONOTONIC`, like the
+ * rest of the simulation clock.
+ *
+ * @param addr The futex word.
+ * @param expected The value the caller last observed.
+ * @param real_us Wall-clock timeout in microseconds, negative for none.
+ */
+void	futex_wait_us(uint32_t *addr, uint32_t expected, long long real_us)
+{
+	struct timespec	ts;
+
+	if (real_us < 0)
+	{
+		futex_wait(addr, expected);
+		return ;
+	}
+	ts.tv_sec = real_us / 1000000;
+	ts.tv_nsec = (real_us % 1000000) * 1000;
+	syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, expected, &ts, NULL, 0);
+}
+
+/**
+ * @brief Stores 1 in `*b` and wakes one waiter on `a` and one on `b`, in
+ *        a single `FUTEX_WAKE_OP` call.
+ *
+ * The caller sets `*a` itself beforehand; the kernel performs the store
+ * to `*b` atomically before deciding whether to wake it (always, here).
+ *
+ * @param a First futex word, already updated.
+ * @param b Second futex word, set to 1 by the kernel.
+ */
+void	futex_wake_pair(uint32_t *a, uint32_t *b)
+{
+	syscall(SYS_futex, a, FUTEX_WAKE_OP_PRIVATE, 1, (void *)1L, b,
+		FUTEX_OP(FUTEX_OP_SET, 1, FUTEX_OP_CMP_GE, 0));
+}
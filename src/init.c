@@ -6,7 +6,7 @@
 /*   By: vrads <vrads@student.42.fr>                +#+  +:+       +#+        */
 /*                                                +#+#+#+#+#+   +#+           */
 /*   Created: 2025/06/17 16:06:52 by vrads             #+#    #+#             */
-/*   Updated: 2025/06/17 16:06:53 by vrads            ###   ########.fr       */
+/*   Updated: 2025/07/15 16:05:12 by vrads            ###   ########.fr       */
 /*                                                                            */
 /* ************************************************************************** */
 
@@ -15,51 +15,102 @@
 /**
  * @brief Parses the command-line arguments to initialize table settings.
  *
+ * Also used alone by `--analyze`, so a table is analyzed only if it
+ * would be accepted for a run.
+ *
  * Populates the `t_table` structure with values from `argv`, including
  * number of philosophers, time to die, time to eat, time to sleep, and
- * optionally, the number of times each philosopher must eat.
- * Validates the arguments to ensure they are positive integers and that
- * the number of philosophers does not exceed a predefined limit (e.g., 200).
- * Prints usage instructions if arguments are invalid.
+ * optionally, the number of times each philosopher must eat, using the
+ * strict parsers of parse_num.c. Counts must be positive integers and
+ * durations positive 64-bit microsecond values, given in milliseconds or
+ * with a `us`, `ms` or `s` suffix. The number of philosophers must not
+ * exceed `--max-philos` (200 by default), nor be less than `--shards` or
+ * `--procs`. Once valid, `--procs=P` also sets `--shards=P`, as the
+ * processes run the slices of shard.c.
+ * Names the offending argument and prints usage instructions if an
+ * argument is invalid.
  *
  * @param table Pointer to the t_table structure to be initialized.
  * @param argc The argument count.
  * @param argv The argument vector.
  * @return 0 if arguments are parsed successfully, 1 on error (invalid arguments).
  */
-static int	parse_args(t_table *table, int argc, char **argv)
+int	parse_args(t_table *table, int argc, char **argv)
 {
-	table->num_philos = ft_atoi(argv[1]);
-	table->time_to_die = ft_atoi(argv[2]);
-	table->time_to_eat = ft_atoi(argv[3]);
-	table->time_to_sleep = ft_atoi(argv[4]);
-	if (argc == 6)
-		table->num_must_eat = ft_atoi(argv[5]);
-	else
-		table->num_must_eat = -1;
-	if (table->num_philos <= 0 || table->time_to_die <= 0 || \
-		table->time_to_eat <= 0 || table->time_to_sleep <= 0 || \
-		(argc == 6 && table->num_must_eat <= 0))
+	int	bad;
+
+	bad = parse_table_args(table, argc, argv);
+	if (bad != 0)
 	{
-		printf("Error: Invalid arguments.\n");
+		printf("Error: Invalid %s '%s'.\n", table_arg_name(bad), argv[bad]);
 		print_usage();
 		return (1);
 	}
-	if (table->num_philos > 200)
+	if (table->num_philos > table->opts.max_philos)
 	{
-		printf("Error: Number of philosophers cannot exceed 200.\n");
+		printf("Error: Number of philosophers cannot exceed %d.\n",
+			table->opts.max_philos);
 		return (1);
 	}
+	if (table->opts.detect_mode == DETECT_SELF && table->opts.checkpoint_file)
+	{
+		printf("Error: --checkpoint needs the monitor (--detect=monitor).\n");
+		return (1);
+	}
+	if (table->opts.procs && (table->opts.shards || table->opts.procs < 2
+			|| table->opts.repeat > 1))
+	{
+		printf("Error: --procs needs at least 2 processes, a single run "
+			"and no --shards.\n");
+		return (1);
+	}
+	if (table->opts.shards > table->num_philos)
+	{
+		printf("Error: --shards cannot exceed the number of philosophers.\n");
+		return (1);
+	}
+	if (table->opts.procs > table->num_philos)
+	{
+		printf("Error: --procs cannot exceed the number of philosophers.\n");
+		return (1);
+	}
+	if ((table->opts.shards || table->opts.procs || table->opts.scheduled)
+		&& (table->opts.checkpoint_file || table->opts.resume_file))
+	{
+		printf("Error: --checkpoint and --resume need philosophers racing "
+			"for forks.\n");
+		return (1);
+	}
+	if ((table->opts.shards || table->opts.procs) && table->opts.scheduled)
+	{
+		printf("Error: --scheduled cannot be combined with --shards or "
+			"--procs.\n");
+		return (1);
+	}
+	if ((table->opts.record_file || table->opts.replay_file)
+		&& ((table->opts.record_file && table->opts.replay_file)
+			|| table->opts.shards || table->opts.procs
+			|| table->opts.scheduled || table->opts.detect_mode == DETECT_SELF
+			|| table->opts.checkpoint_file || table->opts.resume_file
+			|| table->opts.repeat > 1))
+	{
+		printf("Error: --record and --replay need a single plain run "
+			"with the monitor.\n");
+		return (1);
+	}
+	if (table->opts.procs)
+		table->opts.shards = table->opts.procs;
 	return (0);
 }
 
 /**
  * @brief Initializes the main simulation table structure.
  *
- * This function first parses the command-line arguments using `parse_args`.
- * If parsing is successful, it initializes other members of the `t_table`
- * structure to their default values (e.g., start_time to 0, simulation_should_end
- * to 0, pointers to NULL, and mutex initialized flags to 0).
+ * This function first initializes the members of the `t_table` structure
+ * to their default values (e.g., start_time to 0, simulation_should_end
+ * to 0, pointers to NULL, mutex initialized flags to 0 and monitor fds to -1),
+ * so `cleanup` is always safe, then parses the command-line arguments
+ * using `parse_args`.
  *
  * @param table Pointer to the t_table structure to be initialized.
  * @param argc The argument count from main.
@@ -68,15 +119,56 @@ static int	parse_args(t_table *table, int argc, char **argv)
  */
 int	init_table(t_table *table, int argc, char **argv)
 {
-	if (parse_args(table, argc, argv) != 0)
-		return (1);
 	table->start_time = 0;
 	table->simulation_should_end = 0;
 	table->philos = NULL;
 	table->forks = NULL;
+	table->shards = NULL;
+	table->fork_busy = NULL;
+	memset(&table->procs, 0, sizeof(table->procs));
+	table->procs.index = -1;
+	table->procs.coord_fd = -1;
+	table->procs.left.fd = -1;
+	table->procs.right.fd = -1;
+	memset(&table->replay, 0, sizeof(table->replay));
+	table->replay.fd = -1;
+	table->replay.map = MAP_FAILED;
+	table->sched_gap_us = 0;
 	table->forks_initialized_count = 0;
 	table->print_mutex_initialized = 0;
 	table->sim_end_mutex_initialized = 0;
 	table->meal_time_mutex_initialized = 0;
+	table->deadline_owner = 0;
+	table->full_count = 0;
+	table->monitor_epoll_fd = -1;
+	table->monitor_timer_fd = -1;
+	table->monitor_wake_fd = -1;
+	table->pause_sync_initialized = 0;
+	table->arena.base = NULL;
+	table->arena.size = 0;
+	table->arena.hugepages = 0;
+	table->stats.startup_us = 0;
+	table->stats.death_latency_us = -1;
+	table->stats.runs = 0;
+	table->stats.meals = 0;
+	table->stats.min_slack_us = -1;
+	table->stats.sleep_syscalls = 0;
+	table->stats.sleeps = 0;
+	table->stats.sleep_late_us = 0;
+	table->stats.sleep_late_max_us = 0;
+	memset(table->stats.overshoot, 0, sizeof(table->stats.overshoot));
+	memset(table->stats.cost, 0, sizeof(table->stats.cost));
+	memset(&table->rt, 0, sizeof(table->rt));
+	table->pool.workers = NULL;
+	table->pool.count = 0;
+	memset(&table->sink, 0, sizeof(table->sink));
+	table->sink.fd = STDOUT_FILENO;
+	table->sink.ring.fd = -1;
+	memset(&table->log, 0, sizeof(table->log));
+	memset(&table->zip, 0, sizeof(table->zip));
+	table->wheel.mutex_initialized = 0;
+	table->wheel.wakeups = 0;
+	if (parse_args(table, argc, argv) != 0 || chaos_init(table) != 0)
+		return (1);
 	return (0);
 }
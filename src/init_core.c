@@ -6,7 +6,7 @@
 /*   By: vrads <vrads@student.42.fr>                +#+  +:+       +#+        */
 /*                                                +#+#+#+#+#+   +#+           */
 /*   Created: 2025/06/17 16:06:01 by vrads             #+#    #+#             */
-/*   Updated: 2025/06/17 16:06:02 by vrads            ###   ########.fr       */
+/*   Updated: 2025/07/09 14:02:51 by vrads            ###   ########.fr       */
 /*                                                                            */
 /* ************************************************************************** */
 
@@ -17,8 +17,8 @@
  *
  * This function initializes fork mutexes by calling `init_fork_mutexes`
  * and then initializes utility mutexes (print, simulation end, meal time)
- * by calling `init_utility_mutexes`. If `init_utility_mutexes` fails,
- * it cleans up the already initialized fork mutexes before returning an error.
+ * by calling `init_utility_mutexes`. On failure, whatever was already
+ * initialized is left for `cleanup` to tear down.
  *
  * @param table Pointer to the t_table structure where mutexes are stored
  *              and their initialization status is tracked.
@@ -27,49 +27,69 @@
 int	init_mutexes(t_table *table)
 {
 	if (init_fork_mutexes(table) != 0)
-	{
 		return (1);
-	}
 	if (init_utility_mutexes(table) != 0)
-	{
-		destroy_n_fork_mutexes(table, table->forks_initialized_count);
 		return (1);
-	}
 	return (0);
 }
 
+/**
+ * @brief Resets the per-run fields of a philosopher.
+ *
+ * Used by `init_philos` and before every warm restart (`--repeat`), so a
+ * new simulation starts from the same state as a fresh process.
+ *
+ * @param philo Pointer to the t_philo structure (`table` already set).
+ */
+void	reset_philo(t_philo *philo)
+{
+	philo->meals_eaten = 0;
+	philo->last_meal_time = 0;
+	philo->paused_at = 0;
+	philo->resume_elapsed = 0;
+	philo->fork_wait_us = 0;
+	philo->fork_wait_avg_us = 0;
+	philo->think_us = base_think_delay(philo->table);
+	philo->min_slack_us = philo->table->time_to_die;
+	philo->waiting_fork = -1;
+	philo->wait_since = 0;
+	philo->sleeps = 0;
+	philo->sleep_late_us = 0;
+	philo->sleep_late_max_us = 0;
+	philo->state = THINKING;
+}
+
 /**
  * @brief Initializes the philosopher structures.
  *
- * Allocates memory for the array of philosopher structures (`t_philo`) within
- * the `t_table` structure. Initializes each philosopher with their ID,
- * default meal count, initial state (THINKING), a pointer to the table,
- * and pointers to their left and right forks.
+ * Carves the array of philosopher structures (`t_philo`) out of the table
+ * arena. Initializes each philosopher with their ID, a pointer to the
+ * table, the per-run fields set by `reset_philo` and pointers to their
+ * left and right forks.
  * Special handling for a single philosopher: their right_fork is set to NULL.
  *
  * @param table Pointer to the t_table structure which contains the philosophers
  *              array and simulation parameters like `num_philos` and `forks`.
- * @return 0 if philosophers are initialized successfully, 1 on malloc failure.
+ * @return 0 if philosophers are initialized successfully, 1 if the arena
+ *         is exhausted.
  */
 int	init_philos(t_table *table)
 {
-	int	i;
+	int		i;
 
-	table->philos = malloc(sizeof(t_philo) * table->num_philos);
+	table->philos = arena_alloc(&table->arena,
+			sizeof(t_philo) * table->num_philos, ARENA_LINE);
 	if (!table->philos)
 	{
-		printf("Error: Malloc failed for philosophers.\n");
+		printf("Error: Allocation failed for philosophers.\n");
 		return (1);
 	}
 	i = 0;
 	while (i < table->num_philos)
 	{
 		table->philos[i].id = i + 1;
-		table->philos[i].meals_eaten = 0;
-		table->philos[i].last_meal_time = 0;
-		table->philos[i].thread_valid = 0;
-		table->philos[i].state = THINKING;
 		table->philos[i].table = table;
+		reset_philo(&table->philos[i]);
 		table->philos[i].left_fork = &table->forks[i];
 		table->philos[i].right_fork = &table->forks[(i + 1) % table->num_philos];
 		if (table->num_philos == 1)
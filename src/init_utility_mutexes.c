@@ -6,7 +6,7 @@
 /*   By: vrads <vrads@student.42.fr>                +#+  +:+       +#+        */
 /*                                                +#+#+#+#+#+   +#+           */
 /*   Created: 2025/06/17 16:07:40 by vrads             #+#    #+#             */
-/*   Updated: 2025/06/17 16:07:41 by vrads            ###   ########.fr       */
+/*   Updated: 2025/06/25 15:20:44 by vrads            ###   ########.fr       */
 /*                                                                            */
 /* ************************************************************************** */
 
@@ -76,9 +76,9 @@ static int	init_meal_time_mutex_internal(t_table *table)
  * @brief Initializes all utility mutexes (print, simulation end, meal time).
  *
  * Sequentially initializes the print mutex, then the simulation end mutex,
- * and finally the meal time mutex. If any initialization fails, it attempts
- * to destroy any previously successfully initialized utility mutexes in this function
- * before returning an error.
+ * and finally the meal time mutex, stopping at the first failure. Each
+ * mutex sets its own initialized flag, so `cleanup` destroys exactly the
+ * ones that were created.
  *
  * @param table Pointer to the t_table structure to store the mutexes.
  * @return 0 if all utility mutexes are initialized successfully, 1 on error.
@@ -88,21 +88,8 @@ int	init_utility_mutexes(t_table *table)
 	if (init_print_mutex_internal(table) != 0)
 		return (1);
 	if (init_sim_end_mutex_internal(table) != 0)
-	{
-		if (table->print_mutex_initialized)
-			pthread_mutex_destroy(&table->print_mutex);
-		table->print_mutex_initialized = 0;
 		return (1);
-	}
 	if (init_meal_time_mutex_internal(table) != 0)
-	{
-		if (table->print_mutex_initialized)
-			pthread_mutex_destroy(&table->print_mutex);
-		table->print_mutex_initialized = 0;
-		if (table->sim_end_mutex_initialized)
-			pthread_mutex_destroy(&table->sim_end_mutex);
-		table->sim_end_mutex_initialized = 0;
 		return (1);
-	}
 	return (0);
 }
@@ -0,0 +1,355 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   log_policy.c                                       :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: vrads <vrads@student.42.fr>                +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/07/07 09:26:44 by vrads             #+#    #+#             */
+/*   Updated: 2025/07/15 14:07:39 by vrads            ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "philo.h"
+
+/*
+** Output policies (--log=block|drop|sample:N).
+**
+** block   lines go straight to the output sink under print_mutex; a slow
+**         stdout stalls the printing philosopher (lossless).
+** drop    lines are copied into an in-memory ring (LOG_RING_SIZE bytes)
+**         and a writer thread drains it into the sink. When the ring is
+**         full the line is dropped and counted per event type.
+** sample  like drop, but only every Nth line of each event type is kept.
+** In drop and sample modes a philosopher never waits on I/O. Deaths are
+** never dropped or sampled out: the monitor waits for room instead.
+** With --compress the ring and writer are used in every mode, so frames
+** are compressed off the hot path; under `block` a full ring then makes
+** the printer wait for room (lossless).
+** The ring has one producer at a time (print_mutex) and one consumer
+** (the writer thread), so head/tail need no lock.
+*/
+
+static const char	*g_event_names[EVENT_TYPES] = {
+	"has taken a fork", "is eating", "is sleeping", "is thinking", "died"
+};
+
+/**
+ * @brief Maps a status string to its event type.
+ *
+ * @param status One of the status strings printed by the simulation.
+ * @return The matching t_event_type (EV_FORK if unknown).
+ */
+static int	event_type(const char *status)
+{
+	int	type;
+
+	type = 0;
+	while (type < EVENT_TYPES)
+	{
+		if (strcmp(status, g_event_names[type]) == 0)
+			return (type);
+		type++;
+	}
+	return (EV_FORK);
+}
+
+/**
+ * @brief Short name of an event type, used for the `--stats` counters.
+ *
+ * @param type A t_event_type value.
+ * @return "fork", "eat", "sleep", "think" or "died".
+ */
+const char	*event_type_name(int type)
+{
+	static const char	*names[EVENT_TYPES] = {
+		"fork", "eat", "sleep", "think", "died"
+	};
+
+	return (names[type]);
+}
+
+/**
+ * @brief Wakes the writer thread if it is asleep.
+ *
+ * @param log Pointer to the t_log structure.
+ */
+static void	wake_writer(t_log *log)
+{
+	if (__atomic_load_n(&log->sleeping, __ATOMIC_SEQ_CST))
+	{
+		__atomic_add_fetch(&log->seq, 1, __ATOMIC_SEQ_CST);
+		futex_wake(&log->seq, 1);
+	}
+}
+
+/**
+ * @brief Writes the next contiguous chunk of the ring to the sink.
+ *
+ * @param table Pointer to the t_table structure.
+ * @return 1 if something was written, 0 if the ring was empty.
+ */
+static int	drain_chunk(t_table *table)
+{
+	t_log		*log;
+	uint64_t	head;
+	uint64_t	tail;
+	size_t		len;
+
+	log = &table->log;
+	head = log->head;
+	tail = __atomic_load_n(&log->tail, __ATOMIC_SEQ_CST);
+	if (head == tail)
+		return (0);
+	len = tail - head;
+	if (len > LOG_RING_SIZE - (head & (LOG_RING_SIZE - 1)))
+		len = LOG_RING_SIZE - (head & (LOG_RING_SIZE - 1));
+	if (len > 4096)
+		len = 4096;
+	if (table->zip.enabled)
+		compress_append(table, log->ring + (head & (LOG_RING_SIZE - 1)), len);
+	else
+		sink_write(&table->sink, log->ring + (head & (LOG_RING_SIZE - 1)),
+			len);
+	__atomic_store_n(&log->head, head + len, __ATOMIC_RELEASE);
+	return (1);
+}
+
+/**
+ * @brief Body of the writer thread: drains the ring into the sink.
+ *
+ * Sleeps on the `seq` futex when the ring is empty; producers only make
+ * a syscall to wake it when it is actually asleep.
+ *
+ * @param arg Pointer to the t_table structure, passed as `void*`.
+ * @return NULL once `log_destroy` asks it to stop and the ring is empty.
+ */
+static void	*log_writer(void *arg)
+{
+	t_table		*table;
+	t_log		*log;
+	uint32_t	seq;
+
+	table = (t_table *)arg;
+	log = &table->log;
+	while (1)
+	{
+		if (drain_chunk(table))
+			continue ;
+		if (__atomic_load_n(&log->shutdown, __ATOMIC_ACQUIRE))
+			return (NULL);
+		seq = __atomic_load_n(&log->seq, __ATOMIC_SEQ_CST);
+		__atomic_store_n(&log->sleeping, 1, __ATOMIC_SEQ_CST);
+		if (__atomic_load_n(&log->tail, __ATOMIC_SEQ_CST) == log->head
+			&& !__atomic_load_n(&log->shutdown, __ATOMIC_ACQUIRE))
+			futex_wait(&log->seq, seq);
+		__atomic_store_n(&log->sleeping, 0, __ATOMIC_SEQ_CST);
+	}
+}
+
+/**
+ * @brief Sets up the ring and the writer thread for `--log=drop|sample`,
+ *        `--compress` and `--realtime`.
+ *
+ * @param table Pointer to the t_table structure (arena mapped, sink ready).
+ * @return 0 on success, 1 on allocation or thread creation failure.
+ */
+int	log_init(t_table *table)
+{
+	t_log	*log;
+
+	log = &table->log;
+	log->mode = table->opts.log_mode;
+	log->sample = table->opts.log_sample;
+	if (log->mode == LOG_BLOCK && !table->opts.compress
+		&& !table->opts.realtime)
+		return (0);
+	log->ring = arena_alloc(&table->arena, LOG_RING_SIZE,
+			sysconf(_SC_PAGESIZE));
+	if (!log->ring)
+		return (printf("Error: Allocation failed for the log ring.\n"), 1);
+	if (pthread_create(&log->thread, NULL, log_writer, table) != 0)
+		return (printf("Error: pthread_create failed for log writer\n"), 1);
+	log->thread_valid = 1;
+	return (0);
+}
+
+/**
+ * @brief Waits, releasing `print_mutex`, until the ring has room for a
+ *        whole record that must not be dropped.
+ *
+ * A record containing a death, or any record under `--log=block`, is
+ * lossless. Room is made for all its lines before the first one is
+ * copied, so no other record lands in the middle of it. The run may end
+ * while the mutex is released: the record is then given up, unless it
+ * overrides the end of the run.
+ *
+ * @param table Pointer to the t_table structure (print_mutex held).
+ * @param events The events of the record.
+ * @param count Number of lines.
+ * @param len Length of the whole record.
+ * @param override_sim_end Non-zero to write it even after the end.
+ * @return 1 if the record can be written, 0 if the run ended meanwhile.
+ */
+static int	ring_reserve(t_table *table, const t_event *events, int count,
+		size_t len, int override_sim_end)
+{
+	t_log	*log;
+	int		i;
+
+	log = &table->log;
+	i = 0;
+	while (log->mode != LOG_BLOCK && i < count
+		&& event_type(events[i].status) != EV_DIED)
+		i++;
+	if (i == count)
+		return (1);
+	while (log->tail + len - __atomic_load_n(&log->head, __ATOMIC_ACQUIRE)
+		> LOG_RING_SIZE)
+	{
+		pthread_mutex_unlock(&table->print_mutex);
+		wake_writer(log);
+		usleep(100);
+		pthread_mutex_lock(&table->print_mutex);
+		if (!override_sim_end && is_simulation_over(table))
+			return (0);
+	}
+	return (1);
+}
+
+/**
+ * @brief Copies one line into the ring, or drops it if there is no room.
+ *
+ * Lossless records never get here without room (`ring_reserve`).
+ *
+ * @param table Pointer to the t_table structure (print_mutex held).
+ * @param line The formatted line.
+ * @param len Its length.
+ * @param type Its event type.
+ */
+static void	ring_put(t_table *table, const char *line, size_t len, int type)
+{
+	t_log		*log;
+	uint64_t	tail;
+	size_t		off;
+	size_t		first;
+
+	log = &table->log;
+	tail = log->tail;
+	if (tail + len - __atomic_load_n(&log->head, __ATOMIC_ACQUIRE)
+		> LOG_RING_SIZE)
+	{
+		log->dropped[type]++;
+		return ;
+	}
+	off = tail & (LOG_RING_SIZE - 1);
+	first = len;
+	if (first > LOG_RING_SIZE - off)
+		first = LOG_RING_SIZE - off;
+	memcpy(log->ring + off, line, first);
+	memcpy(log->ring, line + first, len - first);
+	__atomic_store_n(&log->tail, tail + len, __ATOMIC_SEQ_CST);
+	log->written[type]++;
+}
+
+/**
+ * @brief Outputs one formatted record according to the `--log` policy.
+ *
+ * Called by `print_events` under `print_mutex`. `buf` holds `count`
+ * lines; line `i` ends at `ends[i]`.
+ *
+ * @param table Pointer to the t_table structure.
+ * @param events The events the lines were formatted from.
+ * @param buf The formatted lines.
+ * @param ends End offset of each line in `buf`.
+ * @param count Number of lines.
+ * @param override_sim_end Non-zero for a death record.
+ * @return 0 once written (or dropped by the policy), 1 if given up
+ *         because the run ended while waiting for room.
+ */
+int	log_record(t_table *table, const t_event *events, const char *buf,
+		const int *ends, int count, int override_sim_end)
+{
+	t_log	*log;
+	int		type;
+	int		start;
+	int		i;
+
+	log = &table->log;
+	if (!log->ring)
+	{
+		sink_write(&table->sink, buf, ends[count - 1]);
+		return (0);
+	}
+	if (!ring_reserve(table, events, count, ends[count - 1],
+			override_sim_end))
+		return (1);
+	start = 0;
+	i = -1;
+	while (++i < count)
+	{
+		type = event_type(events[i].status);
+		if (log->mode == LOG_SAMPLE && type != EV_DIED
+			&& log->seen[type]++ % log->sample != 0)
+			log->sampled_out[type]++;
+		else
+			ring_put(table, buf + start, ends[i] - start, type);
+		start = ends[i];
+	}
+	wake_writer(log);
+	return (0);
+}
+
+/**
+ * @brief Waits until the writer has handed every queued line to the sink.
+ *
+ * Called at the end of each run, before the sink is flushed, while no
+ * philosopher is running.
+ *
+ * @param table Pointer to the t_table structure.
+ */
+void	log_drain(t_table *table)
+{
+	t_log	*log;
+
+	log = &table->log;
+	if (!log->thread_valid)
+		return ;
+	while (__atomic_load_n(&log->head, __ATOMIC_ACQUIRE)
+		!= __atomic_load_n(&log->tail, __ATOMIC_SEQ_CST))
+	{
+		wake_writer(log);
+		usleep(200);
+	}
+}
+
+/**
+ * @brief Stops the writer thread after it drained the ring.
+ *
+ * Warns on stderr if lines were dropped, so an incomplete output never
+ * goes unnoticed. Safe to call when the writer was never started.
+ *
+ * @param table Pointer to the t_table structure.
+ */
+void	log_destroy(t_table *table)
+{
+	t_log		*log;
+	long long	dropped;
+	int			type;
+
+	log = &table->log;
+	if (!log->thread_valid)
+		return ;
+	dropped = 0;
+	type = 0;
+	while (type < EVENT_TYPES)
+		dropped += log->dropped[type++];
+	if (dropped > 0)
+		fprintf(stderr, "log: %lld lines dropped, output is incomplete\n",
+			dropped);
+	__atomic_store_n(&log->shutdown, 1, __ATOMIC_RELEASE);
+	__atomic_add_fetch(&log->seq, 1, __ATOMIC_SEQ_CST);
+	futex_wake(&log->seq, 1);
+	pthread_join(log->thread, NULL);
+	log->thread_valid = 0;
+}
@@ -0,0 +1,233 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   lz.c                                               :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: vrads <vrads@student.42.fr>                +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/07/08 09:40:12 by vrads             #+#    #+#             */
+/*   Updated: 2025/07/08 16:12:40 by vrads            ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "philo.h"
+
+/*
+** Minimal LZ77 block codec for compressed traces, in the LZ4 block layout:
+** a sequence is
+**   token           high nibble: literal count, low nibble: match len - 4
+**   [lit extra]     bytes added to a nibble of 15, ended by a byte < 255
+**   literals
+**   offset          2 bytes, little endian, 1..65535 back
+**   [match extra]
+** and the last sequence carries literals only. Each block is compressed
+** on its own, so every trace frame decodes independently.
+*/
+
+/**
+ * @brief Reads 4 bytes as a native-endian word (no alignment needed).
+ *
+ * @param p Pointer to the bytes.
+ * @return The word.
+ */
+static uint32_t	read32(const unsigned char *p)
+{
+	uint32_t	v;
+
+	memcpy(&v, p, sizeof(v));
+	return (v);
+}
+
+/**
+ * @brief Writes the 255-run extension of a length that overflowed a nibble.
+ *
+ * @param dst Output buffer.
+ * @param op Current output position.
+ * @param rest Length minus 15.
+ * @return The new output position.
+ */
+static size_t	put_length(unsigned char *dst, size_t op, size_t rest)
+{
+	while (rest >= 255)
+	{
+		dst[op++] = 255;
+		rest -= 255;
+	}
+	dst[op++] = rest;
+	return (op);
+}
+
+/**
+ * @brief Emits one sequence: literals, then a match unless `mlen` is 0.
+ *
+ * @param dst Output buffer.
+ * @param op Current output position.
+ * @param lit Literal bytes.
+ * @param lit_len Number of literal bytes.
+ * @param off Match offset.
+ * @param mlen Match length, 0 for the final literals-only sequence.
+ * @return The new output position.
+ */
+static size_t	put_sequence(unsigned char *dst, size_t op,
+		const unsigned char *lit, size_t lit_len, size_t off, size_t mlen)
+{
+	size_t	token;
+
+	token = (lit_len < 15 ? lit_len : 15) << 4;
+	if (mlen)
+		token |= (mlen - 4 < 15 ? mlen - 4 : 15);
+	dst[op++] = token;
+	if (lit_len >= 15)
+		op = put_length(dst, op, lit_len - 15);
+	memcpy(dst + op, lit, lit_len);
+	op += lit_len;
+	if (!mlen)
+		return (op);
+	dst[op++] = off & 0xff;
+	dst[op++] = off >> 8;
+	if (mlen - 4 >= 15)
+		op = put_length(dst, op, mlen - 4 - 15);
+	return (op);
+}
+
+/**
+ * @brief Compresses `n` bytes of `src` into `dst`.
+ *
+ * Greedy matching with a 4-byte hash table of LZ_HASH_BITS bits.
+ *
+ * @param src Input bytes.
+ * @param n Input length (at most 2^32 - 2).
+ * @param dst Output buffer of at least `LZ_BOUND(n)` bytes.
+ * @return Compressed length.
+ */
+size_t	lz_compress(const unsigned char *src, size_t n, unsigned char *dst)
+{
+	uint32_t	table[1 << LZ_HASH_BITS];
+	size_t		ip;
+	size_t		anchor;
+	size_t		op;
+	size_t		ref;
+	size_t		mlen;
+	uint32_t	h;
+
+	memset(table, 0, sizeof(table));
+	ip = 0;
+	anchor = 0;
+	op = 0;
+	while (ip + 4 <= n)
+	{
+		h = (read32(src + ip) * 2654435761u) >> (32 - LZ_HASH_BITS);
+		ref = table[h];
+		table[h] = ip + 1;
+		if (ref-- == 0 || ip - ref > 65535
+			|| read32(src + ref) != read32(src + ip))
+		{
+			ip++;
+			continue ;
+		}
+		mlen = 4;
+		while (ip + mlen < n && src[ref + mlen] == src[ip + mlen])
+			mlen++;
+		op = put_sequence(dst, op, src + anchor, ip - anchor, ip - ref, mlen);
+		ip += mlen;
+		anchor = ip;
+	}
+	return (put_sequence(dst, op, src + anchor, n - anchor, 0, 0));
+}
+
+/**
+ * @brief Reads a length extension (see `put_length`).
+ *
+ * @param src Compressed bytes.
+ * @param n Compressed length.
+ * @param ip Input position, advanced past the extension.
+ * @param len Nibble value (15) the extension adds to.
+ * @return The extended length, or (size_t)-1 if the input ends early.
+ */
+static size_t	get_length(const unsigned char *src, size_t n, size_t *ip,
+		size_t len)
+{
+	unsigned char	b;
+
+	b = 255;
+	while (b == 255)
+	{
+		if (*ip >= n)
+			return ((size_t)-1);
+		b = src[(*ip)++];
+		len += b;
+	}
+	return (len);
+}
+
+/**
+ * @brief Decompresses a block produced by `lz_compress`.
+ *
+ * Every length and offset is bounds-checked, so corrupt input is
+ * rejected instead of overrunning `dst`.
+ *
+ * @param src Compressed bytes.
+ * @param n Compressed length.
+ * @param dst Output buffer.
+ * @param cap Capacity of `dst`.
+ * @return Decompressed length, or -1 if the block is corrupt.
+ */
+long	lz_decompress(const unsigned char *src, size_t n, unsigned char *dst,
+		size_t cap)
+{
+	size_t	ip;
+	size_t	op;
+	size_t	len;
+	size_t	off;
+
+	ip = 0;
+	op = 0;
+	while (ip < n)
+	{
+		len = src[ip++];
+		off = len & 15;
+		len >>= 4;
+		if (len == 15)
+			len = get_length(src, n, &ip, len);
+		if (len > n - ip || len > cap - op)
+			return (-1);
+		memcpy(dst + op, src + ip, len);
+		ip += len;
+		op += len;
+		if (ip == n)
+			break ;
+		len = off;
+		if (ip + 2 > n)
+			return (-1);
+		off = src[ip] | (src[ip + 1] << 8);
+		ip += 2;
+		if (len == 15)
+			len = get_length(src, n, &ip, len);
+		if (len == (size_t)-1 || off == 0 || off > op || len + 4 > cap - op)
+			return (-1);
+		len += 4;
+		while (len--)
+		{
+			dst[op] = dst[op - off];
+			op++;
+		}
+	}
+	return (op);
+}
+
+/**
+ * @brief FNV-1a hash of a block, stored in trace frames to detect damage.
+ *
+ * @param p Bytes to hash.
+ * @param n Number of bytes.
+ * @return 32-bit hash.
+ */
+uint32_t	lz_checksum(const unsigned char *p, size_t n)
+{
+	uint32_t	h;
+
+	h = 2166136261u;
+	while (n--)
+		h = (h ^ *p++) * 16777619u;
+	return (h);
+}
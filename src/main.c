@@ -6,7 +6,7 @@
 /*   By: vrads <vrads@student.42.fr>                +#+  +:+       +#+        */
 /*                                                +#+#+#+#+#+   +#+           */
 /*   Created: 2025/06/17 16:05:49 by vrads             #+#    #+#             */
-/*   Updated: 2025/06/17 16:05:51 by vrads            ###   ########.fr       */
+/*   Updated: 2025/07/15 11:04:26 by vrads            ###   ########.fr       */
 /*                                                                            */
 /* ************************************************************************** */
 
@@ -21,23 +21,71 @@ void	print_usage(void)
 {
 	printf("Usage: ./philo number_of_philosophers time_to_die time_to_eat "
 		   "time_to_sleep [number_of_times_each_philosopher_must_eat]\n");
-	printf("All time arguments should be in milliseconds.\n");
+	printf("Durations are in milliseconds, or suffixed with us, ms or s "
+		"(e.g. 1.5s).\n");
+	printf("Options:\n");
+	printf("  --time-scale=F     Run every duration F times slower "
+		"(F < 1 compresses time)\n");
+	printf("  --real-timestamps  Print wall-clock instead of simulated "
+		"timestamps\n");
+	printf("  --checkpoint=FILE  Snapshot the table to FILE on SIGUSR1\n");
+	printf("  --checkpoint-interval=DURATION  Also snapshot periodically\n");
+	printf("  --resume=FILE      Resume from a checkpoint taken with the same "
+		"arguments\n");
+	printf("  --hugepages        Back the table memory with huge pages\n");
+	printf("  --max-philos=N     Allow up to N philosophers (default 200)\n");
+	printf("  --stats            Print run statistics to stderr\n");
+	printf("  --think=MODE       Think delay: adaptive (default) or static\n");
+	printf("  --repeat=K         Run the simulation K times on the same "
+		"threads\n");
+	printf("  --sink=MODE        Output: stdio (default), write (buffered) "
+		"or uring\n");
+	printf("  --log=POLICY       When output lags: block (default), drop "
+		"or sample:N\n");
+	printf("  --compress         Write compressed frames (see "
+		"tools/trace_decode)\n");
+	printf("  --timer=MODE       Phase waits: wheel (shared timer, default) "
+		"or sleep\n");
+	printf("  --realtime         Lock memory, use SCHED_FIFO, pin the "
+		"output writer\n");
+	printf("  --check-scenarios=FILE  Validate a scenario file and exit\n");
+	printf("  --detect=MODE      Death detection: monitor (thread, default) "
+		"or self\n");
+	printf("  --shards=K         Run the ring as K slices of one thread "
+		"each\n");
+	printf("  --scheduled        Eat in precomputed slots instead of "
+		"racing for forks\n");
+	printf("  --record=FILE      Log fork order and phase timings for "
+		"--replay\n");
+	printf("  --replay=FILE      Re-run a recorded table exactly, on "
+		"virtual time\n");
+	printf("  --procs=P          Run the ring as P processes passing "
+		"forks over sockets\n");
+	printf("  --clock=MODE       Timestamps: tsc (calibrated, default when "
+		"reliable) or vdso\n");
+	printf("  --clock-bench[=S]  Time the clocks, measure drift over S "
+		"seconds and exit\n");
+	printf("  --analyze[=run]    Predict slack and throughput and exit, or "
+		"compare with a run\n");
 }
 
 /**
  * @brief Main entry point for the Dining Philosophers simulation.
  *
- * Parses command-line arguments, initializes simulation state, launches
- * philosopher and monitor threads, waits for simulation completion,
- * and cleans up resources.
+ * Extracts `--options` (with `--check-scenarios`, only validates the
+ * given file; with `--clock-bench`, only measures the clock; with
+ * `--analyze`, only prints the predicted schedule), parses the positional
+ * arguments, initializes the simulation clock and state, runs the
+ * simulation (`--repeat` times) on a pool of philosopher and monitor
+ * threads, and cleans up resources.
  *
  * @param argc The number of command-line arguments.
  * @param argv An array of command-line argument strings.
  *             Expected arguments:
  *             1. number_of_philosophers
- *             2. time_to_die (ms)
- *             3. time_to_eat (ms)
- *             4. time_to_sleep (ms)
+ *             2. time_to_die (ms, or with a us/ms/s suffix)
+ *             3. time_to_eat
+ *             4. time_to_sleep
  *             5. [number_of_times_each_philosopher_must_eat] (optional)
  * @return 0 on successful completion, 1 on error (e.g., invalid arguments,
  *         initialization failure, thread creation failure).
@@ -45,27 +93,39 @@ void	print_usage(void)
 int	main(int argc, char **argv)
 {
 	t_table		table;
-	pthread_t	monitor_thread;
 
+	if (parse_options(&table.opts, &argc, argv) != 0)
+	{
+		print_usage();
+		return (1);
+	}
+	if (table.opts.check_file)
+		return (check_scenario_file(table.opts.check_file));
+	if (table.opts.clock_bench > 0)
+		return (clock_bench(&table.opts));
 	if (argc < 5 || argc > 6)
 	{
 		print_usage();
 		return (1);
 	}
+	if (table.opts.analyze == ANALYZE_ONLY)
+		return (analyze_only(&table, argc, argv));
 
+	clock_init(table.opts.time_scale, table.opts.clock_mode);
+	stats_begin_startup(&table);
 	if (initialize_simulation(&table, argc, argv) != 0)
 	{
 		cleanup(&table);
 		return (1);
 	}
 
-	if (launch_threads(&table, &monitor_thread) != 0)
+	analyze_begin(&table);
+	if (run_simulations(&table) != 0)
 	{
 		cleanup(&table);
 		return (1);
 	}
-
-	pthread_join(monitor_thread, NULL);
+	analyze_end(&table);
 
 	cleanup(&table);
 	return (0);
@@ -0,0 +1,179 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   monitor_events.c                                   :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: vrads <vrads@student.42.fr>                +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/06/19 10:12:03 by vrads             #+#    #+#             */
+/*   Updated: 2025/06/20 11:05:37 by vrads            ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "philo.h"
+
+/**
+ * @brief Registers `fd` for read readiness on the epoll instance `epfd`.
+ *
+ * @param epfd The epoll instance.
+ * @param fd The descriptor to watch.
+ * @return 0 on success, -1 on error from `epoll_ctl`.
+ */
+static int	watch_fd(int epfd, int fd)
+{
+	struct epoll_event	ev;
+
+	ev.events = EPOLLIN;
+	ev.data.fd = fd;
+	return (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev));
+}
+
+/**
+ * @brief Sets up the epoll/timerfd/eventfd trio used by the monitor.
+ *
+ * The monitor blocks in `epoll_wait` on two descriptors: a `timerfd` armed
+ * for the earliest possible death, and an `eventfd` that philosophers write
+ * to when that earliest deadline moves (or when they become full).
+ * If any of the descriptors cannot be created, every fd is left at -1 and
+ * the monitor falls back to the classic 1 ms polling loop.
+ *
+ * @param table Pointer to the t_table structure.
+ * @return 0 if event-driven monitoring is available, 1 if falling back.
+ */
+int	init_monitor_events(t_table *table)
+{
+	table->deadline_owner = 0;
+	table->monitor_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	table->monitor_timer_fd = timerfd_create(CLOCK_MONOTONIC,
+			TFD_NONBLOCK | TFD_CLOEXEC);
+	table->monitor_wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (table->monitor_epoll_fd < 0 || table->monitor_timer_fd < 0
+		|| table->monitor_wake_fd < 0)
+	{
+		destroy_monitor_events(table);
+		return (1);
+	}
+	if (watch_fd(table->monitor_epoll_fd, table->monitor_timer_fd) != 0
+		|| watch_fd(table->monitor_epoll_fd, table->monitor_wake_fd) != 0)
+	{
+		destroy_monitor_events(table);
+		return (1);
+	}
+	return (0);
+}
+
+/**
+ * @brief Closes the monitor's event descriptors, if any were opened.
+ *
+ * Safe to call more than once; every closed fd is reset to -1.
+ *
+ * @param table Pointer to the t_table structure.
+ */
+void	destroy_monitor_events(t_table *table)
+{
+	if (table->monitor_epoll_fd >= 0)
+		close(table->monitor_epoll_fd);
+	if (table->monitor_timer_fd >= 0)
+		close(table->monitor_timer_fd);
+	if (table->monitor_wake_fd >= 0)
+		close(table->monitor_wake_fd);
+	table->monitor_epoll_fd = -1;
+	table->monitor_timer_fd = -1;
+	table->monitor_wake_fd = -1;
+}
+
+/**
+ * @brief Wakes the monitor so it rescans the table immediately.
+ *
+ * Called by a philosopher whose meal moved the earliest deadline, or who
+ * just became full. A no-op in polling mode.
+ *
+ * @param table Pointer to the t_table structure.
+ */
+void	signal_monitor(t_table *table)
+{
+	uint64_t	one;
+
+	if (table->monitor_wake_fd < 0)
+		return ;
+	one = 1;
+	if (write(table->monitor_wake_fd, &one, sizeof(one)) < 0)
+		return ;
+}
+
+/**
+ * @brief Finds the earliest moment at which any philosopher could die.
+ *
+ * Scans every philosopher's `last_meal_time` under `meal_time_mutex` and
+ * publishes the id of the philosopher owning the earliest deadline in
+ * `table->deadline_owner`, so only that philosopher needs to signal the
+ * monitor when it eats.
+ *
+ * @param table Pointer to the t_table structure.
+ * @return The earliest time (simulated us) at which `check_death` would
+ *         report a death.
+ */
+long long	next_death_deadline(t_table *table)
+{
+	long long	earliest;
+	int			owner;
+	int			i;
+
+	pthread_mutex_lock(&table->meal_time_mutex);
+	earliest = table->philos[0].last_meal_time;
+	owner = table->philos[0].id;
+	i = 1;
+	while (i < table->num_philos)
+	{
+		if (table->philos[i].last_meal_time < earliest)
+		{
+			earliest = table->philos[i].last_meal_time;
+			owner = table->philos[i].id;
+		}
+		i++;
+	}
+	__atomic_store_n(&table->deadline_owner, owner, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&table->meal_time_mutex);
+	return (earliest + table->time_to_die + 1);
+}
+
+/**
+ * @brief Blocks the monitor until `deadline` or until a philosopher signals.
+ *
+ * Arms the timerfd for the remaining time (a zero value would disarm it,
+ * so a past deadline is armed for 1 ns) and waits in `epoll_wait`. The
+ * simulated delay is converted to wall-clock time with `sim_to_real_us`.
+ * Both descriptors are drained before returning so the next wait starts
+ * from a clean state. In polling mode this degrades to `usleep(1000)`.
+ *
+ * @param table Pointer to the t_table structure.
+ * @param deadline Absolute simulated time in microseconds, as returned by
+ *                 `next_death_deadline`.
+ */
+void	wait_for_deadline(t_table *table, long long deadline)
+{
+	struct itimerspec	its;
+	struct epoll_event	evs[2];
+	long long			delay_us;
+	uint64_t			drain;
+
+	if (table->monitor_epoll_fd < 0)
+	{
+		usleep(1000);
+		return ;
+	}
+	delay_us = sim_to_real_us(deadline - get_time_us());
+	if (delay_us <= 0)
+		delay_us = 0;
+	its.it_interval.tv_sec = 0;
+	its.it_interval.tv_nsec = 0;
+	its.it_value.tv_sec = delay_us / 1000000;
+	its.it_value.tv_nsec = (delay_us % 1000000) * 1000 + 1;
+	timerfd_settime(table->monitor_timer_fd, 0, &its, NULL);
+	if (epoll_wait(table->monitor_epoll_fd, evs, 2, -1) < 0)
+		return ;
+	if (read(table->monitor_timer_fd, &drain, sizeof(drain)) < 0)
+		drain = 0;
+	if (read(table->monitor_wake_fd, &drain, sizeof(drain)) < 0)
+		drain = 0;
+}
@@ -6,18 +6,57 @@
 /*   By: vrads <vrads@student.42.fr>                +#+  +:+       +#+        */
 /*                                                +#+#+#+#+#+   +#+           */
 /*   Created: 2025/06/17 16:06:59 by vrads             #+#    #+#             */
-/*   Updated: 2025/06/17 16:07:00 by vrads            ###   ########.fr       */
+/*   Updated: 2025/07/15 17:08:15 by vrads            ###   ########.fr       */
 /*                                                                            */
 /* ************************************************************************** */
 
 #include "philo.h"
 
+/**
+ * @brief Ends the simulation with the death of `philo`.
+ *
+ * Sets the end flag (unless already set), prints "died" and releases the
+ * philosophers parked in the timer service (`timer_stop`). How late the
+ * death was noticed, relative to the exact deadline, is kept for
+ * `--stats`. Called by the monitor, or by the philosopher itself with
+ * `--detect=self`. The death is logged for `--record` with the time the
+ * "died" line shows. The flag is set under `print_mutex`, so that log
+ * entry comes after every line printed before the death.
+ *
+ * @param philo Pointer to the t_philo structure of the dead philosopher.
+ * @param late_us Time past the deadline, in simulated microseconds.
+ * @return 1 if this call ended the simulation, 0 if it had already ended.
+ */
+int	declare_death(t_philo *philo, long long late_us)
+{
+	t_event	died;
+
+	pthread_mutex_lock(&philo->table->print_mutex);
+	pthread_mutex_lock(&philo->table->sim_end_mutex);
+	if (philo->table->simulation_should_end)
+	{
+		pthread_mutex_unlock(&philo->table->sim_end_mutex);
+		pthread_mutex_unlock(&philo->table->print_mutex);
+		return (0);
+	}
+	philo->table->simulation_should_end = 1;
+	philo->table->stats.death_latency_us = late_us;
+	died.time_us = get_time_us();
+	died.status = "died";
+	replay_record_at(philo->table, 0, REPLAY_DIED(philo->id), died.time_us);
+	pthread_mutex_unlock(&philo->table->sim_end_mutex);
+	pthread_mutex_unlock(&philo->table->print_mutex);
+	print_events(philo, &died, 1, 1);
+	timer_stop(philo->table);
+	philo->state = DEAD;
+	return (1);
+}
+
 /**
  * @brief Checks if a philosopher has died due to starvation.
  *
  * Calculates the time since the philosopher's last meal. If this time
- * exceeds `time_to_die`, the philosopher is marked as dead, the simulation
- * end flag is set (if not already set), and a "died" status is printed.
+ * exceeds `time_to_die`, the death is declared (`declare_death`).
  *
  * @param philo Pointer to the t_philo structure for the philosopher to check.
  * @return 1 if the philosopher has died or the simulation has already ended,
@@ -28,21 +67,12 @@ int	check_death(t_philo *philo)
 	long long	time_since_last_meal;
 
 	pthread_mutex_lock(&philo->table->meal_time_mutex);
-	time_since_last_meal = get_time_ms() - philo->last_meal_time;
+	time_since_last_meal = get_time_us() - philo->last_meal_time;
 	pthread_mutex_unlock(&philo->table->meal_time_mutex);
 
 	if (time_since_last_meal > philo->table->time_to_die)
 	{
-		pthread_mutex_lock(&philo->table->sim_end_mutex);
-		if (!philo->table->simulation_should_end)
-		{
-			philo->table->simulation_should_end = 1;
-			pthread_mutex_unlock(&philo->table->sim_end_mutex);
-			print_status(philo, "died", 1);
-			philo->state = DEAD;
-			return (1);
-		}
-		pthread_mutex_unlock(&philo->table->sim_end_mutex);
+		declare_death(philo, time_since_last_meal - philo->table->time_to_die);
 		return (1);
 	}
 	return (0);
@@ -82,7 +112,9 @@ static int	is_philo_not_full_and_sim_running(t_philo *philo)
  * @brief Finalizes simulation if all philosophers are full.
  *
  * This helper for `check_all_full` sets the simulation end flag if
- * `all_philos_are_full_flag` is true and the simulation hasn't already ended.
+ * `all_philos_are_full_flag` is true and the simulation hasn't already ended,
+ * then stops the timer service. As in `declare_death`, the flag is set
+ * under `print_mutex` for the `--record` log.
  *
  * @param table Pointer to the t_table structure.
  * @param all_philos_are_full_flag Integer flag (1 if all philosophers are full, 0 otherwise).
@@ -92,12 +124,16 @@ static int	finalize_if_all_full(t_table *table, int all_philos_are_full_flag)
 {
 	if (all_philos_are_full_flag)
 	{
+		pthread_mutex_lock(&table->print_mutex);
 		pthread_mutex_lock(&table->sim_end_mutex);
 		if (!table->simulation_should_end)
 		{
 			table->simulation_should_end = 1;
+			replay_record(table, 0, REPLAY_END);
 		}
 		pthread_mutex_unlock(&table->sim_end_mutex);
+		pthread_mutex_unlock(&table->print_mutex);
+		timer_stop(table);
 		return (1);
 	}
 	return (0);
@@ -136,24 +172,63 @@ int	check_all_full(t_table *table)
 	return (finalize_if_all_full(table, all_philos_considered_full));
 }
 
+/**
+ * @brief Computes when the monitor must wake up next.
+ *
+ * This is the earliest possible death, the next periodic checkpoint or
+ * the confirmation of a suspected deadlock, whichever comes first. The
+ * monitor also never sleeps longer than `time_to_eat`: a deadlocked table
+ * stops signalling it, and the detector must still run before the first
+ * death.
+ *
+ * @param table Pointer to the t_table structure.
+ * @param confirm_at Pending deadlock confirmation (from `detect_deadlock`),
+ *                   or -1.
+ * @return Absolute simulated time in microseconds.
+ */
+static long long	next_wakeup(t_table *table, long long confirm_at)
+{
+	long long	deadline;
+	long long	cap;
+
+	deadline = next_death_deadline(table);
+	cap = get_time_us() + table->time_to_eat;
+	if (cap < deadline)
+		deadline = cap;
+	if (confirm_at >= 0 && confirm_at < deadline)
+		deadline = confirm_at;
+	if (table->next_checkpoint >= 0
+		&& table->start_time + table->next_checkpoint < deadline)
+		deadline = table->start_time + table->next_checkpoint;
+	return (deadline);
+}
+
 /**
  * @brief The main routine for the monitoring thread.
  *
- * Continuously checks the status of all philosophers. In each iteration:
- * 1. It checks each philosopher for death using `check_death`.
- * 2. It checks if all philosophers are full using `check_all_full` (if applicable).
- * If either condition causes the simulation to end, the monitoring routine exits.
- * A small delay (`usleep`) is introduced to prevent busy-waiting and reduce CPU usage.
- * It also checks `is_simulation_over` periodically to exit if another thread
- * (like a failed philosopher thread creation) has ended the simulation.
+ * Each iteration:
+ * 1. Checks every philosopher for death using `check_death`.
+ * 2. Checks if all philosophers are full using `check_all_full` (if
+ *    applicable), and `is_simulation_over` in case another thread (like
+ *    a failed philosopher thread creation) ended the simulation. If any
+ *    of these ends the simulation, the monitoring routine exits.
+ * 3. Looks for a cycle in the wait-for graph (`detect_deadlock`).
+ * 4. Takes a checkpoint if one was requested or is due (`maybe_checkpoint`).
+ * 5. Ends the scan: computes the earliest possible death or checkpoint
+ *    (`next_wakeup`) and fires the `monitor_scan` tracepoint with it.
+ * 6. Blocks until that deadline, or until a philosopher signals that it
+ *    moved. Without timerfd/eventfd support, `wait_for_deadline` falls
+ *    back to a 1 ms `usleep`.
  *
  * @param arg Pointer to the t_table structure, passed as `void*`.
  * @return NULL when the simulation ends.
  */
 void	*monitoring_routine(void *arg)
 {
-	t_table	*table;
-	int		i;
+	t_table		*table;
+	long long	deadline;
+	long long	confirm_at;
+	int			i;
 
 	table = (t_table *)arg;
 	while (1)
@@ -161,15 +236,17 @@ void	*monitoring_routine(void *arg)
 		i = 0;
 		while (i < table->num_philos)
 		{
-			if (check_death(&table->philos[i]) || check_all_full(table))
-			{
+			if (check_death(&table->philos[i]))
 				return (NULL);
-			}
 			i++;
 		}
-		usleep(1000);
-		if (is_simulation_over(table))
+		if (check_all_full(table) || is_simulation_over(table))
 			return (NULL);
+		confirm_at = detect_deadlock(table);
+		maybe_checkpoint(table);
+		deadline = next_wakeup(table, confirm_at);
+		PHILO_TRACE2(monitor_scan, table->num_philos, deadline);
+		wait_for_deadline(table, deadline);
 	}
 	return (NULL);
 }
@@ -0,0 +1,624 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   options.c                                          :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: vrads <vrads@student.42.fr>                +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/06/20 09:52:17 by vrads             #+#    #+#             */
+/*   Updated: 2025/07/14 18:27:05 by vrads            ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "philo.h"
+
+/**
+ * @brief Handles `--time-scale=F`.
+ *
+ * Accepts any finite factor strictly greater than 0. See `clock_init` for
+ * the meaning of the factor.
+ *
+ * @param opts Pointer to the t_options structure to update.
+ * @param value The text after `=`, or NULL if none was given.
+ * @return 0 on success, 1 if the value is missing or invalid.
+ */
+static int	opt_time_scale(t_options *opts, const char *value)
+{
+	char	*end;
+
+	if (!value || !*value)
+		return (1);
+	opts->time_scale = strtod(value, &end);
+	if (*end != '\0' || !(opts->time_scale > 0.0)
+		|| opts->time_scale > 1e6)
+		return (1);
+	return (0);
+}
+
+/**
+ * @brief Handles `--real-timestamps`.
+ *
+ * Output timestamps are reported in wall-clock milliseconds instead of
+ * simulated milliseconds. Only differs from the default under
+ * `--time-scale`.
+ *
+ * @param opts Pointer to the t_options structure to update.
+ * @param value Must be NULL (the option takes no value).
+ * @return 0 on success, 1 if a value was given.
+ */
+static int	opt_real_timestamps(t_options *opts, const char *value)
+{
+	if (value)
+		return (1);
+	opts->real_timestamps = 1;
+	return (0);
+}
+
+/**
+ * @brief Handles `--checkpoint=FILE`.
+ *
+ * Enables snapshots: on SIGUSR1, and periodically with
+ * `--checkpoint-interval`.
+ *
+ * @param opts Pointer to the t_options structure to update.
+ * @param value The checkpoint path.
+ * @return 0 on success, 1 if the path is missing.
+ */
+static int	opt_checkpoint(t_options *opts, const char *value)
+{
+	if (!value || !*value)
+		return (1);
+	opts->checkpoint_file = value;
+	return (0);
+}
+
+/**
+ * @brief Handles `--checkpoint-interval=DURATION`.
+ *
+ * Takes a snapshot every DURATION of simulated time (requires
+ * `--checkpoint`). Milliseconds unless suffixed (see `parse_duration`).
+ *
+ * @param opts Pointer to the t_options structure to update.
+ * @param value The interval.
+ * @return 0 on success, 1 if the value is not a positive duration.
+ */
+static int	opt_checkpoint_interval(t_options *opts, const char *value)
+{
+	if (!value || parse_duration(value, &opts->checkpoint_interval) != 0)
+		return (1);
+	return (opts->checkpoint_interval == 0);
+}
+
+/**
+ * @brief Handles `--resume=FILE`.
+ *
+ * @param opts Pointer to the t_options structure to update.
+ * @param value Path of a checkpoint written by `--checkpoint`.
+ * @return 0 on success, 1 if the path is missing.
+ */
+static int	opt_resume(t_options *opts, const char *value)
+{
+	if (!value || !*value)
+		return (1);
+	opts->resume_file = value;
+	return (0);
+}
+
+/**
+ * @brief Handles `--hugepages`.
+ *
+ * Backs the table arena with huge pages when the host provides them.
+ *
+ * @param opts Pointer to the t_options structure to update.
+ * @param value Must be NULL (the option takes no value).
+ * @return 0 on success, 1 if a value was given.
+ */
+static int	opt_hugepages(t_options *opts, const char *value)
+{
+	if (value)
+		return (1);
+	opts->hugepages = 1;
+	return (0);
+}
+
+/**
+ * @brief Handles `--max-philos=N`.
+ *
+ * Raises (or lowers) the 200 philosopher limit for large-N runs.
+ *
+ * @param opts Pointer to the t_options structure to update.
+ * @param value The new limit.
+ * @return 0 on success, 1 if the value is not a positive integer.
+ */
+static int	opt_max_philos(t_options *opts, const char *value)
+{
+	long long	n;
+
+	if (!value || parse_count(value, 10000000L, &n) != 0 || n == 0)
+		return (1);
+	opts->max_philos = n;
+	return (0);
+}
+
+/**
+ * @brief Handles `--stats`.
+ *
+ * Prints run statistics (startup time, page faults, ...) to stderr at exit.
+ *
+ * @param opts Pointer to the t_options structure to update.
+ * @param value Must be NULL (the option takes no value).
+ * @return 0 on success, 1 if a value was given.
+ */
+static int	opt_stats(t_options *opts, const char *value)
+{
+	if (value)
+		return (1);
+	opts->stats = 1;
+	return (0);
+}
+
+/**
+ * @brief Handles `--think=static|adaptive`.
+ *
+ * Selects how long philosophers think before competing for forks again
+ * (see think_control.c).
+ *
+ * @param opts Pointer to the t_options structure to update.
+ * @param value "static" or "adaptive".
+ * @return 0 on success, 1 for any other value.
+ */
+static int	opt_think(t_options *opts, const char *value)
+{
+	if (value && strcmp(value, "static") == 0)
+		opts->think_mode = THINK_STATIC;
+	else if (value && strcmp(value, "adaptive") == 0)
+		opts->think_mode = THINK_ADAPTIVE;
+	else
+		return (1);
+	return (0);
+}
+
+/**
+ * @brief Handles `--repeat=K`.
+ *
+ * Runs K simulations back to back, reusing the same threads (warm
+ * restart), e.g. for test harnesses.
+ *
+ * @param opts Pointer to the t_options structure to update.
+ * @param value The number of runs.
+ * @return 0 on success, 1 if the value is not a positive integer.
+ */
+static int	opt_repeat(t_options *opts, const char *value)
+{
+	long long	n;
+
+	if (!value || parse_count(value, 1000000L, &n) != 0 || n == 0)
+		return (1);
+	opts->repeat = n;
+	return (0);
+}
+
+/**
+ * @brief Handles `--sink=stdio|write|uring`.
+ *
+ * Selects how simulation lines reach stdout (see output_sink.c).
+ *
+ * @param opts Pointer to the t_options structure to update.
+ * @param value "stdio", "write" or "uring".
+ * @return 0 on success, 1 for any other value.
+ */
+static int	opt_sink(t_options *opts, const char *value)
+{
+	if (value && strcmp(value, "stdio") == 0)
+		opts->sink_mode = SINK_STDIO;
+	else if (value && strcmp(value, "write") == 0)
+		opts->sink_mode = SINK_WRITE;
+	else if (value && strcmp(value, "uring") == 0)
+		opts->sink_mode = SINK_URING;
+	else
+		return (1);
+	return (0);
+}
+
+/**
+ * @brief Handles `--log=block|drop|sample:N`.
+ *
+ * Selects what happens to output lines when stdout cannot keep up (see
+ * log_policy.c).
+ *
+ * @param opts Pointer to the t_options structure to update.
+ * @param value "block", "drop" or "sample:N" with N >= 1.
+ * @return 0 on success, 1 for any other value.
+ */
+static int	opt_log(t_options *opts, const char *value)
+{
+	long long	n;
+
+	if (value && strcmp(value, "block") == 0)
+		opts->log_mode = LOG_BLOCK;
+	else if (value && strcmp(value, "drop") == 0)
+		opts->log_mode = LOG_DROP;
+	else if (value && strncmp(value, "sample:", 7) == 0)
+	{
+		if (parse_count(value + 7, INT_MAX, &n) != 0 || n == 0)
+			return (1);
+		opts->log_mode = LOG_SAMPLE;
+		opts->log_sample = n;
+	}
+	else
+		return (1);
+	return (0);
+}
+
+/**
+ * @brief Handles `--compress`.
+ *
+ * Writes the output as LZ-compressed frames (see trace_compress.c);
+ * `tools/trace_decode` turns them back into text.
+ *
+ * @param opts Pointer to the t_options structure to update.
+ * @param value Must be NULL (the option takes no value).
+ * @return 0 on success, 1 if a value was given.
+ */
+static int	opt_compress(t_options *opts, const char *value)
+{
+	if (value)
+		return (1);
+	opts->compress = 1;
+	return (0);
+}
+
+/**
+ * @brief Handles `--timer=wheel|sleep`.
+ *
+ * Selects how philosophers wait out eating, sleeping and thinking: parked
+ * on a futex woken by the shared timer service (see timer_wheel.c), or
+ * each in its own `usleep` loop.
+ *
+ * @param opts Pointer to the t_options structure to update.
+ * @param value "wheel" or "sleep".
+ * @return 0 on success, 1 for any other value.
+ */
+static int	opt_timer(t_options *opts, const char *value)
+{
+	if (value && strcmp(value, "wheel") == 0)
+		opts->timer_mode = TIMER_WHEEL;
+	else if (value && strcmp(value, "sleep") == 0)
+		opts->timer_mode = TIMER_SLEEP;
+	else
+		return (1);
+	return (0);
+}
+
+/**
+ * @brief Handles `--check-scenarios=FILE`.
+ *
+ * Validates every line of a scenario or sweep file instead of running a
+ * simulation (see scenario_file.c).
+ *
+ * @param opts Pointer to the t_options structure to update.
+ * @param value The file path.
+ * @return 0 on success, 1 if the path is missing.
+ */
+static int	opt_check_scenarios(t_options *opts, const char *value)
+{
+	if (!value || !*value)
+		return (1);
+	opts->check_file = value;
+	return (0);
+}
+
+/**
+ * @brief Handles `--realtime`.
+ *
+ * Prefaults and locks memory, runs the threads under SCHED_FIFO and pins
+ * the output writer away from them, as far as privileges allow (see
+ * realtime.c).
+ *
+ * @param opts Pointer to the t_options structure to update.
+ * @param value Must be NULL (the option takes no value).
+ * @return 0 on success, 1 if a value was given.
+ */
+static int	opt_realtime(t_options *opts, const char *value)
+{
+	if (value)
+		return (1);
+	opts->realtime = 1;
+	return (0);
+}
+
+/**
+ * @brief Handles `--analyze[=run]`.
+ *
+ * Prints the steady-state schedule predicted from the arguments (see
+ * analyze.c) and exits; with `=run`, prints it to stderr and then runs
+ * the simulation to compare.
+ *
+ * @param opts Pointer to the t_options structure to update.
+ * @param value NULL or "run".
+ * @return 0 on success, 1 on any other value.
+ */
+static int	opt_analyze(t_options *opts, const char *value)
+{
+	if (!value)
+		opts->analyze = ANALYZE_ONLY;
+	else if (strcmp(value, "run") == 0)
+		opts->analyze = ANALYZE_RUN;
+	else
+		return (1);
+	return (0);
+}
+
+/**
+ * @brief Handles `--detect=MODE`.
+ *
+ * `monitor` (the default) runs a monitor thread that watches every
+ * deadline; `self` has each philosopher bound its own waits by its death
+ * deadline instead (see self_detect.c).
+ *
+ * @param opts Pointer to the t_options structure to update.
+ * @param value "monitor" or "self".
+ * @return 0 on success, 1 on any other value.
+ */
+static int	opt_detect(t_options *opts, const char *value)
+{
+	if (value && strcmp(value, "monitor") == 0)
+		opts->detect_mode = DETECT_MONITOR;
+	else if (value && strcmp(value, "self") == 0)
+		opts->detect_mode = DETECT_SELF;
+	else
+		return (1);
+	return (0);
+}
+
+/**
+ * @brief Handles `--shards=K`.
+ *
+ * Cuts the ring into K contiguous slices, each run cooperatively by one
+ * thread (see shard.c), instead of one thread per philosopher.
+ *
+ * @param opts Pointer to the t_options structure to update.
+ * @param value The number of shards.
+ * @return 0 on success, 1 if the value is not a positive integer.
+ */
+static int	opt_shards(t_options *opts, const char *value)
+{
+	long long	n;
+
+	if (!value || parse_count(value, 10000000L, &n) != 0 || n == 0)
+		return (1);
+	opts->shards = n;
+	return (0);
+}
+
+/**
+ * @brief Handles `--procs=P`.
+ *
+ * Cuts the ring into P slices as `--shards` does, and runs each in a
+ * process of its own; forks between slices are passed as messages (see
+ * procs.c).
+ *
+ * @param opts Pointer to the t_options structure to update.
+ * @param value The number of processes.
+ * @return 0 on success, 1 if the value is not a positive integer.
+ */
+static int	opt_procs(t_options *opts, const char *value)
+{
+	long long	n;
+
+	if (!value || parse_count(value, 4096, &n) != 0 || n == 0)
+		return (1);
+	opts->procs = n;
+	return (0);
+}
+
+/**
+ * @brief Handles `--scheduled`.
+ *
+ * Philosophers eat in slots computed at start-up instead of racing for
+ * their forks (see schedule.c).
+ *
+ * @param opts Pointer to the t_options structure to update.
+ * @param value Must be NULL (the option takes no value).
+ * @return 0 on success, 1 if a value was given.
+ */
+static int	opt_scheduled(t_options *opts, const char *value)
+{
+	if (value)
+		return (1);
+	opts->scheduled = 1;
+	return (0);
+}
+
+/**
+ * @brief Handles `--clock=MODE`.
+ *
+ * `tsc` (default) reads a calibrated TSC when the CPU and kernel vouch
+ * for it, and the vDSO clock otherwise; `vdso` always uses the latter
+ * (see clock.c).
+ *
+ * @param opts Pointer to the t_options structure to update.
+ * @param value "tsc" or "vdso".
+ * @return 0 on success, 1 on any other value.
+ */
+static int	opt_clock(t_options *opts, const char *value)
+{
+	if (value && strcmp(value, "tsc") == 0)
+		opts->clock_mode = CLOCKSRC_TSC;
+	else if (value && strcmp(value, "vdso") == 0)
+		opts->clock_mode = CLOCKSRC_VDSO;
+	else
+		return (1);
+	return (0);
+}
+
+/**
+ * @brief Handles `--clock-bench[=SECONDS]`.
+ *
+ * Measures the cost of the clock sources and the drift of the selected
+ * one over SECONDS (default one hour), then exits (see clock_bench.c).
+ *
+ * @param opts Pointer to the t_options structure to update.
+ * @param value NULL, or the length of the drift test in seconds.
+ * @return 0 on success, 1 if the value is invalid.
+ */
+static int	opt_clock_bench(t_options *opts, const char *value)
+{
+	char	*end;
+
+	opts->clock_bench = CLOCK_BENCH_SECONDS;
+	if (!value)
+		return (0);
+	opts->clock_bench = strtod(value, &end);
+	if (!*value || *end != '\0' || !(opts->clock_bench >= 1.0)
+		|| opts->clock_bench > 1e6)
+		return (1);
+	return (0);
+}
+
+/**
+ * @brief Handles `--record=FILE`.
+ *
+ * Logs the fork order and phase timings of the run for `--replay`.
+ *
+ * @param opts Pointer to the t_options structure to update.
+ * @param value Path of the log to write.
+ * @return 0 on success, 1 if the path is missing.
+ */
+static int	opt_record(t_options *opts, const char *value)
+{
+	if (!value || !*value)
+		return (1);
+	opts->record_file = value;
+	return (0);
+}
+
+/**
+ * @brief Handles `--replay=FILE`.
+ *
+ * Re-runs a table exactly as logged by `--record` (see replay.c).
+ *
+ * @param opts Pointer to the t_options structure to update.
+ * @param value Path of a log written by `--record`.
+ * @return 0 on success, 1 if the path is missing.
+ */
+static int	opt_replay(t_options *opts, const char *value)
+{
+	if (!value || !*value)
+		return (1);
+	opts->replay_file = value;
+	return (0);
+}
+
+/*
+** Table of recognised `--name[=value]` options. Adding an option means
+** adding a handler above and one line here.
+*/
+static const t_option_def	g_option_defs[] = {
+{"time-scale", opt_time_scale},
+{"real-timestamps", opt_real_timestamps},
+{"checkpoint", opt_checkpoint},
+{"checkpoint-interval", opt_checkpoint_interval},
+{"resume", opt_resume},
+{"hugepages", opt_hugepages},
+{"max-philos", opt_max_philos},
+{"stats", opt_stats},
+{"think", opt_think},
+{"repeat", opt_repeat},
+{"sink", opt_sink},
+{"log", opt_log},
+{"compress", opt_compress},
+{"timer", opt_timer},
+{"check-scenarios", opt_check_scenarios},
+{"realtime", opt_realtime},
+{"analyze", opt_analyze},
+{"detect", opt_detect},
+{"shards", opt_shards},
+{"scheduled", opt_scheduled},
+{"procs", opt_procs},
+{"record", opt_record},
+{"replay", opt_replay},
+{"clock", opt_clock},
+{"clock-bench", opt_clock_bench},
+{NULL, NULL}
+};
+
+/**
+ * @brief Applies a single `--name[=value]` argument.
+ *
+ * @param opts Pointer to the t_options structure to update.
+ * @param arg The argument, starting after the leading `--`.
+ * @return 0 on success, 1 if the option is unknown or its value is invalid.
+ */
+static int	apply_option(t_options *opts, const char *arg)
+{
+	const char	*value;
+	size_t		name_len;
+	int			i;
+
+	value = strchr(arg, '=');
+	name_len = strlen(arg);
+	if (value)
+		name_len = value - arg;
+	i = 0;
+	while (g_option_defs[i].name)
+	{
+		if (strlen(g_option_defs[i].name) == name_len
+			&& strncmp(g_option_defs[i].name, arg, name_len) == 0)
+		{
+			if (value)
+				value++;
+			if (g_option_defs[i].handler(opts, value) == 0)
+				return (0);
+			printf("Error: Invalid value for option --%s.\n",
+				g_option_defs[i].name);
+			return (1);
+		}
+		i++;
+	}
+	printf("Error: Unknown option --%.*s.\n", (int)name_len, arg);
+	return (1);
+}
+
+/**
+ * @brief Extracts `--option` arguments from the command line.
+ *
+ * Fills `opts` with defaults, then applies every argument starting with
+ * `--` and removes it from `argv`, so the positional arguments keep their
+ * usual indexes and `*argc` is updated accordingly. Options may appear
+ * anywhere on the command line.
+ *
+ * @param opts Pointer to the t_options structure to fill.
+ * @param argc Pointer to the argument count, updated in place.
+ * @param argv The argument vector, compacted in place.
+ * @return 0 on success, 1 if any option is unknown or invalid.
+ */
+int	parse_options(t_options *opts, int *argc, char **argv)
+{
+	int	i;
+	int	kept;
+
+	memset(opts, 0, sizeof(*opts));
+	opts->time_scale = 1.0;
+	opts->max_philos = DEFAULT_MAX_PHILOS;
+	opts->think_mode = THINK_ADAPTIVE;
+	opts->repeat = 1;
+	opts->log_sample = 1;
+	opts->timer_mode = TIMER_WHEEL;
+	i = 1;
+	kept = 1;
+	while (i < *argc)
+	{
+		if (strncmp(argv[i], "--", 2) == 0)
+		{
+			if (apply_option(opts, argv[i] + 2) != 0)
+				return (1);
+		}
+		else
+			argv[kept++] = argv[i];
+		i++;
+	}
+	argv[kept] = NULL;
+	*argc = kept;
+	return (0);
+}
@@ -0,0 +1,335 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   output_sink.c                                      :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: vrads <vrads@student.42.fr>                +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/07/06 10:03:18 by vrads             #+#    #+#             */
+/*   Updated: 2025/07/08 16:12:40 by vrads            ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "philo.h"
+
+/*
+** Output backends for the simulation lines (--sink=stdio|write|uring).
+**
+** stdio  printf-style fwrite to stdout, as before (default).
+** write  lines are packed into SINK_BUFFERS buffers of SINK_BUFFER_SIZE
+**        and each full buffer is written with a blocking write().
+** uring  same buffers, registered with io_uring and written
+**        asynchronously while the next buffer fills. Regular files keep
+**        up to SINK_BUFFERS writes in flight at explicit offsets; pipes,
+**        terminals and O_APPEND files keep one, which preserves the order
+**        of the lines. Falls back to `write` if io_uring is unavailable.
+** Every call is made under `print_mutex`, so the sink needs no lock.
+*/
+
+/**
+ * @brief Maps the submission/completion rings of a new io_uring.
+ *
+ * Needs IORING_FEAT_SINGLE_MMAP (Linux 5.4+). The sink buffers are
+ * registered as fixed buffers when the kernel allows it; otherwise plain
+ * IORING_OP_WRITE is used.
+ *
+ * @param sink Pointer to the t_sink structure (buffers allocated).
+ * @return 0 on success, 1 if io_uring cannot be used.
+ */
+static int	uring_setup(t_sink *sink)
+{
+	struct io_uring_params	p;
+	struct iovec			iov[SINK_BUFFERS];
+	t_uring					*r;
+	int						i;
+
+	r = &sink->ring;
+	memset(&p, 0, sizeof(p));
+	r->fd = syscall(__NR_io_uring_setup, SINK_BUFFERS * 2, &p);
+	if (r->fd < 0 || !(p.features & IORING_FEAT_SINGLE_MMAP))
+		return (1);
+	r->map_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	if (p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe)
+		> r->map_size)
+		r->map_size = p.cq_off.cqes + p.cq_entries
+			* sizeof(struct io_uring_cqe);
+	r->map = mmap(NULL, r->map_size, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+	r->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+	r->sqes = mmap(NULL, r->sqes_size, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+	if (r->map == MAP_FAILED || r->sqes == MAP_FAILED)
+		return (1);
+	r->sq_tail = (unsigned *)(r->map + p.sq_off.tail);
+	r->sq_mask = (unsigned *)(r->map + p.sq_off.ring_mask);
+	r->sq_array = (unsigned *)(r->map + p.sq_off.array);
+	r->cq_head = (unsigned *)(r->map + p.cq_off.head);
+	r->cq_tail = (unsigned *)(r->map + p.cq_off.tail);
+	r->cq_mask = (unsigned *)(r->map + p.cq_off.ring_mask);
+	r->cqes = (struct io_uring_cqe *)(r->map + p.cq_off.cqes);
+	i = -1;
+	while (++i < SINK_BUFFERS)
+	{
+		iov[i].iov_base = sink->bufs + (size_t)i * SINK_BUFFER_SIZE;
+		iov[i].iov_len = SINK_BUFFER_SIZE;
+	}
+	r->fixed = syscall(__NR_io_uring_register, r->fd,
+			IORING_REGISTER_BUFFERS, iov, SINK_BUFFERS) == 0;
+	return (0);
+}
+
+/**
+ * @brief Queues the unwritten part of buffer `idx` and submits it.
+ *
+ * @param sink Pointer to the t_sink structure.
+ * @param idx Index of the buffer.
+ */
+static void	uring_submit(t_sink *sink, int idx)
+{
+	struct io_uring_sqe	*sqe;
+	unsigned			tail;
+	unsigned			slot;
+
+	tail = *sink->ring.sq_tail;
+	slot = tail & *sink->ring.sq_mask;
+	sqe = &sink->ring.sqes[slot];
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = IORING_OP_WRITE;
+	if (sink->ring.fixed)
+		sqe->opcode = IORING_OP_WRITE_FIXED;
+	sqe->fd = sink->fd;
+	sqe->addr = (uintptr_t)(sink->bufs + (size_t)idx * SINK_BUFFER_SIZE
+			+ sink->done[idx]);
+	sqe->len = sink->fill[idx] - sink->done[idx];
+	sqe->off = (uint64_t)-1;
+	if (sink->offset >= 0)
+		sqe->off = sink->file_off[idx] + sink->done[idx];
+	sqe->buf_index = idx;
+	sqe->user_data = idx;
+	sink->ring.sq_array[slot] = slot;
+	__atomic_store_n(sink->ring.sq_tail, tail + 1, __ATOMIC_RELEASE);
+	syscall(__NR_io_uring_enter, sink->ring.fd, 1, 0, 0, NULL, 0);
+}
+
+/**
+ * @brief Handles the completion of a write of buffer `idx`.
+ *
+ * Short writes and EAGAIN/EINTR are resubmitted for the remaining bytes;
+ * on any other error the buffer is dropped and counted in `errors`.
+ *
+ * @param sink Pointer to the t_sink structure.
+ * @param idx Index of the buffer.
+ * @param res Result of the write (bytes written or -errno).
+ */
+static void	uring_complete(t_sink *sink, int idx, int res)
+{
+	if (res == -EAGAIN || res == -EINTR)
+		res = 0;
+	else if (res <= 0)
+	{
+		sink->errors++;
+		res = sink->fill[idx] - sink->done[idx];
+	}
+	sink->done[idx] += res;
+	if (sink->done[idx] < sink->fill[idx])
+	{
+		uring_submit(sink, idx);
+		return ;
+	}
+	sink->busy[idx] = 0;
+	sink->fill[idx] = 0;
+	sink->done[idx] = 0;
+	sink->in_flight--;
+	sink->writes++;
+}
+
+/**
+ * @brief Processes available completions, first waiting for one.
+ *
+ * @param sink Pointer to the t_sink structure.
+ */
+static void	uring_reap(t_sink *sink)
+{
+	struct io_uring_cqe	*cqe;
+	unsigned			head;
+	int					idx;
+	int					res;
+
+	syscall(__NR_io_uring_enter, sink->ring.fd, 0, 1,
+		IORING_ENTER_GETEVENTS, NULL, 0);
+	head = *sink->ring.cq_head;
+	while (head != __atomic_load_n(sink->ring.cq_tail, __ATOMIC_ACQUIRE))
+	{
+		cqe = &sink->ring.cqes[head & *sink->ring.cq_mask];
+		idx = cqe->user_data;
+		res = cqe->res;
+		head++;
+		__atomic_store_n(sink->ring.cq_head, head, __ATOMIC_RELEASE);
+		uring_complete(sink, idx, res);
+	}
+}
+
+/**
+ * @brief Writes the current buffer out and moves on to the next one.
+ *
+ * With the `write` backend this blocks until the buffer is written. With
+ * `uring` it only blocks (a stall) when the in-flight limit is reached or
+ * the next buffer is still being written.
+ *
+ * @param sink Pointer to the t_sink structure.
+ */
+static void	submit_current(t_sink *sink)
+{
+	char	*buf;
+
+	buf = sink->bufs + (size_t)sink->current * SINK_BUFFER_SIZE;
+	if (sink->fill[sink->current] == 0)
+		return ;
+	if (sink->mode == SINK_WRITE)
+	{
+		if (write_all(sink->fd, buf, sink->fill[sink->current]) != 0)
+			sink->errors++;
+		sink->fill[sink->current] = 0;
+		sink->writes++;
+		return ;
+	}
+	while (sink->in_flight >= sink->max_in_flight)
+	{
+		sink->stalls++;
+		uring_reap(sink);
+	}
+	sink->file_off[sink->current] = sink->offset;
+	if (sink->offset >= 0)
+		sink->offset += sink->fill[sink->current];
+	sink->busy[sink->current] = 1;
+	sink->in_flight++;
+	uring_submit(sink, sink->current);
+	sink->current = (sink->current + 1) % SINK_BUFFERS;
+	while (sink->busy[sink->current])
+	{
+		sink->stalls++;
+		uring_reap(sink);
+	}
+}
+
+/**
+ * @brief Prepares the `--sink` backend on stdout.
+ *
+ * Buffers come from the table arena. Regular files (without O_APPEND)
+ * are written at explicit offsets so several writes may be in flight.
+ *
+ * @param table Pointer to the t_table structure (arena mapped).
+ * @return 0 on success, 1 if the arena is exhausted.
+ */
+int	sink_init(t_table *table)
+{
+	t_sink		*sink;
+	struct stat	st;
+
+	sink = &table->sink;
+	fflush(stdout);
+	sink->mode = table->opts.sink_mode;
+	if (sink->mode == SINK_STDIO)
+		return (0);
+	sink->bufs = arena_alloc(&table->arena,
+			(size_t)SINK_BUFFERS * SINK_BUFFER_SIZE, sysconf(_SC_PAGESIZE));
+	if (!sink->bufs)
+		return (printf("Error: Allocation failed for output buffers.\n"), 1);
+	sink->max_in_flight = 1;
+	sink->offset = -1;
+	if (fstat(sink->fd, &st) == 0 && S_ISREG(st.st_mode)
+		&& !(fcntl(sink->fd, F_GETFL) & O_APPEND))
+	{
+		sink->offset = lseek(sink->fd, 0, SEEK_CUR);
+		if (sink->offset >= 0)
+			sink->max_in_flight = SINK_BUFFERS;
+	}
+	if (sink->mode == SINK_URING && uring_setup(sink) != 0)
+	{
+		sink_destroy(sink);
+		sink->mode = SINK_WRITE;
+	}
+	return (0);
+}
+
+/**
+ * @brief Appends `len` bytes of output to the sink.
+ *
+ * Called under `print_mutex`, or only by the log writer thread with
+ * `--log=drop|sample` or `--compress`. A record that fits in a buffer is
+ * never split across two writes; larger data (compressed frames) spans
+ * as many buffers as needed.
+ *
+ * @param sink Pointer to the t_sink structure.
+ * @param buf Bytes to output.
+ * @param len Number of bytes.
+ */
+void	sink_write(t_sink *sink, const char *buf, size_t len)
+{
+	size_t	n;
+
+	if (sink->mode == SINK_STDIO)
+	{
+		fwrite(buf, 1, len, stdout);
+		return ;
+	}
+	if (sink->fill[sink->current] + len > SINK_BUFFER_SIZE)
+		submit_current(sink);
+	while (len > 0)
+	{
+		n = SINK_BUFFER_SIZE - sink->fill[sink->current];
+		if (n > len)
+			n = len;
+		memcpy(sink->bufs + (size_t)sink->current * SINK_BUFFER_SIZE
+			+ sink->fill[sink->current], buf, n);
+		sink->fill[sink->current] += n;
+		sink->bytes += n;
+		buf += n;
+		len -= n;
+		if (len > 0)
+			submit_current(sink);
+	}
+}
+
+/**
+ * @brief Writes out everything buffered and waits for writes in flight.
+ *
+ * Called when no philosopher is running (end of each run and cleanup).
+ * For a regular file, the file position is moved past the data written
+ * at explicit offsets.
+ *
+ * @param sink Pointer to the t_sink structure.
+ */
+void	sink_flush(t_sink *sink)
+{
+	if (sink->mode == SINK_STDIO)
+	{
+		fflush(stdout);
+		return ;
+	}
+	submit_current(sink);
+	while (sink->mode == SINK_URING && sink->in_flight > 0)
+		uring_reap(sink);
+	if (sink->mode == SINK_URING && sink->offset >= 0)
+		lseek(sink->fd, sink->offset, SEEK_SET);
+}
+
+/**
+ * @brief Tears down the io_uring, if any. The buffers belong to the arena.
+ *
+ * Safe to call on a sink whose ring was never (or only partly) set up.
+ *
+ * @param sink Pointer to the t_sink structure.
+ */
+void	sink_destroy(t_sink *sink)
+{
+	if (sink->ring.sqes && sink->ring.sqes != MAP_FAILED)
+		munmap(sink->ring.sqes, sink->ring.sqes_size);
+	if (sink->ring.map && sink->ring.map != MAP_FAILED)
+		munmap(sink->ring.map, sink->ring.map_size);
+	if (sink->ring.fd >= 0)
+		close(sink->ring.fd);
+	sink->ring.sqes = NULL;
+	sink->ring.map = NULL;
+	sink->ring.fd = -1;
+}
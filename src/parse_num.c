@@ -0,0 +1,175 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   parse_num.c                                        :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: vrads <vrads@student.42.fr>                +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/07/10 10:14:26 by vrads             #+#    #+#             */
+/*   Updated: 2025/07/10 15:37:09 by vrads            ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "philo.h"
+
+/*
+** Strict number parsing shared by the command line, the `--options` and
+** scenario files (see scenario_file.c). Unlike atoi, nothing is accepted
+** silently: no sign other than a leading '+', no whitespace, no trailing
+** garbage, and every overflow is reported. Hand-rolled loops, no locale
+** and no errno, so large scenario files parse quickly.
+*/
+
+/**
+ * @brief Parses a non-negative decimal integer no larger than `max`.
+ *
+ * @param s The text, e.g. "200" or "+5".
+ * @param max Largest accepted value.
+ * @param out Receives the value on success.
+ * @return 0 on success, 1 if the text is not a number or exceeds `max`.
+ */
+int	parse_count(const char *s, long long max, long long *out)
+{
+	long long	v;
+
+	if (*s == '+')
+		s++;
+	if (*s < '0' || *s > '9')
+		return (1);
+	v = 0;
+	while (*s >= '0' && *s <= '9')
+	{
+		if (v > (max - (*s - '0')) / 10)
+			return (1);
+		v = v * 10 + (*s - '0');
+		s++;
+	}
+	if (*s != '\0')
+		return (1);
+	*out = v;
+	return (0);
+}
+
+/**
+ * @brief Returns the length of a unit suffix and its size in microseconds.
+ *
+ * No suffix means milliseconds, the unit of the classic arguments.
+ *
+ * @param s The text after the number.
+ * @param unit Receives microseconds per unit.
+ * @return 0 on success, 1 for an unknown suffix.
+ */
+static int	parse_unit(const char *s, long long *unit)
+{
+	if (*s == '\0' || strcmp(s, "ms") == 0)
+		*unit = 1000;
+	else if (strcmp(s, "us") == 0)
+		*unit = 1;
+	else if (strcmp(s, "s") == 0)
+		*unit = 1000000;
+	else
+		return (1);
+	return (0);
+}
+
+/**
+ * @brief Parses a duration such as "800", "800ms", "1.5s" or "250us".
+ *
+ * Without a suffix the value is in milliseconds. A fractional part is
+ * allowed as long as it stays a whole number of microseconds ("1.0005ms"
+ * is rejected). The result must not exceed DURATION_MAX_US.
+ *
+ * @param s The text.
+ * @param us Receives the duration in microseconds on success.
+ * @return 0 on success, 1 if the text is not a valid duration.
+ */
+int	parse_duration(const char *s, long long *us)
+{
+	const char	*p;
+	long long	whole;
+	long long	frac;
+	long long	scale;
+	long long	unit;
+
+	p = s;
+	if (*p == '+')
+		p++;
+	if (*p < '0' || *p > '9')
+		return (1);
+	whole = 0;
+	while (*p >= '0' && *p <= '9' && whole <= DURATION_MAX_US / 10)
+		whole = whole * 10 + (*p++ - '0');
+	frac = 0;
+	scale = 1;
+	if (*p == '.' && p[1] >= '0' && p[1] <= '9')
+	{
+		while (*++p >= '0' && *p <= '9')
+		{
+			if (scale == 1000000 && *p != '0')
+				return (1);
+			if (scale == 1000000)
+				continue ;
+			frac = frac * 10 + (*p - '0');
+			scale *= 10;
+		}
+	}
+	if ((*p >= '0' && *p <= '9') || parse_unit(p, &unit) != 0
+		|| whole > DURATION_MAX_US / unit || (frac * unit) % scale != 0)
+		return (1);
+	*us = whole * unit + frac * unit / scale;
+	return (*us > DURATION_MAX_US);
+}
+
+/**
+ * @brief Parses the positional arguments into the table.
+ *
+ * `argv[1..4]` are the philosopher count and the three durations,
+ * `argv[5]` the optional number of meals. All must be positive; the
+ * philosopher limit (`--max-philos`) is checked by the caller.
+ *
+ * @param table Pointer to the t_table structure to fill.
+ * @param argc Argument count (5 or 6, `argv[0]` included).
+ * @param argv Argument vector.
+ * @return 0 on success, otherwise the index of the first invalid
+ *         argument.
+ */
+int	parse_table_args(t_table *table, int argc, char **argv)
+{
+	long long	n;
+
+	if (parse_count(argv[1], INT_MAX, &n) != 0 || n == 0)
+		return (1);
+	table->num_philos = n;
+	if (parse_duration(argv[2], &table->time_to_die) != 0
+		|| table->time_to_die == 0)
+		return (2);
+	if (parse_duration(argv[3], &table->time_to_eat) != 0
+		|| table->time_to_eat == 0)
+		return (3);
+	if (parse_duration(argv[4], &table->time_to_sleep) != 0
+		|| table->time_to_sleep == 0)
+		return (4);
+	table->num_must_eat = -1;
+	if (argc == 6)
+	{
+		if (parse_count(argv[5], INT_MAX, &n) != 0 || n == 0)
+			return (5);
+		table->num_must_eat = n;
+	}
+	return (0);
+}
+
+/**
+ * @brief Names a positional argument, for error messages.
+ *
+ * @param index Index returned by `parse_table_args` (1 to 5).
+ * @return The argument's name.
+ */
+const char	*table_arg_name(int index)
+{
+	static const char	*names[] = {"program", "number_of_philosophers",
+		"time_to_die", "time_to_eat", "time_to_sleep",
+		"number_of_times_each_philosopher_must_eat"};
+
+	return (names[index]);
+}
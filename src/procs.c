@@ -0,0 +1,708 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   procs.c                                            :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: vrads <vrads@student.42.fr>                +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/07/14 18:27:05 by vrads             #+#    #+#             */
+/*   Updated: 2025/07/15 15:42:08 by vrads            ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "philo.h"
+
+/*
+** --procs=P: the ring is cut into P slices as with --shards=P (shard.c),
+** but each slice runs in a process of its own, forked once the table is
+** set up, and the processes share no memory while the run lasts. A fork
+** between two slices is a token held by one side at a time: the other
+** side asks for it with PROC_REQ on the UNIX socket of that fork, and the
+** holder sends PROC_TOKEN as soon as the fork is free, at once or when it
+** is put down. The parent is the coordinator: it starts the children
+** together (PROC_START), writes the output records they send it in
+** timestamp order (see `merge_output`), and ends the run at the first
+** PROC_DIED, or once every slice sent PROC_FULL, by sending PROC_STOP.
+** Each child leaves its totals for `--stats` in a shared report.
+** Children are forks of the coordinator, so the status strings of the
+** records they send are valid pointers on both sides.
+*/
+
+/**
+ * @brief Sends `len` bytes of `msg`; a peer that already left is ignored.
+ */
+static void	proc_send(int fd, t_proc_msg *msg, size_t len)
+{
+	while (send(fd, msg, len, MSG_NOSIGNAL) < 0 && errno == EINTR)
+		continue ;
+}
+
+/**
+ * @brief Sends a message of `type` without lines on `fd`, stamped with
+ *        the raw clock and, in `events[0]`, the simulated one.
+ */
+static void	proc_signal(int fd, int type)
+{
+	t_proc_msg	msg;
+
+	msg.type = type;
+	msg.count = 0;
+	msg.sent_ns = real_time_ns();
+	msg.events[0].time_us = get_time_us();
+	proc_send(fd, &msg, offsetof(t_proc_msg, events) + sizeof(t_event));
+}
+
+/**
+ * @brief The side of boundary fork `f` held by this process.
+ */
+static t_token	*token_of(t_shard *s, int f)
+{
+	if (f == s->first)
+		return (&s->table->procs.left);
+	return (&s->table->procs.right);
+}
+
+/**
+ * @brief Takes boundary fork `f` if its token is here and free, or asks
+ *        the other side for it (once per wait).
+ *
+ * @param s The shard of this process.
+ * @param f Index of the fork.
+ * @return 1 if taken, 0 if not here or in use.
+ */
+int	proc_fork_take(t_shard *s, int f)
+{
+	t_token	*t;
+
+	t = token_of(s, f);
+	if (t->have && !t->held)
+	{
+		t->held = 1;
+		return (1);
+	}
+	if (!t->have && !t->asked)
+	{
+		t->asked = 1;
+		s->table->procs.messages++;
+		proc_signal(t->fd, PROC_REQ);
+	}
+	return (0);
+}
+
+/**
+ * @brief Puts boundary fork `f` down, and sends it over if the other side
+ *        asked for it meanwhile.
+ *
+ * @param s The shard of this process.
+ * @param f Index of the fork.
+ */
+void	proc_fork_put(t_shard *s, int f)
+{
+	t_token	*t;
+
+	t = token_of(s, f);
+	t->held = 0;
+	if (!t->wanted)
+		return ;
+	t->wanted = 0;
+	t->have = 0;
+	s->table->procs.messages++;
+	proc_signal(t->fd, PROC_TOKEN);
+}
+
+/**
+ * @brief Handles what the neighbour sent on the socket of one fork.
+ *
+ * A request while the token is on its way over needs no answer. A
+ * received token bumps `seq`, so `shard_routine` retries the edges.
+ *
+ * @param s The shard of this process.
+ * @param t The fork's side in this process.
+ */
+static void	on_link(t_shard *s, t_token *t)
+{
+	t_proc_msg	msg;
+	ssize_t		n;
+
+	n = recv(t->fd, &msg, sizeof(msg), MSG_DONTWAIT);
+	while (n > 0)
+	{
+		if (msg.type == PROC_TOKEN)
+		{
+			t->have = 1;
+			t->asked = 0;
+			shard_note_handoff(s, msg.sent_ns);
+			s->seq++;
+		}
+		else if (msg.type == PROC_REQ && t->have)
+		{
+			t->wanted = 1;
+			if (!t->held)
+				proc_fork_put(s, (s->first + (t == &s->table->procs.right)
+						* s->count) % s->table->num_philos);
+		}
+		n = recv(t->fd, &msg, sizeof(msg), MSG_DONTWAIT);
+	}
+	if (n == 0)
+	{
+		close(t->fd);
+		t->fd = -1;
+	}
+}
+
+/**
+ * @brief Waits up to `real_us` for a message from a neighbour or the
+ *        coordinator, and handles those that came.
+ *
+ * Stands in for the futex wait of `shard_routine`; ppoll, unlike poll,
+ * takes the timeout to the microsecond. PROC_PING is answered with the
+ * current time; PROC_STOP, or the coordinator leaving, ends the run of
+ * this process.
+ *
+ * @param s The shard of this process.
+ * @param real_us Longest wait, in wall-clock microseconds.
+ */
+void	proc_wait(t_shard *s, long long real_us)
+{
+	struct pollfd	fds[3];
+	struct timespec	ts;
+	t_proc_msg		msg;
+
+	if (real_us < 0)
+		real_us = 0;
+	ts.tv_sec = real_us / 1000000;
+	ts.tv_nsec = (real_us % 1000000) * 1000;
+	fds[0].fd = s->table->procs.left.fd;
+	fds[1].fd = s->table->procs.right.fd;
+	fds[2].fd = s->table->procs.coord_fd;
+	fds[0].events = POLLIN;
+	fds[1].events = POLLIN;
+	fds[2].events = POLLIN;
+	if (syscall(SYS_ppoll, fds, 3, &ts, NULL, 0) <= 0)
+		return ;
+	if (fds[0].revents)
+		on_link(s, &s->table->procs.left);
+	if (fds[1].revents)
+		on_link(s, &s->table->procs.right);
+	if (!fds[2].revents)
+		return ;
+	if (recv(fds[2].fd, &msg, sizeof(msg), 0) > 0 && msg.type == PROC_PING)
+		proc_signal(fds[2].fd, PROC_TICK);
+	else
+	{
+		pthread_mutex_lock(&s->table->sim_end_mutex);
+		s->table->simulation_should_end = 1;
+		pthread_mutex_unlock(&s->table->sim_end_mutex);
+	}
+}
+
+/**
+ * @brief Sends a record of output lines to the coordinator, in place of
+ *        `log_record` (see `print_events`).
+ *
+ * @param table Pointer to the t_table structure of a child.
+ * @param events The events the lines were formatted from.
+ * @param buf The formatted lines; line `i` ends at `ends[i]`.
+ * @param ends End offset of each line in `buf`.
+ * @param count Number of lines (at most EVENT_BATCH_MAX).
+ * @param died Non-zero for the record of a death.
+ */
+void	proc_print(t_table *table, const t_event *events, const char *buf,
+		const int *ends, int count, int died)
+{
+	t_proc_msg	msg;
+
+	msg.type = PROC_LINES;
+	if (died)
+		msg.type = PROC_DIED;
+	msg.count = count;
+	msg.sent_ns = real_time_ns();
+	memcpy(msg.events, events, count * sizeof(t_event));
+	memcpy(msg.ends, ends, count * sizeof(int));
+	memcpy(msg.text, buf, ends[count - 1]);
+	proc_send(table->procs.coord_fd, &msg,
+		offsetof(t_proc_msg, text) + ends[count - 1]);
+}
+
+/**
+ * @brief Counts a philosopher of this slice that ate its last required
+ *        meal; the last one tells the coordinator.
+ *
+ * @param s The shard of this process.
+ */
+void	proc_note_full(t_shard *s)
+{
+	if (++s->table->full_count == s->count)
+		proc_signal(s->table->procs.coord_fd, PROC_FULL);
+}
+
+/**
+ * @brief Leaves the totals of this child's slice for the coordinator.
+ *
+ * @param table Pointer to the t_table structure of a child.
+ * @param s Its shard.
+ */
+static void	write_report(t_table *table, t_shard *s)
+{
+	t_proc_report	*r;
+	t_philo			*p;
+	struct rusage	ru;
+	int				i;
+
+	r = &table->procs.reports[table->procs.index];
+	i = -1;
+	while (++i < s->count)
+	{
+		p = &table->philos[s->first + i];
+		r->meals += p->meals_eaten;
+		if (p->min_slack_us < r->min_slack_us)
+			r->min_slack_us = p->min_slack_us;
+		r->sleeps += p->sleeps;
+		r->sleep_late_us += p->sleep_late_us;
+		if (p->sleep_late_max_us > r->sleep_late_max_us)
+			r->sleep_late_max_us = p->sleep_late_max_us;
+	}
+	r->death_latency_us = table->stats.death_latency_us;
+	r->handoffs = s->handoffs;
+	r->handoff_ns = s->handoff_ns;
+	r->handoff_max_ns = s->handoff_max_ns;
+	r->messages = table->procs.messages;
+	memcpy(r->overshoot, table->stats.overshoot, sizeof(r->overshoot));
+	getrusage(RUSAGE_SELF, &ru);
+	r->cost.cpu_us = ru.ru_utime.tv_sec * 1000000LL + ru.ru_utime.tv_usec
+		+ ru.ru_stime.tv_sec * 1000000LL + ru.ru_stime.tv_usec;
+	r->cost.nvcsw = ru.ru_nvcsw;
+	r->cost.nivcsw = ru.ru_nivcsw;
+}
+
+/**
+ * @brief Body of child `k`: keeps its three sockets, waits for the start,
+ *        runs its slice and exits.
+ *
+ * Sockets: `fds[k]` and `fds[P + k]` connect the coordinator and child
+ * `k`; `fds[2P + 2j]` and `fds[2P + 2j + 1]` are the ends of fork
+ * `shards[j].first` in children `j - 1` and `j`. Child `k` starts with the
+ * first fork of its slice.
+ *
+ * @param table Pointer to the t_table structure.
+ * @param k Index of the child.
+ */
+static void	run_child(t_table *table, int k)
+{
+	t_procs		*p;
+	t_proc_msg	msg;
+	int			n;
+	int			i;
+
+	p = &table->procs;
+	n = table->opts.procs;
+	p->index = k;
+	p->coord_fd = p->fds[n + k];
+	p->left.fd = p->fds[2 * n + 2 * k + 1];
+	p->right.fd = p->fds[2 * n + 2 * ((k + 1) % n)];
+	p->left.have = 1;
+	i = -1;
+	while (++i < 4 * n)
+		if (p->fds[i] != p->coord_fd && p->fds[i] != p->left.fd
+			&& p->fds[i] != p->right.fd)
+			close(p->fds[i]);
+	if (recv(p->coord_fd, &msg, sizeof(msg), 0) > 0
+		&& msg.type == PROC_START)
+	{
+		table->start_time = msg.events[0].time_us;
+		start_shards(table);
+		shard_routine(&table->shards[k]);
+	}
+	write_report(table, &table->shards[k]);
+	_exit(0);
+}
+
+/**
+ * @brief Ends the run: no record is written past this point, pending
+ *        ones are dropped, and every child still connected gets PROC_STOP.
+ */
+static void	stop_children(t_table *table)
+{
+	int	k;
+
+	pthread_mutex_lock(&table->sim_end_mutex);
+	table->simulation_should_end = 1;
+	pthread_mutex_unlock(&table->sim_end_mutex);
+	k = -1;
+	while (++k < table->opts.procs)
+	{
+		table->procs.children[k].has_head = 0;
+		if (table->procs.polls[k].fd >= 0)
+			proc_signal(table->procs.polls[k].fd, PROC_STOP);
+	}
+}
+
+/**
+ * @brief Writes the pending record of child `c` as `log_record` would for
+ *        a thread of this process; a death ends the run.
+ *
+ * @param table Pointer to the t_table structure of the coordinator.
+ * @param c The child.
+ */
+static void	write_head(t_table *table, t_proc_child *c)
+{
+	c->has_head = 0;
+	log_record(table, c->head.events, c->head.text, c->head.ends,
+		c->head.count, c->head.type == PROC_DIED);
+	if (!table->stats.first_event_us)
+		table->stats.first_event_us = real_time_us()
+			- table->stats.run_begin_us;
+	if (c->head.type == PROC_DIED)
+		stop_children(table);
+}
+
+/**
+ * @brief Whether no child can still send a record older than `until`.
+ *
+ * A child with a head, a mark at `until` or later, or no socket left
+ * cannot; any other one is sent PROC_PING, once until it answers.
+ *
+ * @param table Pointer to the t_table structure of the coordinator.
+ * @param started Number of children running.
+ * @param until Time of the record to write next.
+ * @return 1 if so, 0 if a child is still waited for.
+ */
+static int	merge_ready(t_table *table, int started, long long until)
+{
+	t_proc_child	*c;
+	int				ready;
+	int				k;
+
+	ready = 1;
+	k = -1;
+	while (++k < started)
+	{
+		c = &table->procs.children[k];
+		if (c->has_head || c->mark >= until || table->procs.polls[k].fd < 0)
+			continue ;
+		ready = 0;
+		if (!c->pinged)
+			proc_signal(table->procs.polls[k].fd, PROC_PING);
+		c->pinged = 1;
+	}
+	return (ready);
+}
+
+/**
+ * @brief Writes the children's records in timestamp order, as far as the
+ *        children's marks allow.
+ *
+ * Each child's records come in order, so the oldest head can be written
+ * once no other child can still send an older one (`merge_ready`). Once
+ * every slice is full, the records up to the latest PROC_FULL are written
+ * the same way, then the run ends.
+ *
+ * @param table Pointer to the t_table structure of the coordinator.
+ * @param started Number of children running.
+ */
+static void	merge_output(t_table *table, int started)
+{
+	t_proc_child	*c;
+	long long		until;
+	int				min;
+	int				k;
+
+	c = table->procs.children;
+	while (!is_simulation_over(table))
+	{
+		min = -1;
+		k = -1;
+		while (++k < started)
+			if (c[k].has_head && (min < 0 || c[k].mark < c[min].mark))
+				min = k;
+		until = table->procs.full_at;
+		if (table->procs.full < table->opts.procs && min < 0)
+			return ;
+		if (min >= 0 && (table->procs.full < table->opts.procs
+				|| c[min].mark <= until))
+			until = c[min].mark;
+		else
+			min = -1;
+		if (!merge_ready(table, started, until))
+			return ;
+		if (min < 0)
+			stop_children(table);
+		else
+			write_head(table, &c[min]);
+	}
+}
+
+/**
+ * @brief Reads one message from child `k`, which has no head.
+ *
+ * A record becomes the child's head. Any message carries the child's
+ * time and raises its mark, the time no later record of the child can
+ * be older than; the time of PROC_FULL also counts toward `full_at`.
+ * Past the end of the run, messages are only drained.
+ *
+ * @param table Pointer to the t_table structure of the coordinator.
+ * @param k Index of the child.
+ * @return 1, or 0 once the child is gone.
+ */
+static int	on_child(t_table *table, int k)
+{
+	t_proc_child	*c;
+
+	c = &table->procs.children[k];
+	if (recv(table->procs.polls[k].fd, &c->head, sizeof(c->head), 0) <= 0)
+		return (0);
+	c->pinged = 0;
+	if (is_simulation_over(table))
+		return (1);
+	if (c->head.events[0].time_us > c->mark)
+		c->mark = c->head.events[0].time_us;
+	c->has_head = (c->head.type == PROC_LINES || c->head.type == PROC_DIED);
+	if (c->head.type == PROC_FULL)
+	{
+		table->procs.full++;
+		if (c->mark > table->procs.full_at)
+			table->procs.full_at = c->mark;
+	}
+	return (1);
+}
+
+/**
+ * @brief Coordinator loop: starts the children, relays their output and
+ *        ends the run, until every child has left.
+ *
+ * A child is read from only while it has no head, so the socket holds
+ * what it sends meanwhile.
+ *
+ * @param table Pointer to the t_table structure of the coordinator.
+ * @param started Number of children running.
+ */
+static void	coordinate(t_table *table, int started)
+{
+	t_proc_msg	msg;
+	int			open;
+	int			k;
+
+	msg.type = PROC_START;
+	msg.count = 0;
+	msg.events[0].time_us = get_time_us();
+	table->start_time = msg.events[0].time_us;
+	k = -1;
+	while (++k < started)
+		proc_send(table->procs.polls[k].fd, &msg, sizeof(msg));
+	if (started < table->opts.procs)
+		stop_children(table);
+	open = started;
+	while (open > 0)
+	{
+		merge_output(table, started);
+		k = -1;
+		while (++k < started)
+			table->procs.polls[k].events = POLLIN
+				* !table->procs.children[k].has_head;
+		if (poll(table->procs.polls, started, -1) <= 0)
+			continue ;
+		k = -1;
+		while (++k < started)
+		{
+			if (table->procs.polls[k].revents
+				&& !table->procs.children[k].has_head && !on_child(table, k))
+			{
+				close(table->procs.polls[k].fd);
+				table->procs.polls[k].fd = -1;
+				open--;
+			}
+		}
+	}
+}
+
+/**
+ * @brief Folds the children's reports into the table, so `stats_end_run`
+ *        and `print_stats` see them as a single-process run would.
+ *
+ * The totals of a slice go to its first philosopher and its shard.
+ *
+ * @param table Pointer to the t_table structure of the coordinator.
+ */
+static void	fold_reports(t_table *table)
+{
+	t_proc_report	*r;
+	t_philo			*p;
+	int				k;
+	int				b;
+
+	k = -1;
+	while (++k < table->opts.procs)
+	{
+		r = &table->procs.reports[k];
+		p = &table->philos[table->shards[k].first];
+		p->meals_eaten = r->meals;
+		p->min_slack_us = r->min_slack_us;
+		p->sleeps = r->sleeps;
+		p->sleep_late_us = r->sleep_late_us;
+		p->sleep_late_max_us = r->sleep_late_max_us;
+		if (r->death_latency_us >= 0)
+			table->stats.death_latency_us = r->death_latency_us;
+		table->shards[k].handoffs = r->handoffs;
+		table->shards[k].handoff_ns = r->handoff_ns;
+		table->shards[k].handoff_max_ns = r->handoff_max_ns;
+		table->procs.messages += r->messages;
+		b = -1;
+		while (++b < OVERSHOOT_BUCKETS)
+			table->stats.overshoot[b] += r->overshoot[b];
+		table->stats.cost[COST_PHILO].cpu_us += r->cost.cpu_us;
+		table->stats.cost[COST_PHILO].nvcsw += r->cost.nvcsw;
+		table->stats.cost[COST_PHILO].nivcsw += r->cost.nivcsw;
+	}
+}
+
+/**
+ * @brief Creates the sockets, one per child to the coordinator and one
+ *        per boundary fork (see `run_child` for the layout).
+ *
+ * @return 0 on success, 1 on error.
+ */
+static int	open_sockets(t_table *table)
+{
+	int	pair[2];
+	int	n;
+	int	k;
+
+	n = table->opts.procs;
+	k = -1;
+	while (++k < 2 * n)
+	{
+		if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, pair) != 0)
+			return (1);
+		if (k < n)
+		{
+			table->procs.fds[k] = pair[0];
+			table->procs.fds[n + k] = pair[1];
+		}
+		else
+		{
+			table->procs.fds[2 * k] = pair[0];
+			table->procs.fds[2 * k + 1] = pair[1];
+		}
+	}
+	return (0);
+}
+
+/**
+ * @brief Runs the simulation as P processes (`--procs`).
+ *
+ * Forks the children, coordinates them until they have all left, reaps
+ * them and folds their reports in, then flushes the output as
+ * `run_simulations` does. No thread pool is used.
+ *
+ * @param table Pointer to the initialized t_table structure.
+ * @return 0 if the run completed, 1 if the sockets or a child could not
+ *         be created.
+ */
+int	run_procs(t_table *table)
+{
+	int	n;
+	int	k;
+	int	i;
+
+	n = table->opts.procs;
+	stats_end_startup(table);
+	if (open_sockets(table) != 0)
+	{
+		printf("Error: Cannot create the sockets for --procs.\n");
+		return (1);
+	}
+	fflush(stdout);
+	k = -1;
+	while (++k < n)
+	{
+		table->procs.pids[k] = fork();
+		if (table->procs.pids[k] == 0)
+			run_child(table, k);
+		if (table->procs.pids[k] < 0)
+			break ;
+		table->procs.polls[k].fd = table->procs.fds[k];
+		table->procs.polls[k].events = POLLIN;
+	}
+	i = k - 1;
+	while (++i < 4 * n)
+		if (i >= n || table->procs.polls[i].fd < 0)
+			close(table->procs.fds[i]);
+	if (k < n)
+		printf("Error: Cannot fork process %d of %d.\n", k + 1, n);
+	coordinate(table, k);
+	i = -1;
+	while (++i < k)
+		waitpid(table->procs.pids[i], NULL, 0);
+	fold_reports(table);
+	log_drain(table);
+	compress_flush(table);
+	sink_flush(&table->sink);
+	stats_end_run(table);
+	return (k < n);
+}
+
+/**
+ * @brief Carves the child table out of the arena and maps the reports.
+ *
+ * @param table Pointer to the t_table structure (shards set up).
+ * @return 0 on success (or without `--procs`), 1 on error.
+ */
+int	init_procs(t_table *table)
+{
+	t_procs	*p;
+	int		n;
+	int		k;
+
+	p = &table->procs;
+	n = table->opts.procs;
+	if (!n)
+		return (0);
+	p->fds = arena_alloc(&table->arena, sizeof(int) * 4 * n, ARENA_LINE);
+	p->pids = arena_alloc(&table->arena, sizeof(pid_t) * n, ARENA_LINE);
+	p->polls = arena_alloc(&table->arena, sizeof(struct pollfd) * n,
+			ARENA_LINE);
+	p->children = arena_alloc(&table->arena, sizeof(t_proc_child) * n,
+			ARENA_LINE);
+	p->reports = mmap(NULL, sizeof(t_proc_report) * n, PROT_READ
+			| PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (!p->fds || !p->pids || !p->polls || !p->children
+		|| p->reports == MAP_FAILED)
+	{
+		printf("Error: Allocation failed for --procs.\n");
+		return (1);
+	}
+	k = -1;
+	while (++k < 4 * n)
+		p->fds[k] = -1;
+	k = -1;
+	while (++k < n)
+	{
+		p->polls[k].fd = -1;
+		p->reports[k].min_slack_us = table->time_to_die;
+		p->reports[k].death_latency_us = -1;
+	}
+	return (0);
+}
+
+/**
+ * @brief Releases the reports and any socket still open. Safe to call
+ *        when `--procs` was not given.
+ *
+ * @param table Pointer to the t_table structure.
+ */
+void	destroy_procs(t_table *table)
+{
+	int	k;
+
+	if (table->procs.reports && table->procs.reports != MAP_FAILED)
+		munmap(table->procs.reports,
+			sizeof(t_proc_report) * table->opts.procs);
+	table->procs.reports = NULL;
+	k = -1;
+	while (table->procs.polls && ++k < table->opts.procs)
+	{
+		if (table->procs.polls[k].fd >= 0)
+			close(table->procs.polls[k].fd);
+		table->procs.polls[k].fd = -1;
+	}
+}
@@ -0,0 +1,164 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   realtime.c                                         :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: vrads <vrads@student.42.fr>                +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/07/11 09:48:33 by vrads             #+#    #+#             */
+/*   Updated: 2025/07/15 16:57:21 by vrads            ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#define _GNU_SOURCE // CPU_SET, pthread_setaffinity_np
+#include "philo.h"
+
+/*
+** --realtime: removes the two main sources of timestamp jitter that are
+** not part of the model, page faults and preemption by other processes.
+** Every step is optional: without the privilege (CAP_IPC_LOCK,
+** CAP_SYS_NICE) or the CPUs for it, a warning is printed and the run
+** continues with whatever could be set up. The outcome is in --stats.
+*/
+
+/**
+ * @brief Prints why a `--realtime` step was skipped.
+ *
+ * @param what The step.
+ * @param why The reason.
+ */
+static void	realtime_warn(const char *what, const char *why)
+{
+	fprintf(stderr, "Warning: --realtime: %s: %s; continuing without it.\n",
+		what, why);
+}
+
+/**
+ * @brief Touches every page of the arena in use, then locks memory.
+ *
+ * Writing one byte per page makes the kernel back it now rather than on
+ * the first access by a philosopher (reading would only map the shared
+ * zero page). The guard pages below the pool stacks are skipped, as any
+ * access to them faults. `MCL_ONFAULT` then locks those pages without
+ * populating untouched mappings such as the unused part of the writer's
+ * stack. When the whole process does not fit in RLIMIT_MEMLOCK, the
+ * arena alone is locked.
+ *
+ * @param table Pointer to the t_table structure.
+ */
+static void	lock_memory(t_table *table)
+{
+	volatile char	*p;
+	size_t			page;
+	size_t			off;
+
+	page = sysconf(_SC_PAGESIZE);
+	p = table->arena.base;
+	off = 0;
+	while (p && off < table->arena.used)
+	{
+		if (!pool_is_guard(&table->pool, table->arena.base + off))
+		{
+			p[off] = p[off];
+			table->rt.prefault_pages++;
+		}
+		off += page;
+	}
+	if (mlockall(MCL_CURRENT | MCL_FUTURE | MCL_ONFAULT) == 0
+		|| (errno == EINVAL && mlockall(MCL_CURRENT | MCL_FUTURE) == 0))
+		table->rt.mlock = RT_LOCK_ALL;
+	else if (p && mlock(table->arena.base, table->arena.used) == 0)
+		table->rt.mlock = RT_LOCK_ARENA;
+	else
+		realtime_warn("mlockall", strerror(errno));
+}
+
+/**
+ * @brief Gives the pool threads SCHED_FIFO priorities.
+ *
+ * Philosophers get the lowest real-time priority, the timer service one
+ * above and the monitor one above that, so a death is never detected
+ * late because philosophers hold the CPU. The log writer stays
+ * SCHED_OTHER: output may lag, philosophers may not.
+ *
+ * @param table Pointer to the t_table structure (pool created).
+ */
+static void	set_priorities(t_table *table)
+{
+	struct sched_param	param;
+	int					base;
+	int					err;
+	int					i;
+
+	base = sched_get_priority_min(SCHED_FIFO) + 1;
+	err = 0;
+	i = 0;
+	while (i < table->pool.count && err == 0)
+	{
+		param.sched_priority = base;
+		if (i == table->num_philos)
+			param.sched_priority = base + 2;
+		else if (i > table->num_philos)
+			param.sched_priority = base + 1;
+		err = pthread_setschedparam(table->pool.workers[i].thread,
+				SCHED_FIFO, &param);
+		i++;
+	}
+	table->rt.fifo = (err == 0);
+	if (err != 0)
+		realtime_warn("SCHED_FIFO", strerror(err));
+}
+
+/**
+ * @brief Pins the log writer to the last CPU and the pool to the others.
+ *
+ * @param table Pointer to the t_table structure (pool and writer created).
+ */
+static void	pin_writer(t_table *table)
+{
+	cpu_set_t	all;
+	cpu_set_t	one;
+	int			cpu;
+	int			i;
+
+	if (sched_getaffinity(0, sizeof(all), &all) != 0 || CPU_COUNT(&all) < 2)
+	{
+		realtime_warn("writer CPU", "fewer than 2 CPUs available");
+		return ;
+	}
+	cpu = CPU_SETSIZE - 1;
+	while (!CPU_ISSET(cpu, &all))
+		cpu--;
+	CPU_ZERO(&one);
+	CPU_SET(cpu, &one);
+	CPU_CLR(cpu, &all);
+	if (pthread_setaffinity_np(table->log.thread, sizeof(one), &one) != 0)
+	{
+		realtime_warn("writer CPU", "cannot set affinity");
+		return ;
+	}
+	i = 0;
+	while (i < table->pool.count)
+		pthread_setaffinity_np(table->pool.workers[i++].thread,
+			sizeof(all), &all);
+	table->rt.pinned = 1;
+}
+
+/**
+ * @brief Applies the `--realtime` profile once the threads exist.
+ *
+ * Under `--realtime` output always goes through the log writer thread
+ * (see `log_init`), so philosophers only copy lines into the ring and
+ * never block in `write`.
+ *
+ * @param table Pointer to the t_table structure (pool created).
+ */
+void	realtime_setup(t_table *table)
+{
+	if (!table->opts.realtime)
+		return ;
+	lock_memory(table);
+	set_priorities(table);
+	if (table->log.thread_valid)
+		pin_writer(table);
+}
@@ -0,0 +1,431 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   replay.c                                           :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: vrads <vrads@student.42.fr>                +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/07/14 09:41:18 by vrads             #+#    #+#             */
+/*   Updated: 2025/07/15 14:07:39 by vrads            ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "philo.h"
+
+/*
+** --record=FILE / --replay=FILE: the events that decide a run, in the
+** order they happened:
+**   t_replay_header  magic "PHRP", the table arguments, record count
+**   t_replay_rec[]   time since start, thread (philosopher id, 0 for the
+**                    monitor) and what happened: a fork taken (its
+**                    index), the end of a phase wait (REPLAY_WAKE), an
+**                    output line (REPLAY_LINE, stamped with the time it
+**                    shows), a death (REPLAY_DIED) or a full table
+**                    (REPLAY_END)
+** Recording reserves a slot with one atomic add and stores 16 bytes into
+** a shared file mapping: no lock and no system call. Fork records are
+** stored while the fork is held, so their order is the lock order. Line
+** records, deaths and the full table are stored under `print_mutex`, so
+** their order is the output order.
+**
+** Replay runs the same code on a virtual clock (clock.c): a thread reads
+** the time of its last record. Threads take turns in record order: one
+** blocks at a fork or a phase wait until the next record is its own and
+** keeps the turn until it reaches its next such point, so what it prints
+** in between is ordered too. Phase waits end when their record comes up,
+** with the recorded lateness, and the monitor acts only on its own
+** records. Each line is printed in its record's turn, with its recorded
+** time, so the output is the recorded one, line for line. Nothing
+** depends on the scheduler or the wall clock, and a thread can be
+** stopped in a debugger without changing the outcome.
+*/
+
+static __thread int	g_turn_held; // This thread consumed the current record
+
+/**
+ * @brief Appends a record stamped `time_us`, when recording.
+ *
+ * Past the capacity of the file, records are only counted as dropped;
+ * a replay of the log then stops where it ends.
+ *
+ * @param table Pointer to the t_table structure.
+ * @param thread Philosopher id, or 0 for the monitor.
+ * @param arg Fork index, REPLAY_WAKE, REPLAY_END, REPLAY_LINE or
+ *            REPLAY_DIED(id).
+ * @param time_us Simulated time of the event (as `get_time_us`).
+ */
+void	replay_record_at(t_table *table, int thread, int arg, long long time_us)
+{
+	uint64_t	i;
+
+	if (!table->replay.recording)
+		return ;
+	i = __atomic_fetch_add(&table->replay.count, 1, __ATOMIC_RELAXED);
+	if (i >= table->replay.cap)
+		return ;
+	table->replay.recs[i].time_us = time_us - table->start_time;
+	table->replay.recs[i].thread = thread;
+	table->replay.recs[i].arg = arg;
+}
+
+/**
+ * @brief Appends a record stamped now, when recording.
+ */
+void	replay_record(t_table *table, int thread, int arg)
+{
+	if (table->replay.recording)
+		replay_record_at(table, thread, arg, get_time_us());
+}
+
+/**
+ * @brief Logs the lines of a record just written, when recording.
+ *
+ * Called by `print_events` under `print_mutex`, except for deaths, which
+ * `declare_death` logs as REPLAY_DIED.
+ *
+ * @param table Pointer to the t_table structure.
+ * @param thread Philosopher id.
+ * @param events The printed events.
+ * @param count Number of lines.
+ */
+void	replay_record_lines(t_table *table, int thread, const t_event *events,
+		int count)
+{
+	int	i;
+
+	i = 0;
+	while (table->replay.recording && i < count)
+		replay_record_at(table, thread, REPLAY_LINE, events[i++].time_us);
+}
+
+/**
+ * @brief Passes the turn on: moves past the current record and wakes the
+ *        thread owning the next one.
+ */
+static void	pass_turn(t_replay *r)
+{
+	uint32_t	next;
+
+	g_turn_held = 0;
+	next = __atomic_add_fetch(&r->cursor, 1, __ATOMIC_ACQ_REL);
+	if (next >= r->count)
+		return ;
+	__atomic_add_fetch(&r->turn[r->recs[next].thread], 1, __ATOMIC_RELEASE);
+	futex_wake(&r->turn[r->recs[next].thread], 1);
+}
+
+/**
+ * @brief Waits until the next record belongs to `thread`, and takes it.
+ *
+ * The turn held since the caller's previous record is passed on first.
+ * Waits are bounded by REPLAY_POLL_US of real time so the end of the run
+ * is noticed. The clock of the calling thread is set to the record.
+ *
+ * @param table Pointer to the t_table structure.
+ * @param thread Philosopher id, or 0 for the monitor.
+ * @return The record, or NULL once the run ended or the log ran out.
+ */
+const t_replay_rec	*replay_turn(t_table *table, int thread)
+{
+	t_replay	*r;
+	uint32_t	seen;
+	uint32_t	c;
+
+	r = &table->replay;
+	if (g_turn_held)
+		pass_turn(r);
+	while (1)
+	{
+		seen = __atomic_load_n(&r->turn[thread], __ATOMIC_ACQUIRE);
+		c = __atomic_load_n(&r->cursor, __ATOMIC_ACQUIRE);
+		if (c >= r->count || is_simulation_over(table))
+			return (NULL);
+		if (r->recs[c].thread == thread)
+			break ;
+		futex_wait_us(&r->turn[thread], seen, REPLAY_POLL_US);
+	}
+	g_turn_held = 1;
+	clock_set_virtual(table->start_time + r->recs[c].time_us);
+	return (&r->recs[c]);
+}
+
+/**
+ * @brief Ends a replay that no longer follows its log.
+ *
+ * @param table Pointer to the t_table structure.
+ * @param why What the run did instead.
+ */
+void	replay_diverged(t_table *table, const char *why)
+{
+	fprintf(stderr, "replay: diverged at record %u: %s\n",
+		__atomic_load_n(&table->replay.cursor, __ATOMIC_ACQUIRE), why);
+	pthread_mutex_lock(&table->sim_end_mutex);
+	table->simulation_should_end = 1;
+	pthread_mutex_unlock(&table->sim_end_mutex);
+	timer_stop(table);
+}
+
+/**
+ * @brief Takes the turn of philosopher `philo` for its next fork.
+ *
+ * @param philo Pointer to the t_philo structure.
+ * @param fork Index of the fork about to be locked.
+ * @return 0 to go on (always when not replaying), 1 if the replay ended.
+ */
+int	replay_fork(t_philo *philo, int fork)
+{
+	const t_replay_rec	*rec;
+
+	if (!philo->table->replay.replaying)
+		return (0);
+	rec = replay_turn(philo->table, philo->id);
+	if (!rec)
+		return (1);
+	if (rec->arg != fork)
+	{
+		replay_diverged(philo->table, "fork taken out of order");
+		return (1);
+	}
+	return (0);
+}
+
+/**
+ * @brief Takes the turns of the lines of a record about to be printed,
+ *        when replaying, and gives them their recorded times.
+ *
+ * @param philo Pointer to the t_philo structure.
+ * @param events The events to print.
+ * @param timed Filled with `events`, stamped with the recorded times.
+ * @param count Number of lines.
+ * @return 0 to print `timed`, 1 if the recorded run printed nothing here
+ *         (it had ended) or the replay ended.
+ */
+int	replay_take_lines(t_philo *philo, const t_event *events, t_event *timed,
+		int count)
+{
+	const t_replay_rec	*rec;
+	int					i;
+
+	i = -1;
+	while (++i < count)
+	{
+		rec = replay_turn(philo->table, philo->id);
+		if (!rec)
+			return (1);
+		if (rec->arg != REPLAY_LINE)
+		{
+			replay_diverged(philo->table, "line printed out of order");
+			return (1);
+		}
+		timed[i].time_us = philo->table->start_time + rec->time_us;
+		timed[i].status = events[i].status;
+	}
+	return (0);
+}
+
+/**
+ * @brief Tells whether philosopher `philo`, holding its first fork, waited
+ *        for the second one in the recorded run.
+ *
+ * It did if its next record is the line of its first fork, printed
+ * before waiting. Otherwise the second fork is taken now, as by
+ * `replay_fork`, so the caller's trylock succeeds exactly as it did.
+ *
+ * @param philo Pointer to the t_philo structure.
+ * @param fork Index of the second fork.
+ * @return 0 to take the fork at once (always when not replaying), 1 to
+ *         wait for it.
+ */
+int	replay_fork_busy(t_philo *philo, int fork)
+{
+	t_replay	*r;
+	uint32_t	next;
+
+	r = &philo->table->replay;
+	if (!r->replaying)
+		return (0);
+	next = __atomic_load_n(&r->cursor, __ATOMIC_ACQUIRE) + 1;
+	while (next < r->count && r->recs[next].thread != philo->id)
+		next++;
+	if (next < r->count && r->recs[next].arg == fork)
+		return (replay_fork(philo, fork));
+	return (1);
+}
+
+/**
+ * @brief Replays a phase wait of `time_us`: it ends at its recorded time.
+ *
+ * @param philo Pointer to the t_philo structure.
+ * @param time_us Duration the philosopher asked for.
+ * @return How late the phase ended, as `philo_sleep`, or -1 if the run
+ *         ended.
+ */
+long long	replay_sleep(t_philo *philo, long long time_us)
+{
+	const t_replay_rec	*rec;
+	long long			deadline;
+	long long			late;
+
+	deadline = get_time_us() + time_us;
+	rec = replay_turn(philo->table, philo->id);
+	if (!rec)
+		return (-1);
+	if (rec->arg != REPLAY_WAKE)
+	{
+		replay_diverged(philo->table, "phase ended out of order");
+		return (-1);
+	}
+	late = get_time_us() - deadline;
+	if (time_us <= 0)
+		return (0);
+	if (late < 0)
+		return (-1);
+	philo->sleeps++;
+	philo->sleep_late_us += late;
+	if (late > philo->sleep_late_max_us)
+		philo->sleep_late_max_us = late;
+	return (late);
+}
+
+/**
+ * @brief The monitor of a replay: ends the run at the recorded death or
+ *        full table.
+ *
+ * The death must also hold on the replayed state (`check_death`), and a
+ * full table must be full; otherwise the replay reports a divergence.
+ * A log that stops earlier, e.g. past its capacity, ends the run there.
+ *
+ * @param arg Pointer to the t_table structure, passed as `void*`.
+ * @return NULL when the simulation ends.
+ */
+void	*replay_monitor_routine(void *arg)
+{
+	t_table				*table;
+	const t_replay_rec	*rec;
+
+	table = (t_table *)arg;
+	rec = replay_turn(table, 0);
+	if (!rec)
+	{
+		if (!is_simulation_over(table))
+			replay_diverged(table, "the log ends here");
+		return (NULL);
+	}
+	if (rec->arg == REPLAY_END)
+	{
+		if (!check_all_full(table))
+			replay_diverged(table, "table not full at its recorded end");
+		return (NULL);
+	}
+	if (rec->arg > REPLAY_DIED(1) || rec->arg < REPLAY_DIED(table->num_philos)
+		|| !check_death(&table->philos[REPLAY_DIED(0) - rec->arg - 1]))
+		replay_diverged(table, "no death at the recorded death");
+	return (NULL);
+}
+
+/**
+ * @brief Opens the log of `--record` or `--replay`.
+ *
+ * Recording maps a file of REPLAY_MAX_RECORDS records (sparse until
+ * written); replaying maps an existing log of the same table, switches
+ * the clock to virtual time and carves the turn counters (one per thread)
+ * from the arena.
+ *
+ * @param table Pointer to the t_table structure (arena mapped).
+ * @return 0 on success (or without either option), 1 on error.
+ */
+int	init_replay(t_table *table)
+{
+	t_replay		*r;
+	t_replay_header	hdr;
+
+	r = &table->replay;
+	if (table->opts.record_file)
+	{
+		r->fd = open(table->opts.record_file, O_RDWR | O_CREAT | O_TRUNC,
+				0644);
+		r->cap = REPLAY_MAX_RECORDS;
+		r->map_size = sizeof(hdr) + r->cap * sizeof(t_replay_rec);
+		if (r->fd < 0 || ftruncate(r->fd, r->map_size) != 0)
+		{
+			printf("Error: Cannot create %s.\n", table->opts.record_file);
+			return (1);
+		}
+		r->map = mmap(NULL, r->map_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+				r->fd, 0);
+		r->recording = (r->map != MAP_FAILED);
+		r->recs = (t_replay_rec *)((char *)r->map + sizeof(hdr));
+	}
+	if (!table->opts.replay_file)
+		return (table->opts.record_file && r->map == MAP_FAILED);
+	r->fd = open(table->opts.replay_file, O_RDONLY);
+	if (r->fd < 0 || read(r->fd, &hdr, sizeof(hdr)) != sizeof(hdr)
+		|| memcmp(hdr.magic, REPLAY_MAGIC, 4) != 0
+		|| hdr.version != REPLAY_VERSION || hdr.num_philos != table->num_philos
+		|| hdr.time_to_die != table->time_to_die
+		|| hdr.time_to_eat != table->time_to_eat
+		|| hdr.time_to_sleep != table->time_to_sleep
+		|| hdr.num_must_eat != table->num_must_eat || hdr.count > UINT32_MAX)
+	{
+		printf("Error: %s is not a log of this table.\n",
+			table->opts.replay_file);
+		return (1);
+	}
+	r->map_size = sizeof(hdr) + hdr.count * sizeof(t_replay_rec);
+	r->map = mmap(NULL, r->map_size, PROT_READ, MAP_PRIVATE, r->fd, 0);
+	r->turn = arena_alloc(&table->arena, sizeof(uint32_t)
+			* (table->num_philos + 1), ARENA_LINE);
+	if (r->map == MAP_FAILED || !r->turn)
+	{
+		printf("Error: Cannot map %s.\n", table->opts.replay_file);
+		return (1);
+	}
+	r->recs = (t_replay_rec *)((char *)r->map + sizeof(hdr));
+	r->count = hdr.count;
+	r->replaying = 1;
+	clock_use_virtual();
+	return (0);
+}
+
+/**
+ * @brief Completes a recording and releases the log.
+ *
+ * Writes the header with the number of records kept and cuts the file
+ * down to them. Safe to call when neither option was given.
+ *
+ * @param table Pointer to the t_table structure.
+ */
+void	destroy_replay(t_table *table)
+{
+	t_replay		*r;
+	t_replay_header	*hdr;
+
+	r = &table->replay;
+	if (r->recording)
+	{
+		hdr = (t_replay_header *)r->map;
+		memcpy(hdr->magic, REPLAY_MAGIC, 4);
+		hdr->version = REPLAY_VERSION;
+		hdr->num_philos = table->num_philos;
+		hdr->num_must_eat = table->num_must_eat;
+		hdr->time_to_die = table->time_to_die;
+		hdr->time_to_eat = table->time_to_eat;
+		hdr->time_to_sleep = table->time_to_sleep;
+		hdr->count = r->count;
+		hdr->dropped = 0;
+		if (r->count > r->cap)
+			hdr->count = r->cap;
+		hdr->dropped = r->count - hdr->count;
+		if (ftruncate(r->fd, sizeof(*hdr) + hdr->count
+				* sizeof(t_replay_rec)) != 0)
+			fprintf(stderr, "record: cannot trim %s\n",
+				table->opts.record_file);
+	}
+	if (r->map != MAP_FAILED)
+		munmap(r->map, r->map_size);
+	if (r->fd >= 0)
+		close(r->fd);
+	r->map = MAP_FAILED;
+	r->fd = -1;
+	r->recording = 0;
+}
@@ -6,7 +6,7 @@
 /*   By: vrads <vrads@student.42.fr>                +#+  +:+       +#+        */
 /*                                                +#+#+#+#+#+   +#+           */
 /*   Created: 2025/06/17 16:07:03 by vrads             #+#    #+#             */
-/*   Updated: 2025/06/17 16:07:04 by vrads            ###   ########.fr       */
+/*   Updated: 2025/07/13 12:48:30 by vrads            ###   ########.fr       */
 /*                                                                            */
 /* ************************************************************************** */
 
@@ -24,7 +24,7 @@
 static void	handle_single_philosopher(t_philo *philo)
 {
 	print_status(philo, "has taken a fork", 0);
-	precise_usleep(philo->table->time_to_die * 2, philo->table);
+	philo_sleep(philo, philo->table->time_to_die * 2);
 }
 
 /**
@@ -37,6 +37,8 @@ static void	handle_single_philosopher(t_philo *philo)
  * 4. `think()`: Simulates thinking.
  * After `take_forks` and each action, it checks if the simulation has ended.
  * If the simulation ends during `take_forks` (before eating), forks are dropped.
+ * With `--detect=self`, `take_forks` may also return without forks: the
+ * philosopher died waiting.
  *
  * @param philo Pointer to the t_philo structure for the philosopher.
  * @return 0 if the cycle completed and simulation can continue,
@@ -44,7 +46,8 @@ static void	handle_single_philosopher(t_philo *philo)
  */
 static int	perform_cycle_actions(t_philo *philo)
 {
-	take_forks(philo);
+	if (take_forks(philo) != 0)
+		return (1);
 	if (is_simulation_over(philo->table))
 	{
 		drop_forks(philo);
@@ -64,10 +67,17 @@ static int	perform_cycle_actions(t_philo *philo)
  * @brief The main routine executed by each philosopher thread.
  *
  * Initializes the philosopher structure from the argument.
+ * With `--detect=self`, first lowers the thread's timer slack to 1 ns, as
+ * the timer service does: the fork waits time out at the death deadline,
+ * and the default 50 us slack would delay every detection.
  * Delays the start of even ID philosophers to prevent immediate deadlock.
+ * A philosopher resumed from a checkpoint skips that delay (its phase is
+ * restored instead) and, if it was parked right after eating, first
+ * finishes that cycle by sleeping and thinking.
  * Handles the special case of a single philosopher by calling `handle_single_philosopher`.
  * For multiple philosophers, it enters a loop, calling `perform_cycle_actions`
- * until the simulation ends.
+ * until the simulation ends. The top of the loop, where no fork is held, is
+ * the checkpoint safe point.
  *
  * @param arg Pointer to the t_philo structure for this philosopher, passed as `void*`.
  * @return NULL when the philosopher's routine is complete or simulation ends.
@@ -77,8 +87,18 @@ void	*philosopher_routine(void *arg)
 	t_philo	*philo;
 
 	philo = (t_philo *)arg;
-	if (philo->id % 2 == 0)
-		precise_usleep(philo->table->time_to_eat / 10, philo->table);
+	if (philo->table->opts.detect_mode == DETECT_SELF)
+		prctl(PR_SET_TIMERSLACK, 1);
+	if (philo->table->opts.resume_file)
+	{
+		if (philo->state == SLEEPING)
+		{
+			sleep_philo(philo);
+			think(philo);
+		}
+	}
+	else if (philo->id % 2 == 0)
+		philo_sleep(philo, philo->table->time_to_eat / 10);
 
 	if (philo->table->num_philos == 1)
 	{
@@ -88,6 +108,7 @@ void	*philosopher_routine(void *arg)
 
 	while (!is_simulation_over(philo->table))
 	{
+		checkpoint_safe_point(philo);
 		if (perform_cycle_actions(philo))
 			break;
 	}
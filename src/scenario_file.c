@@ -0,0 +1,184 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   scenario_file.c                                    :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: vrads <vrads@student.42.fr>                +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/07/10 11:02:48 by vrads             #+#    #+#             */
+/*   Updated: 2025/07/10 15:37:09 by vrads            ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "philo.h"
+
+/*
+** Scenario and sweep files list one table per line, in the format of
+** bench/scenarios.txt:
+**
+**     # comment
+**     name  outcome  [--options]  philos die eat sleep [meals]
+**
+** Leading words that start with a letter (name, expected outcome) are
+** labels and are skipped; the rest is parsed exactly like a command line,
+** with `parse_options` and `parse_table_args`. The file is read once and
+** split in place, so million-line sweeps are checked in a fraction of a
+** second.
+*/
+
+/**
+ * @brief Reads a whole file into a NUL-terminated buffer.
+ *
+ * @param path The file to read.
+ * @param len Receives the number of bytes read.
+ * @return The malloc'd contents, or NULL on error.
+ */
+static char	*read_file(const char *path, size_t *len)
+{
+	struct stat	st;
+	char		*buf;
+	ssize_t		n;
+	int			fd;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0 || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+	{
+		if (fd >= 0)
+			close(fd);
+		return (NULL);
+	}
+	buf = malloc(st.st_size + 1);
+	*len = 0;
+	while (buf && *len < (size_t)st.st_size)
+	{
+		n = read(fd, buf + *len, st.st_size - *len);
+		if (n <= 0)
+			break ;
+		*len += n;
+	}
+	close(fd);
+	if (buf)
+		buf[*len] = '\0';
+	return (buf);
+}
+
+/**
+ * @brief Splits one line into words, in place.
+ *
+ * Stops at the end of the line or at a `#`. Label words are dropped.
+ *
+ * @param line Start of the line; the newline is overwritten with NUL.
+ * @param argv Receives the words after `argv[0]`.
+ * @param next Receives the start of the next line.
+ * @return Number of entries in `argv` (`argv[0]` included), or -1 if the
+ *         line has more than SCENARIO_MAX_TOKENS words.
+ */
+static int	split_line(char *line, char **argv, char **next)
+{
+	int	argc;
+	int	labels;
+
+	argc = 1;
+	labels = 1;
+	while (*line && *line != '\n' && *line != '#')
+	{
+		while (*line == ' ' || *line == '\t' || *line == '\r')
+			*line++ = '\0';
+		if (!*line || *line == '\n' || *line == '#')
+			break ;
+		labels = labels && ((*line | 32) >= 'a' && (*line | 32) <= 'z');
+		if (!labels && argc > SCENARIO_MAX_TOKENS)
+			return (-1);
+		if (!labels)
+			argv[argc++] = line;
+		while (*line && *line != '\n' && *line != '#' && *line != ' '
+			&& *line != '\t' && *line != '\r')
+			line++;
+	}
+	while (*line && *line != '\n')
+		*line++ = '\0';
+	if (*line)
+		*line++ = '\0';
+	*next = line;
+	return (argc);
+}
+
+/**
+ * @brief Validates the words of one scenario line.
+ *
+ * @param argc Entry count, `argv[0]` (the file path) included.
+ * @param argv The words (compacted by `parse_options`).
+ * @param line_no Line number, for messages.
+ * @return 0 if the line is a valid table (or empty), 1 otherwise.
+ */
+static int	check_line(int argc, char **argv, int line_no)
+{
+	t_table	table;
+	int		bad;
+	int		words;
+
+	words = argc;
+	if (words > 1 && parse_options(&table.opts, &argc, argv) != 0)
+	{
+		printf("%s:%d: invalid option\n", argv[0], line_no);
+		return (1);
+	}
+	if (words == 1)
+		return (0);
+	if (argc < 5 || argc > 6)
+	{
+		printf("%s:%d: expected 4 or 5 arguments, got %d\n", argv[0],
+			line_no, argc - 1);
+		return (1);
+	}
+	bad = parse_table_args(&table, argc, argv);
+	if (bad != 0)
+		printf("%s:%d: invalid %s '%s'\n", argv[0], line_no,
+			table_arg_name(bad), argv[bad]);
+	else if (table.num_philos > table.opts.max_philos)
+		printf("%s:%d: more than %d philosophers\n", argv[0], line_no,
+			table.opts.max_philos);
+	return (bad != 0 || table.num_philos > table.opts.max_philos);
+}
+
+/**
+ * @brief Checks every line of a scenario or sweep file (`--check-scenarios`).
+ *
+ * Reports each invalid line as `path:line: reason`, then a summary.
+ *
+ * @param path The file to check.
+ * @return 0 if every table is valid, 1 otherwise.
+ */
+int	check_scenario_file(const char *path)
+{
+	char	*argv[SCENARIO_MAX_TOKENS + 2];
+	char	*buf;
+	char	*line;
+	size_t	len;
+	int		line_no;
+	int		invalid;
+	int		argc;
+
+	buf = read_file(path, &len);
+	if (!buf)
+	{
+		printf("Error: Cannot read %s.\n", path);
+		return (1);
+	}
+	line = buf;
+	line_no = 0;
+	invalid = 0;
+	while (line < buf + len)
+	{
+		line_no++;
+		argv[0] = (char *)path;
+		argc = split_line(line, argv, &line);
+		if (argc < 0)
+			printf("%s:%d: more than %d words\n", path, line_no,
+				SCENARIO_MAX_TOKENS);
+		invalid += (argc < 0 || check_line(argc, argv, line_no));
+	}
+	free(buf);
+	printf("%s: %d lines, %d invalid\n", path, line_no, invalid);
+	return (invalid != 0);
+}
@@ -0,0 +1,209 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   schedule.c                                         :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: vrads <vrads@student.42.fr>                +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/07/13 17:02:36 by vrads             #+#    #+#             */
+/*   Updated: 2025/07/15 12:20:47 by vrads            ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "philo.h"
+
+/*
+** --scheduled: philosopher i (index) eats meal m at
+** start_time + m * P + offset(i), where the period P is the same for
+** everybody and offset(i) = ((i * k) mod N) * P / N, with k = floor(N/2).
+** Neighbours are then k * P / N apart (mod P), which is at least one
+** meal and at most P minus one meal, so their meals never overlap. For
+** even N this alternates two colour classes half a period apart; for
+** odd N the offsets rotate by k seats, as floor(N/2) diners at a time
+** is the most the ring can seat.
+**
+** P is max(eat + sleep, N * eat / k): nobody can eat more often than
+** once per eat + sleep, and the ring cannot serve more than k meals per
+** `time_to_eat`. No schedule has a shorter longest gap between meals;
+** if P exceeds `time_to_die`, no schedule keeps the table alive.
+**
+** Nobody races for a fork: each philosopher waits for its meal time,
+** then only for its two neighbours to have finished their earlier meals
+** (they publish their next meal in `sched_next`, with SCHED_WAITER set
+** when someone waits on it). A meal always lasts `time_to_eat`: a
+** philosopher that starts late finishes late, and catches up in the
+** thinking time before its next meal, if the period leaves any.
+*/
+
+/**
+ * @brief When philosopher index `i` starts its meal `meal`.
+ */
+static long long	meal_start(t_table *table, int i, uint32_t meal)
+{
+	int	k;
+
+	k = table->num_philos / 2;
+	return (table->start_time + (long long)meal * table->sched_gap_us
+		+ (long long)i * k % table->num_philos * table->sched_gap_us
+		/ table->num_philos);
+}
+
+/**
+ * @brief Computes the period of the schedule, which is also the longest
+ *        gap between two meals of a philosopher.
+ *
+ * Warns when the period exceeds `time_to_die`: the table then dies
+ * however the meals are arranged.
+ *
+ * @param table Pointer to the t_table structure (arguments parsed).
+ * @return 0 (the schedule always exists).
+ */
+int	init_schedule(t_table *table)
+{
+	long long	k;
+
+	if (!table->opts.scheduled || table->num_philos < 2)
+		return (0);
+	k = table->num_philos / 2;
+	table->sched_gap_us = (table->num_philos * table->time_to_eat + k - 1)
+		/ k;
+	if (table->time_to_eat + table->time_to_sleep > table->sched_gap_us)
+		table->sched_gap_us = table->time_to_eat + table->time_to_sleep;
+	if (table->sched_gap_us > table->time_to_die)
+		fprintf(stderr, "Warning: --scheduled: meals are %lld us apart, "
+			"more than time_to_die; no schedule can keep this table "
+			"alive.\n", table->sched_gap_us);
+	return (0);
+}
+
+/**
+ * @brief Gives every philosopher its first meal for a new run.
+ *
+ * @param table Pointer to the t_table structure.
+ */
+void	start_schedule(t_table *table)
+{
+	int	i;
+
+	i = 0;
+	while (i < table->num_philos)
+		table->philos[i++].sched_next = 0;
+}
+
+/**
+ * @brief Tells whether the meal `other_meal` of `other` comes before the
+ *        meal `meal` of `philo`. Equal start times, which only rounding
+ *        can produce, are ordered by index so that one of two
+ *        neighbours always goes first.
+ */
+static int	meal_before(t_philo *other, uint32_t other_meal, t_philo *philo,
+		uint32_t meal)
+{
+	long long	a;
+	long long	b;
+
+	a = meal_start(philo->table, other->id - 1, other_meal);
+	b = meal_start(philo->table, philo->id - 1, meal);
+	return (a < b || (a == b && other->id < philo->id));
+}
+
+/**
+ * @brief Waits until `other` has finished every meal before `meal`.
+ *
+ * Only a neighbour running late makes this block. The wait is bounded by
+ * `time_to_eat` so the end of the run is noticed; with `--detect=self`
+ * the philosopher declares its own death here once past its deadline.
+ *
+ * @param philo The philosopher about to eat.
+ * @param other One of its neighbours.
+ * @param meal The meal `philo` is about to eat.
+ * @return 0 when the forks shared with `other` are free, 1 if the run
+ *         ended meanwhile.
+ */
+static int	wait_neighbour(t_philo *philo, t_philo *other, uint32_t meal)
+{
+	uint32_t	next;
+
+	next = __atomic_load_n(&other->sched_next, __ATOMIC_ACQUIRE);
+	while (meal_before(other, next & ~SCHED_WAITER, philo, meal))
+	{
+		if (is_simulation_over(philo->table))
+			return (1);
+		if (philo->table->opts.detect_mode == DETECT_SELF
+			&& get_time_us() > death_deadline(philo))
+		{
+			declare_death(philo, get_time_us() - death_deadline(philo));
+			return (1);
+		}
+		if ((next & SCHED_WAITER) || __atomic_compare_exchange_n(
+				&other->sched_next, &next, next | SCHED_WAITER, 0,
+				__ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE))
+			futex_wait_us(&other->sched_next, next | SCHED_WAITER,
+				sim_to_real_us(philo->table->time_to_eat));
+		next = __atomic_load_n(&other->sched_next, __ATOMIC_ACQUIRE);
+	}
+	return (0);
+}
+
+/**
+ * @brief Ends a scheduled meal: publishes the next meal of `philo`, which
+ *        frees its forks, and wakes a neighbour waiting for them.
+ *
+ * Called by `eat()` in place of `drop_forks`.
+ *
+ * @param philo Pointer to the t_philo structure.
+ */
+void	schedule_release(t_philo *philo)
+{
+	uint32_t	next;
+
+	next = (philo->sched_next & ~SCHED_WAITER) + 1;
+	if (__atomic_exchange_n(&philo->sched_next, next, __ATOMIC_RELEASE)
+		& SCHED_WAITER)
+		futex_wake(&philo->sched_next, 2);
+}
+
+/**
+ * @brief Pool job of a philosopher with `--scheduled`.
+ *
+ * Thinks until its meal time, waits for its neighbours to have finished
+ * their earlier meals, then eats and sleeps through `eat()` and
+ * `sleep_philo()`, with the usual output. A lone philosopher runs
+ * `philosopher_routine`.
+ *
+ * @param arg Pointer to the t_philo structure, passed as `void*`.
+ * @return NULL when the simulation ends.
+ */
+void	*scheduled_routine(void *arg)
+{
+	t_philo		*philo;
+	t_table		*table;
+	uint32_t	meal;
+
+	philo = (t_philo *)arg;
+	table = philo->table;
+	if (table->num_philos == 1)
+		return (philosopher_routine(arg));
+	while (!is_simulation_over(table))
+	{
+		meal = philo->sched_next & ~SCHED_WAITER;
+		philo_sleep(philo, meal_start(table, philo->id - 1, meal)
+			- get_time_us());
+		if (wait_neighbour(philo, &table->philos[(philo->id - 2
+						+ table->num_philos) % table->num_philos], meal)
+			|| wait_neighbour(philo,
+				&table->philos[philo->id % table->num_philos], meal))
+			break ;
+		philo->pending[0].time_us = get_time_us();
+		philo->pending[0].status = "has taken a fork";
+		philo->pending[1] = philo->pending[0];
+		philo->pending_count = 2;
+		eat(philo);
+		sleep_philo(philo);
+		if (is_simulation_over(table))
+			break ;
+		philo->state = THINKING;
+		print_status(philo, "is thinking", 0);
+	}
+	return (NULL);
+}
@@ -0,0 +1,89 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   self_detect.c                                      :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: vrads <vrads@student.42.fr>                +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/07/13 10:22:16 by vrads             #+#    #+#             */
+/*   Updated: 2025/07/13 12:48:30 by vrads            ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#define _GNU_SOURCE // pthread_mutex_clocklock
+#include "philo.h"
+
+/*
+** --detect=self: no monitor thread. A philosopher can only starve while
+** it waits, for a fork or for the end of a phase, so every such wait is
+** bounded by its own death deadline: fork locks time out on it
+** (lock_fork) and phase waits are cut short at it (philo_sleep). The
+** philosopher that reaches its deadline declares its own death, which
+** sets the end flag for the others. The last philosopher to finish its
+** meals ends a run with a meal count (note_full).
+*/
+
+/**
+ * @brief When `philo` starves unless it starts a meal first.
+ *
+ * @param philo Pointer to the t_philo structure.
+ * @return Simulated time in microseconds.
+ */
+long long	death_deadline(t_philo *philo)
+{
+	return (__atomic_load_n(&philo->last_meal_time, __ATOMIC_ACQUIRE)
+		+ philo->table->time_to_die);
+}
+
+/**
+ * @brief Locks a fork, with `--detect=self` no later than the deadline.
+ *
+ * The timeout is absolute on CLOCK_MONOTONIC, the clock behind
+ * `get_time_us`, so the philosopher gives up exactly at its deadline and
+ * declares its death. It may still be recorded as waiting in the
+ * wait-for graph: the detector only runs in the monitor.
+ *
+ * @param philo Pointer to the t_philo structure of the hungry philosopher.
+ * @param fork The fork to lock.
+ * @return 0 once the fork is held, 1 if the philosopher died waiting
+ *         (the fork is not held).
+ */
+int	lock_fork(t_philo *philo, pthread_mutex_t *fork)
+{
+	struct timespec	abs;
+	long long		real_us;
+	long long		deadline;
+
+	if (philo->table->opts.detect_mode != DETECT_SELF)
+	{
+		pthread_mutex_lock(fork);
+		return (0);
+	}
+	deadline = death_deadline(philo);
+	real_us = real_time_at(deadline);
+	abs.tv_sec = real_us / 1000000;
+	abs.tv_nsec = real_us % 1000000 * 1000;
+	if (pthread_mutex_clocklock(fork, CLOCK_MONOTONIC, &abs) == 0)
+		return (0);
+	declare_death(philo, get_time_us() - deadline);
+	return (1);
+}
+
+/**
+ * @brief Counts a philosopher that ate its last required meal.
+ *
+ * The one completing the table ends the run, as `check_all_full` does
+ * for the monitor.
+ *
+ * @param table Pointer to the t_table structure.
+ */
+void	note_full(t_table *table)
+{
+	if (__atomic_add_fetch(&table->full_count, 1, __ATOMIC_ACQ_REL)
+		< table->num_philos)
+		return ;
+	pthread_mutex_lock(&table->sim_end_mutex);
+	table->simulation_should_end = 1;
+	pthread_mutex_unlock(&table->sim_end_mutex);
+	timer_stop(table);
+}
@@ -0,0 +1,565 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   shard.c                                            :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: vrads <vrads@student.42.fr>                +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/07/13 15:06:41 by vrads             #+#    #+#             */
+/*   Updated: 2025/07/15 17:22:06 by vrads            ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "philo.h"
+
+/*
+** --shards=K: the ring is cut into K contiguous slices, each driven by
+** one pool thread that schedules its philosophers cooperatively, from a
+** binary heap of their next events (end of a phase, or death). A
+** philosopher takes both forks at once or none. The forks inside a
+** slice are plain words of `fork_busy` that only its thread touches; the
+** first fork of each slice is shared with the previous slice and is taken
+** with a compare-and-swap (with --procs, passed as a token: procs.c).
+** Freeing one the neighbour failed to take bumps its futex, and it then
+** retries its philosopher waiting at that edge. Forks freed inside a
+** slice go to the waiting neighbour with the earlier deadline first.
+** Deaths and full tables are detected by the slices themselves.
+**
+** Output order: every line of a slice is stamped with the time its
+** event was handled (`print_at`), so the lines of one slice come out in
+** timestamp order. They are written once `print_mutex` is taken, so a
+** line of one slice can follow a later one of another slice, by as long
+** as its thread waited for the mutex or was preempted in between. With
+** fewer CPUs than slices, that can be a scheduler time slice. --procs
+** merges the output of its slices instead (procs.c).
+*/
+
+/**
+ * @brief Swaps two heap slots and keeps `pos` in step.
+ */
+static void	heap_swap(t_shard *s, int a, int b)
+{
+	int	tmp;
+
+	tmp = s->heap[a];
+	s->heap[a] = s->heap[b];
+	s->heap[b] = tmp;
+	s->pos[s->heap[a]] = a;
+	s->pos[s->heap[b]] = b;
+}
+
+/**
+ * @brief Sets the next event of local philosopher `i` and restores the
+ *        heap order around it.
+ *
+ * @param s The shard.
+ * @param i Local index of the philosopher.
+ * @param due Simulated time of its next event.
+ */
+static void	set_due(t_shard *s, int i, long long due)
+{
+	int	slot;
+	int	child;
+
+	s->due[i] = due;
+	slot = s->pos[i];
+	while (slot > 0 && s->due[s->heap[(slot - 1) / 2]] > due)
+	{
+		heap_swap(s, slot, (slot - 1) / 2);
+		slot = (slot - 1) / 2;
+	}
+	while (2 * slot + 1 < s->count)
+	{
+		child = 2 * slot + 1;
+		if (child + 1 < s->count
+			&& s->due[s->heap[child + 1]] < s->due[s->heap[child]])
+			child++;
+		if (s->due[s->heap[child]] >= due)
+			break ;
+		heap_swap(s, slot, child);
+		slot = child;
+	}
+}
+
+/**
+ * @brief Starts a phase of local philosopher `i` ending at `end`; its
+ *        next event is that end, or its death if that comes first.
+ */
+static void	set_phase(t_shard *s, int i, long long end)
+{
+	long long	death;
+
+	death = s->table->philos[s->first + i].last_meal_time
+		+ s->table->time_to_die;
+	s->phase_end[i] = end;
+	if (end > death)
+		end = death;
+	set_due(s, i, end);
+}
+
+/**
+ * @brief Wakes the shard owning the other side of boundary fork `f`, or
+ *        every shard (`f` < 0) once the run ended.
+ */
+static void	wake_shards(t_table *table, t_shard *s, int f)
+{
+	t_shard	*other;
+	int		i;
+
+	i = 0;
+	while (f < 0 && i < table->opts.shards)
+	{
+		__atomic_add_fetch(&table->shards[i].seq, 1, __ATOMIC_RELEASE);
+		futex_wake(&table->shards[i++].seq, 1);
+	}
+	if (f < 0)
+		return ;
+	other = s + 1;
+	if (f == s->first)
+		other = s - 1;
+	if (other < table->shards)
+		other += table->opts.shards;
+	else if (other >= table->shards + table->opts.shards)
+		other -= table->opts.shards;
+	__atomic_store_n(&other->woken_ns, real_time_ns(), __ATOMIC_RELAXED);
+	__atomic_add_fetch(&other->seq, 1, __ATOMIC_RELEASE);
+	futex_wake(&other->seq, 1);
+}
+
+/**
+ * @brief Tells whether fork `f` is shared with another shard.
+ */
+static int	is_boundary(t_shard *s, int f)
+{
+	return (f == s->first
+		|| f == (s->first + s->count) % s->table->num_philos);
+}
+
+/**
+ * @brief Takes fork `f` if it is free.
+ *
+ * A boundary fork is FORK_HELD while taken, plus FORK_WANTED once the
+ * other shard failed to take it: only then does `fork_put` wake it.
+ * With `--procs` it is a token instead (`proc_fork_take`).
+ *
+ * @return 1 if taken, 0 if busy.
+ */
+static int	fork_take(t_shard *s, int f)
+{
+	uint32_t	old;
+
+	if (!is_boundary(s, f))
+	{
+		if (s->table->fork_busy[f])
+			return (0);
+		s->table->fork_busy[f] = FORK_HELD;
+		return (1);
+	}
+	if (s->table->opts.procs)
+		return (proc_fork_take(s, f));
+	old = __atomic_load_n(&s->table->fork_busy[f], __ATOMIC_RELAXED);
+	while (1)
+	{
+		if (!(old & FORK_HELD) && __atomic_compare_exchange_n(
+				&s->table->fork_busy[f], &old, old | FORK_HELD, 0,
+				__ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+			return (1);
+		if ((old & FORK_HELD) && ((old & FORK_WANTED)
+				|| __atomic_compare_exchange_n(&s->table->fork_busy[f], &old,
+					old | FORK_WANTED, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)))
+			return (0);
+	}
+}
+
+/**
+ * @brief Frees fork `f`; a boundary fork the other shard failed to take
+ *        also wakes that shard (with `--procs`, is sent to it).
+ */
+static void	fork_put(t_shard *s, int f)
+{
+	if (!is_boundary(s, f))
+	{
+		s->table->fork_busy[f] = 0;
+		return ;
+	}
+	if (s->table->opts.procs)
+	{
+		proc_fork_put(s, f);
+		return ;
+	}
+	if (__atomic_exchange_n(&s->table->fork_busy[f], 0, __ATOMIC_RELEASE)
+		& FORK_WANTED)
+		wake_shards(s->table, s, f);
+}
+
+/**
+ * @brief Leaves a philosopher waiting for its forks until its death.
+ *
+ * @param s The shard.
+ * @param i Local index of the philosopher.
+ * @param now Current simulated time.
+ */
+static void	wait_forks(t_shard *s, int i, long long now)
+{
+	t_philo	*p;
+
+	p = &s->table->philos[s->first + i];
+	if (p->waiting_fork < 0)
+	{
+		p->waiting_fork = s->first + i;
+		p->wait_since = now;
+	}
+	set_phase(s, i, LLONG_MAX);
+}
+
+/**
+ * @brief Prints one status line stamped with `now`, the time of the event
+ *        being handled, like the lines of `start_meal`.
+ *
+ * @param p The philosopher.
+ * @param status The status message.
+ * @param now Current simulated time.
+ */
+static void	print_at(t_philo *p, const char *status, long long now)
+{
+	t_event	ev;
+
+	ev.time_us = now;
+	ev.status = status;
+	print_events(p, &ev, 1, 0);
+}
+
+/**
+ * @brief Starts a meal: prints the forks and "is eating" as one record
+ *        and counts the meal.
+ *
+ * @param s The shard.
+ * @param p The philosopher, holding both forks.
+ * @param now Current simulated time.
+ */
+static void	start_meal(t_shard *s, t_philo *p, long long now)
+{
+	t_table	*table;
+	t_event	ev[EVENT_BATCH_MAX];
+
+	table = s->table;
+	ev[0].time_us = now;
+	ev[0].status = "has taken a fork";
+	ev[1] = ev[0];
+	ev[2].time_us = now;
+	ev[2].status = "is eating";
+	print_events(p, ev, 3, 0);
+	p->fork_wait_us = 0;
+	if (p->waiting_fork >= 0)
+		p->fork_wait_us = now - p->wait_since;
+	p->waiting_fork = -1;
+	if (table->time_to_die - (now - p->last_meal_time) < p->min_slack_us)
+		p->min_slack_us = table->time_to_die - (now - p->last_meal_time);
+	__atomic_store_n(&p->last_meal_time, now, __ATOMIC_RELEASE);
+	p->state = EATING;
+	if (++p->meals_eaten == table->num_must_eat && table->opts.procs)
+		proc_note_full(s);
+	else if (p->meals_eaten == table->num_must_eat)
+	{
+		note_full(table);
+		if (is_simulation_over(table))
+			wake_shards(table, s, -1);
+	}
+}
+
+/**
+ * @brief Starts a meal if both forks are free, or waits for them.
+ *
+ * A lone philosopher has a single fork and always waits; so does one
+ * already past its deadline, whose death is its next heap event.
+ *
+ * @param s The shard.
+ * @param i Local index of the philosopher.
+ * @param now Current simulated time.
+ */
+static void	try_eat(t_shard *s, int i, long long now)
+{
+	t_philo	*p;
+	int		l;
+
+	l = s->first + i;
+	p = &s->table->philos[l];
+	if (s->table->num_philos < 2 && p->waiting_fork < 0)
+		print_at(p, "has taken a fork", now);
+	if (s->table->num_philos < 2
+		|| now - p->last_meal_time > s->table->time_to_die
+		|| !fork_take(s, l))
+	{
+		wait_forks(s, i, now);
+		return ;
+	}
+	if (!fork_take(s, (l + 1) % s->table->num_philos))
+	{
+		fork_put(s, l);
+		wait_forks(s, i, now);
+		return ;
+	}
+	start_meal(s, p, now);
+	set_phase(s, i, now + s->table->time_to_eat);
+}
+
+/**
+ * @brief Gives freed forks to the waiting neighbours, earliest deadline
+ *        first.
+ *
+ * Only neighbours in this shard are handled here; across a boundary,
+ * `fork_put` woke the other shard.
+ *
+ * @param s The shard.
+ * @param i Local index of the philosopher that put its forks down.
+ * @param now Current simulated time.
+ */
+static void	feed_neighbours(t_shard *s, int i, long long now)
+{
+	t_philo	*left;
+	t_philo	*right;
+
+	left = NULL;
+	right = NULL;
+	if (i > 0 && s->table->philos[s->first + i - 1].waiting_fork >= 0)
+		left = &s->table->philos[s->first + i - 1];
+	if (i + 1 < s->count
+		&& s->table->philos[s->first + i + 1].waiting_fork >= 0)
+		right = &s->table->philos[s->first + i + 1];
+	if (left && (!right || left->last_meal_time <= right->last_meal_time))
+	{
+		try_eat(s, i - 1, now);
+		left = NULL;
+	}
+	if (right)
+		try_eat(s, i + 1, now);
+	if (left)
+		try_eat(s, i - 1, now);
+}
+
+/**
+ * @brief Moves local philosopher `i` past its due event.
+ *
+ * Eating ends in sleep, sleep in thinking (and a think delay as chosen
+ * by `--think`), thinking in a fork attempt. If the death deadline comes
+ * first, the philosopher dies. Phase lateness goes to `--stats`.
+ *
+ * @param s The shard.
+ * @param i Local index of the philosopher.
+ * @param now Current simulated time.
+ */
+static void	on_due(t_shard *s, int i, long long now)
+{
+	t_philo		*p;
+	long long	death;
+	long long	think;
+
+	p = &s->table->philos[s->first + i];
+	death = p->last_meal_time + s->table->time_to_die;
+	if (s->phase_end[i] > death)
+	{
+		if (declare_death(p, now - death))
+			wake_shards(s->table, s, -1);
+		return ;
+	}
+	p->sleeps++;
+	p->sleep_late_us += now - s->phase_end[i];
+	if (now - s->phase_end[i] > p->sleep_late_max_us)
+		p->sleep_late_max_us = now - s->phase_end[i];
+	if (p->state == EATING)
+	{
+		stats_record_overshoot(s->table, now - s->phase_end[i]);
+		fork_put(s, s->first + i);
+		fork_put(s, (s->first + i + 1) % s->table->num_philos);
+		p->state = SLEEPING;
+		print_at(p, "is sleeping", now);
+		set_phase(s, i, now + s->table->time_to_sleep);
+		feed_neighbours(s, i, now);
+		return ;
+	}
+	if (p->state == SLEEPING)
+	{
+		p->state = THINKING;
+		print_at(p, "is thinking", now);
+		if (s->table->opts.think_mode == THINK_ADAPTIVE)
+			think = adaptive_think_delay(p, now - p->last_meal_time);
+		else
+			think = static_think_delay(p, now - p->last_meal_time);
+		if (think > 0)
+		{
+			set_phase(s, i, now + think);
+			return ;
+		}
+	}
+	try_eat(s, i, now);
+}
+
+/**
+ * @brief Counts a boundary fork that reached this shard after a wait.
+ *
+ * @param s The shard.
+ * @param sent_ns When the other side let it go, as `real_time_ns`.
+ */
+void	shard_note_handoff(t_shard *s, long long sent_ns)
+{
+	long long	ns;
+
+	ns = real_time_ns() - sent_ns;
+	s->handoffs++;
+	s->handoff_ns += ns;
+	if (ns > s->handoff_max_ns)
+		s->handoff_max_ns = ns;
+}
+
+/**
+ * @brief Retries the philosophers at both ends of the shard, after the
+ *        neighbouring shard freed a boundary fork.
+ *
+ * @param s The shard.
+ * @param now Current simulated time.
+ */
+static void	retry_edges(t_shard *s, long long now)
+{
+	if (s->table->philos[s->first].waiting_fork >= 0)
+		try_eat(s, 0, now);
+	if (s->count > 1
+		&& s->table->philos[s->first + s->count - 1].waiting_fork >= 0)
+		try_eat(s, s->count - 1, now);
+}
+
+/**
+ * @brief Pool job driving one shard until the run ends.
+ *
+ * Runs every due event in deadline order, then sleeps on the shard's
+ * futex until the next one. A boundary fork freed by a neighbour bumps
+ * `seq`, which cuts the sleep short; `seq` is read before any fork
+ * attempt, so a wake-up between a failed attempt and the sleep is not
+ * lost. How long the wake-up took is kept for `--stats`. With `--procs`
+ * the sleep is a wait on the sockets of the process (`proc_wait`).
+ *
+ * @param arg Pointer to the t_shard structure, passed as `void*`.
+ * @return NULL when the simulation ends.
+ */
+void	*shard_routine(void *arg)
+{
+	t_shard		*s;
+	uint32_t	seen;
+	uint32_t	seq;
+	long long	now;
+	long long	woken;
+	int			top;
+
+	s = (t_shard *)arg;
+	seen = __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE);
+	while (!is_simulation_over(s->table))
+	{
+		seq = __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE);
+		now = get_time_us();
+		if (seq != seen)
+		{
+			seen = seq;
+			woken = __atomic_exchange_n(&s->woken_ns, 0, __ATOMIC_RELAXED);
+			if (woken)
+				shard_note_handoff(s, woken);
+			retry_edges(s, now);
+			continue ;
+		}
+		top = s->heap[0];
+		if (s->due[top] <= now)
+		{
+			on_due(s, top, now);
+			continue ;
+		}
+		if (s->table->opts.procs)
+			proc_wait(s, sim_to_real_us(s->due[top] - now));
+		else
+			futex_wait_us(&s->seq, seq, sim_to_real_us(s->due[top] - now));
+	}
+	return (NULL);
+}
+
+/**
+ * @brief Carves the shards and the fork states out of the table arena.
+ *
+ * Shard `k` gets philosophers `k * N / K` to `(k + 1) * N / K - 1`; its
+ * heap arrays are slices of four arrays of N entries.
+ *
+ * @param table Pointer to the t_table structure (philosophers set up).
+ * @return 0 on success (or without `--shards`), 1 if the arena is
+ *         exhausted.
+ */
+int	init_shards(t_table *table)
+{
+	int			n;
+	int			k;
+	int			*ints;
+	long long	*lls;
+
+	if (!table->opts.shards)
+		return (0);
+	n = table->num_philos;
+	table->shards = arena_alloc(&table->arena,
+			sizeof(t_shard) * table->opts.shards, ARENA_LINE);
+	table->fork_busy = arena_alloc(&table->arena, sizeof(uint32_t) * n,
+			ARENA_LINE);
+	ints = arena_alloc(&table->arena, sizeof(int) * 2 * n, ARENA_LINE);
+	lls = arena_alloc(&table->arena, sizeof(long long) * 2 * n, ARENA_LINE);
+	if (!table->shards || !table->fork_busy || !ints || !lls)
+	{
+		printf("Error: Allocation failed for shards.\n");
+		return (1);
+	}
+	k = -1;
+	while (++k < table->opts.shards)
+	{
+		table->shards[k].first = (long long)k * n / table->opts.shards;
+		table->shards[k].count = (long long)(k + 1) * n / table->opts.shards
+			- table->shards[k].first;
+		table->shards[k].heap = ints + table->shards[k].first;
+		table->shards[k].pos = ints + n + table->shards[k].first;
+		table->shards[k].due = lls + table->shards[k].first;
+		table->shards[k].phase_end = lls + n + table->shards[k].first;
+		table->shards[k].seq = 0;
+		table->shards[k].woken_ns = 0;
+		table->shards[k].handoffs = 0;
+		table->shards[k].handoff_ns = 0;
+		table->shards[k].handoff_max_ns = 0;
+		table->shards[k].table = table;
+	}
+	return (0);
+}
+
+/**
+ * @brief Prepares every shard for a new run.
+ *
+ * Frees every fork and schedules every philosopher's first fork attempt
+ * at the start, even ids a tenth of `time_to_eat` later, as the
+ * thread-per-philosopher routine staggers them.
+ *
+ * @param table Pointer to the t_table structure, `start_time` set.
+ */
+void	start_shards(t_table *table)
+{
+	t_shard	*s;
+	int		k;
+	int		i;
+
+	memset(table->fork_busy, 0, sizeof(uint32_t) * table->num_philos);
+	k = -1;
+	while (++k < table->opts.shards)
+	{
+		s = &table->shards[k];
+		i = -1;
+		while (++i < s->count)
+		{
+			table->philos[s->first + i].last_meal_time = table->start_time;
+			s->heap[i] = i;
+			s->pos[i] = i;
+			s->due[i] = LLONG_MIN;
+		}
+		i = -1;
+		while (++i < s->count)
+			set_phase(s, i, table->start_time + (table->time_to_eat / 10)
+				* (table->philos[s->first + i].id % 2 == 0));
+	}
+}
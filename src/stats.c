@@ -0,0 +1,529 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   stats.c                                            :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: vrads <vrads@student.42.fr>                +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/06/25 10:37:02 by vrads             #+#    #+#             */
+/*   Updated: 2025/07/15 11:52:13 by vrads            ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "philo.h"
+
+/**
+ * @brief Records the page-fault counters and time at the start of setup.
+ *
+ * @param table Pointer to the t_table structure.
+ */
+void	stats_begin_startup(t_table *table)
+{
+	struct rusage	ru;
+
+	getrusage(RUSAGE_SELF, &ru);
+	table->stats.startup_begin_us = real_time_us();
+	table->stats.run_begin_us = table->stats.startup_begin_us;
+	table->stats.minor_faults = ru.ru_minflt;
+	table->stats.major_faults = ru.ru_majflt;
+}
+
+/**
+ * @brief Turns the counters recorded by `stats_begin_startup` into deltas.
+ *
+ * Called once every pool thread has been created.
+ *
+ * @param table Pointer to the t_table structure.
+ */
+void	stats_end_startup(t_table *table)
+{
+	struct rusage	ru;
+
+	getrusage(RUSAGE_SELF, &ru);
+	table->stats.startup_us = real_time_us() - table->stats.startup_begin_us;
+	table->stats.minor_faults = ru.ru_minflt - table->stats.minor_faults;
+	table->stats.major_faults = ru.ru_majflt - table->stats.major_faults;
+}
+
+/**
+ * @brief Sums the meals eaten by every philosopher.
+ *
+ * Only called while the thread pool is idle.
+ *
+ * @param table Pointer to the t_table structure.
+ * @return Total number of meals.
+ */
+static long long	total_meals(t_table *table)
+{
+	long long	meals;
+	int			i;
+
+	meals = 0;
+	i = 0;
+	while (i < table->num_philos)
+	{
+		meals += table->philos[i].meals_eaten;
+		i++;
+	}
+	return (meals);
+}
+
+/**
+ * @brief Finds the smallest slack any philosopher had left at a meal.
+ *
+ * @param table Pointer to the t_table structure.
+ * @return Minimum of `time_to_die - time since last meal` over all meals,
+ *         in simulated microseconds.
+ */
+static long long	min_slack(t_table *table)
+{
+	long long	slack;
+	int			i;
+
+	slack = table->time_to_die;
+	i = 0;
+	while (i < table->num_philos)
+	{
+		if (table->philos[i].min_slack_us < slack)
+			slack = table->philos[i].min_slack_us;
+		i++;
+	}
+	return (slack);
+}
+
+/**
+ * @brief Adds the wake-up delays of this run to the totals.
+ *
+ * @param table Pointer to the t_table structure, thread pool idle.
+ */
+static void	add_sleep_lateness(t_table *table)
+{
+	t_philo	*philo;
+	int		i;
+
+	i = 0;
+	while (i < table->num_philos)
+	{
+		philo = &table->philos[i];
+		table->stats.sleeps += philo->sleeps;
+		table->stats.sleep_late_us += philo->sleep_late_us;
+		if (philo->sleep_late_max_us > table->stats.sleep_late_max_us)
+			table->stats.sleep_late_max_us = philo->sleep_late_max_us;
+		i++;
+	}
+}
+
+/**
+ * @brief Adds what each pool thread cost in this run to its role's total.
+ *
+ * Workers 0 to N-1 run philosophers, then come the monitor (unless
+ * `--detect=self`) and the timer service (thread_management.c). With
+ * `--shards` every worker drives philosophers.
+ *
+ * @param table Pointer to the t_table structure, thread pool idle.
+ */
+static void	add_thread_costs(t_table *table)
+{
+	t_thread_cost	*total;
+	t_thread_cost	*cost;
+	int				i;
+
+	i = 0;
+	while (i < table->pool.count)
+	{
+		cost = &table->pool.workers[i].cost;
+		total = &table->stats.cost[COST_PHILO];
+		if (i >= table->num_philos)
+			total = &table->stats.cost[COST_TIMER];
+		if (i == table->num_philos
+			&& table->opts.detect_mode == DETECT_MONITOR)
+			total = &table->stats.cost[COST_MONITOR];
+		total->cpu_us += cost->cpu_us;
+		total->nvcsw += cost->nvcsw;
+		total->nivcsw += cost->nivcsw;
+		i++;
+	}
+}
+
+/**
+ * @brief Folds a finished run into the totals printed by `--stats`.
+ *
+ * The first run's first event is measured from process start (cold
+ * start); later runs are measured from the warm restart request.
+ *
+ * @param table Pointer to the t_table structure, thread pool idle.
+ */
+void	stats_end_run(t_table *table)
+{
+	long long	slack;
+
+	slack = min_slack(table);
+	if (table->stats.runs == 0 || slack < table->stats.min_slack_us)
+		table->stats.min_slack_us = slack;
+	table->stats.meals += total_meals(table);
+	add_sleep_lateness(table);
+	add_thread_costs(table);
+	if (table->stats.runs == 0)
+		table->stats.cold_first_event_us = table->stats.first_event_us;
+	else
+		table->stats.warm_first_event_us += table->stats.first_event_us;
+	table->stats.runs++;
+}
+
+/**
+ * @brief Counts one eat phase in the overshoot histogram.
+ *
+ * Called by every philosopher after a meal, hence the atomic increment.
+ *
+ * @param table Pointer to the t_table structure.
+ * @param us How much longer than `time_to_eat` the meal took.
+ */
+void	stats_record_overshoot(t_table *table, long long us)
+{
+	long long	bucket;
+
+	bucket = us / OVERSHOOT_BUCKET_US;
+	if (bucket < 0)
+		bucket = 0;
+	if (bucket >= OVERSHOOT_BUCKETS)
+		bucket = OVERSHOOT_BUCKETS - 1;
+	__atomic_fetch_add(&table->stats.overshoot[bucket], 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Reads a percentile off the overshoot histogram.
+ *
+ * @param hist The histogram.
+ * @param total Number of samples in it (> 0).
+ * @param permille The percentile, in thousandths (990 for p99).
+ * @return Upper edge of the bucket holding the percentile, in us; values
+ *         in the last bucket are reported as its lower edge.
+ */
+static long long	overshoot_percentile(const long long *hist,
+		long long total, int permille)
+{
+	long long	seen;
+	int			i;
+
+	seen = 0;
+	i = 0;
+	while (i < OVERSHOOT_BUCKETS - 1)
+	{
+		seen += hist[i];
+		if (seen * 1000 >= total * permille)
+			return ((i + 1LL) * OVERSHOOT_BUCKET_US);
+		i++;
+	}
+	return ((long long)i * OVERSHOOT_BUCKET_US);
+}
+
+/**
+ * @brief Prints the eat-phase overshoot distribution and what
+ *        `--realtime` could set up.
+ *
+ * The percentiles have a resolution of OVERSHOOT_BUCKET_US.
+ *
+ * @param table Pointer to the t_table structure.
+ */
+static void	print_jitter_stats(t_table *table)
+{
+	static const char	*names[] = {"none", "arena", "all"};
+	long long			total;
+	int					i;
+
+	total = 0;
+	i = 0;
+	while (i < OVERSHOOT_BUCKETS)
+		total += table->stats.overshoot[i++];
+	fprintf(stderr, "eat_phases=%lld\n", total);
+	if (total > 0)
+	{
+		fprintf(stderr, "eat_overshoot_p50_us=%lld\n",
+			overshoot_percentile(table->stats.overshoot, total, 500));
+		fprintf(stderr, "eat_overshoot_p99_us=%lld\n",
+			overshoot_percentile(table->stats.overshoot, total, 990));
+		fprintf(stderr, "eat_overshoot_p999_us=%lld\n",
+			overshoot_percentile(table->stats.overshoot, total, 999));
+	}
+	fprintf(stderr, "realtime=%d\n", table->opts.realtime);
+	if (!table->opts.realtime)
+		return ;
+	fprintf(stderr, "rt_prefault_pages=%ld\n", table->rt.prefault_pages);
+	fprintf(stderr, "rt_mlock=%s\n", names[table->rt.mlock]);
+	fprintf(stderr, "rt_fifo=%d\n", table->rt.fifo);
+	fprintf(stderr, "rt_writer_pinned=%d\n", table->rt.pinned);
+}
+
+/**
+ * @brief Prints how philosophers waited out their phases, and how late
+ *        they woke up.
+ *
+ * `sleep_syscalls` counts the `usleep` calls of `--timer=sleep`, or the
+ * futex waits and wakes of philosophers and service with `--timer=wheel`.
+ *
+ * @param table Pointer to the t_table structure.
+ */
+static void	print_timer_stats(t_table *table)
+{
+	static const char	*names[] = {"wheel", "sleep"};
+
+	fprintf(stderr, "timer=%s\n", names[table->opts.timer_mode]);
+	fprintf(stderr, "sleep_syscalls=%lld\n", table->stats.sleep_syscalls);
+	if (table->opts.timer_mode == TIMER_WHEEL)
+		fprintf(stderr, "timer_wakeups=%lld\n", table->wheel.wakeups);
+	fprintf(stderr, "sleeps=%lld\n", table->stats.sleeps);
+	if (table->stats.sleeps > 0)
+		fprintf(stderr, "sleep_late_avg_us=%lld\n",
+			table->stats.sleep_late_us / table->stats.sleeps);
+	fprintf(stderr, "sleep_late_max_us=%lld\n",
+		table->stats.sleep_late_max_us);
+}
+
+/**
+ * @brief Prints what the philosopher, monitor and timer threads cost.
+ *
+ * Per role: CPU time and context switches over all runs, then CPU
+ * microseconds per meal and wake-ups per cycle. A cycle is one meal
+ * (eat, sleep, think); every voluntary switch is one block and one
+ * wake-up. Philosophers' wake-ups are also given per phase waited out.
+ * For the monitor and the timer, costs are per meal of the whole table.
+ *
+ * @param table Pointer to the t_table structure.
+ */
+static void	print_cost_stats(t_table *table)
+{
+	static const char	*roles[] = {"philo", "monitor", "timer"};
+	t_thread_cost		*c;
+	long long			meals;
+	int					r;
+
+	meals = table->stats.meals;
+	r = 0;
+	while (r < COST_ROLES)
+	{
+		c = &table->stats.cost[r];
+		if ((r == COST_MONITOR && table->opts.detect_mode == DETECT_SELF)
+			|| (r == COST_TIMER && table->opts.timer_mode != TIMER_WHEEL)
+			|| (r != COST_PHILO && table->opts.shards))
+		{
+			r++;
+			continue ;
+		}
+		fprintf(stderr, "%s_cpu_us=%lld\n", roles[r], c->cpu_us);
+		fprintf(stderr, "%s_voluntary_switches=%lld\n", roles[r], c->nvcsw);
+		fprintf(stderr, "%s_involuntary_switches=%lld\n", roles[r], c->nivcsw);
+		if (meals > 0)
+		{
+			fprintf(stderr, "%s_cpu_us_per_meal=%.1f\n", roles[r],
+				(double)c->cpu_us / meals);
+			fprintf(stderr, "%s_wakeups_per_cycle=%.2f\n", roles[r],
+				(double)c->nvcsw / meals);
+		}
+		r++;
+	}
+	if (table->stats.sleeps > 0)
+		fprintf(stderr, "philo_wakeups_per_phase=%.2f\n",
+			(double)table->stats.cost[COST_PHILO].nvcsw / table->stats.sleeps);
+}
+
+/**
+ * @brief Prints process-wide resource usage (CPU time, context switches).
+ *
+ * @param wall_us Wall-clock duration of the run, used for meals/sec.
+ * @param meals Total meals eaten.
+ */
+static void	print_rusage_stats(long long wall_us, long long meals)
+{
+	struct rusage	ru;
+
+	getrusage(RUSAGE_SELF, &ru);
+	fprintf(stderr, "wall_us=%lld\n", wall_us);
+	fprintf(stderr, "cpu_user_us=%lld\n",
+		ru.ru_utime.tv_sec * 1000000LL + ru.ru_utime.tv_usec);
+	fprintf(stderr, "cpu_sys_us=%lld\n",
+		ru.ru_stime.tv_sec * 1000000LL + ru.ru_stime.tv_usec);
+	fprintf(stderr, "voluntary_ctx_switches=%ld\n", ru.ru_nvcsw);
+	fprintf(stderr, "involuntary_ctx_switches=%ld\n", ru.ru_nivcsw);
+	fprintf(stderr, "meals=%lld\n", meals);
+	if (wall_us > 0)
+		fprintf(stderr, "meals_per_sec=%.1f\n", meals * 1e6 / wall_us);
+}
+
+/**
+ * @brief Prints the output sink's backend and counters.
+ *
+ * @param sink Pointer to the t_sink structure.
+ */
+static void	print_sink_stats(t_sink *sink)
+{
+	static const char	*names[] = {"stdio", "write", "uring"};
+
+	fprintf(stderr, "sink=%s\n", names[sink->mode]);
+	if (sink->mode == SINK_STDIO)
+		return ;
+	fprintf(stderr, "sink_bytes=%lld\n", sink->bytes);
+	fprintf(stderr, "sink_writes=%lld\n", sink->writes);
+	fprintf(stderr, "sink_stalls=%lld\n", sink->stalls);
+	fprintf(stderr, "sink_errors=%lld\n", sink->errors);
+	if (sink->mode == SINK_URING)
+		fprintf(stderr, "sink_fixed_buffers=%d\n", sink->ring.fixed);
+}
+
+/**
+ * @brief Prints one `--log` counter per event type on a single line.
+ *
+ * Example: `log_dropped=fork:0,eat:0,sleep:12,think:3,died:0`
+ *
+ * @param key Name of the counter.
+ * @param counts One value per event type.
+ */
+static void	print_log_counter(const char *key, const long long *counts)
+{
+	int	type;
+
+	fprintf(stderr, "%s=", key);
+	type = 0;
+	while (type < EVENT_TYPES)
+	{
+		fprintf(stderr, "%s%s:%lld", type ? "," : "",
+			event_type_name(type), counts[type]);
+		type++;
+	}
+	fprintf(stderr, "\n");
+}
+
+/**
+ * @brief Prints the `--log` policy and its exact per-type counters.
+ *
+ * @param log Pointer to the t_log structure.
+ */
+static void	print_log_stats(t_log *log)
+{
+	static const char	*names[] = {"block", "drop", "sample"};
+
+	fprintf(stderr, "log=%s\n", names[log->mode]);
+	if (log->mode == LOG_BLOCK)
+		return ;
+	print_log_counter("log_written", log->written);
+	print_log_counter("log_dropped", log->dropped);
+	if (log->mode == LOG_SAMPLE)
+		print_log_counter("log_sampled_out", log->sampled_out);
+}
+
+/**
+ * @brief Prints the `--compress` ratio and the CPU time it cost.
+ *
+ * `compress_mb_per_cpu_s` is the text throughput one core sustains.
+ *
+ * @param z Pointer to the t_compressor structure.
+ */
+static void	print_compress_stats(t_compressor *z)
+{
+	if (!z->enabled)
+		return ;
+	fprintf(stderr, "compress_frames=%lld\n", z->frames);
+	fprintf(stderr, "compress_raw_bytes=%lld\n", z->raw_bytes);
+	fprintf(stderr, "compress_bytes=%lld\n", z->comp_bytes);
+	if (z->comp_bytes > 0)
+		fprintf(stderr, "compress_ratio=%.2f\n",
+			(double)z->raw_bytes / z->comp_bytes);
+	fprintf(stderr, "compress_cpu_us=%lld\n", z->cpu_ns / 1000);
+	if (z->cpu_ns > 0)
+		fprintf(stderr, "compress_mb_per_cpu_s=%.1f\n",
+			z->raw_bytes * 1e3 / z->cpu_ns);
+}
+
+/**
+ * @brief Prints how boundary forks travelled between shards (`--shards`)
+ *        or processes (`--procs`).
+ *
+ * A handoff is a fork freed for a shard that had failed to take it; its
+ * latency runs from the release to the moment the receiving shard acts
+ * on it (futex wake-up, or message delivery with `--procs`).
+ *
+ * @param table Pointer to the t_table structure.
+ */
+static void	print_handoff_stats(t_table *table)
+{
+	long long	count;
+	long long	ns;
+	long long	max_ns;
+	int			k;
+
+	count = 0;
+	ns = 0;
+	max_ns = 0;
+	k = -1;
+	while (++k < table->opts.shards)
+	{
+		count += table->shards[k].handoffs;
+		ns += table->shards[k].handoff_ns;
+		if (table->shards[k].handoff_max_ns > max_ns)
+			max_ns = table->shards[k].handoff_max_ns;
+	}
+	if (table->opts.procs)
+		fprintf(stderr, "procs=%d\nproc_messages=%lld\n", table->opts.procs,
+			table->procs.messages);
+	fprintf(stderr, "fork_handoffs=%lld\n", count);
+	if (count > 0)
+		fprintf(stderr, "fork_handoff_us_mean=%.1f\n"
+			"fork_handoff_us_max=%.1f\n", ns / 1e3 / count, max_ns / 1e3);
+}
+
+/**
+ * @brief Prints the collected run statistics to stderr (`--stats`).
+ *
+ * One `key=value` pair per line, so the output is easy to grep and does
+ * not mix with the simulation output on stdout. `bench/run_bench.sh`
+ * parses these keys.
+ *
+ * @param table Pointer to the t_table structure.
+ */
+void	print_stats(t_table *table)
+{
+	if (!table->opts.stats)
+		return ;
+	fprintf(stderr, "philos=%d\n", table->num_philos);
+	fprintf(stderr, "arena_bytes=%zu\n", table->arena.size);
+	fprintf(stderr, "arena_hugepages=%d\n", table->arena.hugepages);
+	if (clock_tsc_mhz() > 0)
+		fprintf(stderr, "clock=tsc\nclock_tsc_mhz=%.3f\n", clock_tsc_mhz());
+	else
+		fprintf(stderr, "clock=vdso\n");
+	fprintf(stderr, "startup_us=%lld\n", table->stats.startup_us);
+	fprintf(stderr, "startup_minor_faults=%ld\n", table->stats.minor_faults);
+	fprintf(stderr, "startup_major_faults=%ld\n", table->stats.major_faults);
+	print_rusage_stats(real_time_us() - table->stats.startup_begin_us,
+		table->stats.meals);
+	if (table->opts.shards)
+	{
+		fprintf(stderr, "detect=shard\nshards=%d\n", table->opts.shards);
+		print_handoff_stats(table);
+	}
+	else
+		fprintf(stderr, "detect=%s\n",
+			table->opts.detect_mode == DETECT_SELF ? "self" : "monitor");
+	if (table->opts.scheduled)
+		fprintf(stderr, "schedule_period_us=%lld\n"
+			"schedule_min_slack_us=%lld\n", table->sched_gap_us,
+			table->time_to_die - table->sched_gap_us);
+	fprintf(stderr, "death_latency_us=%lld\n", table->stats.death_latency_us);
+	fprintf(stderr, "min_slack_us=%lld\n", table->stats.min_slack_us);
+	print_timer_stats(table);
+	print_cost_stats(table);
+	print_jitter_stats(table);
+	if (table->chaos.enabled)
+	{
+		fprintf(stderr, "chaos_yields=%lld\n", table->chaos.yields);
+		fprintf(stderr, "chaos_sleeps=%lld\n", table->chaos.sleeps);
+	}
+	print_sink_stats(&table->sink);
+	print_log_stats(&table->log);
+	print_compress_stats(&table->zip);
+	fprintf(stderr, "runs=%d\n", table->stats.runs);
+	fprintf(stderr, "cold_first_event_us=%lld\n",
+		table->stats.cold_first_event_us);
+	if (table->stats.runs > 1)
+		fprintf(stderr, "restart_first_event_us=%lld\n",
+			table->stats.warm_first_event_us / (table->stats.runs - 1));
+}
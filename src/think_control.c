@@ -0,0 +1,167 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   think_control.c                                    :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: vrads <vrads@student.42.fr>                +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/06/30 09:47:12 by vrads             #+#    #+#             */
+/*   Updated: 2025/07/01 18:12:30 by vrads            ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "philo.h"
+
+/**
+ * @brief Computes the classic think delay (`--think=static`).
+ *
+ * Sleeps `(time_to_eat - time_to_sleep) / 2` when eating takes longer
+ * than sleeping, and only if that delay cannot make the philosopher
+ * starve. Otherwise there is no delay.
+ *
+ * @param philo Pointer to the t_philo structure of the thinking philosopher.
+ * @param time_since_last_meal Simulated us elapsed since its last meal.
+ * @return The think delay in simulated microseconds (0 for none).
+ */
+long long	static_think_delay(t_philo *philo, long long time_since_last_meal)
+{
+	long long	think_time;
+
+	if (philo->table->time_to_eat <= philo->table->time_to_sleep)
+		return (0);
+	think_time = (philo->table->time_to_eat - philo->table->time_to_sleep) / 2;
+	if (think_time <= 0)
+		think_time = 1000;
+	if (time_since_last_meal + think_time >= philo->table->time_to_die)
+		return (0);
+	return (think_time);
+}
+
+/**
+ * @brief Structural think delay, the floor of the adaptive controller.
+ *
+ * At most floor(N/2) philosophers can eat at once, so at full throughput
+ * each philosopher eats once every N * time_to_eat / floor(N/2): two
+ * meals for even N, slightly more for odd N (three meals for N = 3).
+ * Whatever part of that cycle is not spent eating or sleeping is ideally
+ * spent thinking. Thinking less cannot raise throughput, it only makes a
+ * philosopher grab a fork its neighbour is about to need.
+ *
+ * @param table Pointer to the t_table structure.
+ * @return The structural think delay in simulated microseconds.
+ */
+long long	base_think_delay(t_table *table)
+{
+	long long	diners;
+	long long	cycle;
+	long long	think;
+
+	if (table->num_philos < 2)
+		return (0);
+	diners = table->num_philos / 2;
+	cycle = (table->num_philos * table->time_to_eat + diners - 1) / diners;
+	think = cycle - table->time_to_eat - table->time_to_sleep;
+	if (think < 0)
+		return (0);
+	return (think);
+}
+
+/**
+ * @brief Feedback controller for the think delay (`--think=adaptive`).
+ *
+ * Time spent blocked on a fork is wasted slack: the philosopher is hungry
+ * but cannot eat, and while it holds its first fork it also blocks a
+ * neighbour. The controller therefore converts observed fork waits into
+ * thinking, and probes back down when waits vanish:
+ * - if the last fork wait exceeded THINK_WAIT_EPS_US, the delay grows by
+ *   half of that wait (the philosopher arrived at the table too early);
+ * - otherwise it decays by a quarter of its excess over the structural
+ *   delay (`base_think_delay`), to recover throughput.
+ * The fork wait is mostly caused by the neighbours, which is why the
+ * controller never goes below the structural delay: undercutting it only
+ * moves the wait onto a neighbour. The wait before the first meal comes
+ * from the start-up stagger, not from the schedule, and is ignored.
+ * The result is clamped so that, after thinking and a fork wait as long as
+ * the smoothed recent waits (`fork_wait_avg_us`), at least THINK_GUARD_US
+ * of slack remain before `time_to_die`. Slack always wins over throughput.
+ *
+ * @param philo Pointer to the t_philo structure of the thinking philosopher.
+ * @param time_since_last_meal Simulated us elapsed since its last meal.
+ * @return The think delay in simulated microseconds (0 for none).
+ */
+long long	adaptive_think_delay(t_philo *philo, long long time_since_last_meal)
+{
+	long long	limit;
+	long long	base;
+
+	base = base_think_delay(philo->table);
+	if (philo->meals_eaten <= 1)
+		philo->fork_wait_us = 0;
+	philo->fork_wait_avg_us += (philo->fork_wait_us
+			- philo->fork_wait_avg_us) / 4;
+	if (philo->fork_wait_us > THINK_WAIT_EPS_US)
+		philo->think_us += philo->fork_wait_us / 2;
+	else if (philo->think_us > base)
+		philo->think_us -= (philo->think_us - base + 3) / 4;
+	else
+		philo->think_us = base;
+	limit = philo->table->time_to_die - time_since_last_meal
+		- philo->fork_wait_avg_us - THINK_GUARD_US;
+	if (philo->think_us > limit)
+		philo->think_us = limit;
+	if (philo->think_us < 0)
+		philo->think_us = 0;
+	return (philo->think_us);
+}
+
+/**
+ * @brief Tells whether a neighbour should get the shared fork first.
+ *
+ * A neighbour has priority when it is not eating and its death deadline
+ * comes before ours.
+ *
+ * @param philo Pointer to the t_philo structure of the hungry philosopher.
+ * @param other Pointer to the neighbour's t_philo structure.
+ * @return 1 if `philo` should let `other` eat first, 0 otherwise.
+ */
+static int	neighbour_is_hungrier(t_philo *philo, t_philo *other)
+{
+	if (__atomic_load_n(&other->state, __ATOMIC_RELAXED) == EATING)
+		return (0);
+	return (__atomic_load_n(&other->last_meal_time, __ATOMIC_ACQUIRE)
+		< __atomic_load_n(&philo->last_meal_time, __ATOMIC_RELAXED));
+}
+
+/**
+ * @brief Lets a hungrier neighbour take the shared fork first.
+ *
+ * Fork waits are mostly decided by who reaches a shared fork first, not
+ * by who needs it most. In adaptive mode a philosopher that finished
+ * thinking keeps waiting, in THINK_YIELD_STEP_US steps, while a neighbour
+ * with an earlier death deadline is still waiting for its meal, unless
+ * its own slack drops to THINK_GUARD_US plus the smoothed fork wait.
+ * Deadlines are read with atomic loads, without taking `meal_time_mutex`.
+ *
+ * @param philo Pointer to the t_philo structure of the hungry philosopher.
+ */
+void	yield_to_hungrier_neighbour(t_philo *philo)
+{
+	t_table	*table;
+	t_philo	*left;
+	t_philo	*right;
+
+	table = philo->table;
+	left = &table->philos[(philo->id + table->num_philos - 2)
+		% table->num_philos];
+	right = &table->philos[philo->id % table->num_philos];
+	while (!is_simulation_over(table)
+		&& (neighbour_is_hungrier(philo, left)
+			|| neighbour_is_hungrier(philo, right)))
+	{
+		if (table->time_to_die - (get_time_us()
+				- __atomic_load_n(&philo->last_meal_time, __ATOMIC_RELAXED))
+			< THINK_GUARD_US + philo->fork_wait_avg_us)
+			return ;
+		usleep(sim_to_real_us(THINK_YIELD_STEP_US));
+	}
+}
@@ -6,7 +6,7 @@
 /*   By: vrads <vrads@student.42.fr>                +#+  +:+       +#+        */
 /*                                                +#+#+#+#+#+   +#+           */
 /*   Created: 2025/06/17 16:05:54 by vrads             #+#    #+#             */
-/*   Updated: 2025/06/17 16:05:55 by vrads            ###   ########.fr       */
+/*   Updated: 2025/07/15 16:24:37 by vrads            ###   ########.fr       */
 /*                                                                            */
 /* ************************************************************************** */
 
@@ -15,9 +15,17 @@
 /**
  * @brief Initializes all components of the simulation.
  *
- * Calls `init_table` to parse arguments and set up basic table data,
- * then `init_mutexes` to prepare all necessary mutexes, and finally
- * `init_philos` to set up the philosopher structures.
+ * In order, this function:
+ * 1. Parses the arguments into the table (`init_table`).
+ * 2. Maps the arena holding all per-philosopher state (`init_table_arena`).
+ * 3. Prepares the mutexes and the deadlock detector's wait-for graph.
+ * 4. Sets up the `--sink` backend, `--compress` and the `--log` policy.
+ * 5. Sets up the philosophers, then what their mode needs: the timer
+ *    wheel, the shards, the processes of `--procs` or the schedule.
+ * 6. Creates the monitor's event descriptors. Failing to is not an error:
+ *    the monitor then polls instead.
+ * 7. Sets up checkpoints and the `--record` or `--replay` log.
+ * 8. With `--resume`, restores philosopher state from the snapshot.
  *
  * @param table Pointer to the t_table structure to be initialized.
  * @param argc Argument count from main.
@@ -28,128 +36,175 @@ int	initialize_simulation(t_table *table, int argc, char **argv)
 {
 	if (init_table(table, argc, argv) != 0)
 		return (1);
+	if (init_table_arena(table) != 0)
+		return (1);
 	if (init_mutexes(table) != 0)
 		return (1);
-	if (init_philos(table) != 0)
+	if (init_wait_for_graph(table) != 0)
+		return (1);
+	if (sink_init(table) != 0 || compress_init(table) != 0
+		|| log_init(table) != 0)
+		return (1);
+	if (init_philos(table) != 0 || init_timer_wheel(table) != 0
+		|| init_shards(table) != 0 || init_procs(table) != 0
+		|| init_schedule(table) != 0)
+		return (1);
+	init_monitor_events(table);
+	if (init_checkpoint(table) != 0 || init_replay(table) != 0)
+		return (1);
+	if (table->opts.resume_file && load_checkpoint(table) != 0)
 		return (1);
 	return (0);
 }
 
 /**
- * @brief Handles errors during philosopher thread creation.
+ * @brief Prepares the table for another simulation on the same threads.
  *
- * Prints an error message, sets the simulation end flag, and attempts to join
- * all previously created and validated philosopher threads.
+ * Clears the end flag, the per-run philosopher fields, the monitor's
+ * deadline owner, the wait-for graph, the timer wheel and the checkpoint
+ * schedule, then restores the snapshot again with `--resume`. Threads,
+ * mutexes, the arena and the monitor's descriptors are kept: only state
+ * is reset. The pool is idle here, so no lock is needed.
  *
- * @param table Pointer to the t_table structure.
- * @param failed_philo_idx Index of the philosopher whose thread creation failed.
- * @param num_created_threads Number of philosopher threads successfully created before the failure.
+ * @param table Pointer to the t_table structure of a finished run.
+ * @return 0 on success, 1 if the checkpoint cannot be reloaded.
  */
-static void handle_thread_creation_error(t_table *table, int failed_philo_idx, int num_created_threads)
-{
-	int j;
-
-	printf("Error: pthread_create failed for philo %d\n", failed_philo_idx + 1);
-	pthread_mutex_lock(&table->sim_end_mutex);
-	table->simulation_should_end = 1;
-	pthread_mutex_unlock(&table->sim_end_mutex);
-
-	j = 0;
-	while (j < num_created_threads)
-	{
-		if (table->philos[j].thread_valid)
-			pthread_join(table->philos[j].thread, NULL);
-		j++;
-	}
-}
-
-/**
- * @brief Creates and launches all philosopher threads.
- *
- * Iterates from 0 to `table->num_philos - 1`. In each iteration:
- * 1. Sets the philosopher's `last_meal_time` to the simulation `start_time`.
- * 2. Attempts to create a new thread for the philosopher using `pthread_create`,
- *    with `philosopher_routine` as the thread function.
- * 3. If thread creation fails, calls `handle_thread_creation_error` to manage
- *    the error and cleanup, then returns 1.
- * 4. Marks the philosopher's thread as valid upon successful creation.
- *
- * @param table Pointer to the t_table structure containing philosopher data and settings.
- * @param start_time The official start time of the simulation (in milliseconds).
- * @return 0 if all philosopher threads are created successfully, 1 on error.
- */
-static int	create_philosopher_threads(t_table *table, long long start_time)
+static int	reset_simulation(t_table *table)
 {
 	int	i;
 
+	table->simulation_should_end = 0;
+	table->deadline_owner = 0;
+	table->full_count = 0;
 	i = 0;
 	while (i < table->num_philos)
 	{
-		table->philos[i].last_meal_time = start_time;
-		if (pthread_create(&table->philos[i].thread, NULL,
-				philosopher_routine, &table->philos[i]) != 0)
-		{
-			handle_thread_creation_error(table, i, i);
-			return (1);
-		}
-		table->philos[i].thread_valid = 1;
+		reset_philo(&table->philos[i]);
 		i++;
 	}
+	reset_wait_for_graph(table);
+	reset_timer_wheel(table);
+	reset_checkpoint(table);
+	if (table->opts.resume_file && load_checkpoint(table) != 0)
+		return (1);
 	return (0);
 }
 
 /**
- * @brief Creates and launches the monitoring thread.
+ * @brief Binds the pool threads to the table and starts one simulation.
  *
- * Attempts to create a new thread for the monitoring routine. If creation fails,
- * it prints an error message and sets the simulation end flag.
+ * This function:
+ * 1. Records the simulation start time.
+ * 2. With `--shards`, binds worker `k` to shard `k` and wakes the pool;
+ *    there are no other threads.
+ * 3. Otherwise sets each philosopher's `last_meal_time` to the start time,
+ *    minus the time since its last meal restored from a checkpoint.
+ * 4. Binds worker `i` to philosopher `i`. With `--scheduled` it runs
+ *    `scheduled_routine`, and its first meal is set here.
+ * 5. Binds the next worker to the monitor, except with `--detect=self`.
+ *    With `--replay`, it runs the monitor's replay counterpart.
+ * 6. Binds the last worker to the timer service with `--timer=wheel`.
+ * 7. Wakes them all.
  *
  * @param table Pointer to the t_table structure.
- * @param monitor_thread_id Pointer to a pthread_t variable where the ID of the
- *                          created monitor thread will be stored.
- * @return 0 if the monitor thread is created successfully, 1 on error.
  */
-int	create_monitor_thread(t_table *table, pthread_t *monitor_thread_id)
+static void	start_simulation(t_table *table)
 {
-	if (pthread_create(monitor_thread_id, NULL, monitoring_routine, table) != 0)
+	long long	start_time;
+	int			i;
+
+	start_time = get_time_us();
+	table->start_time = start_time;
+	if (table->opts.shards)
 	{
-		printf("Error: pthread_create failed for monitor thread\n");
-		pthread_mutex_lock(&table->sim_end_mutex);
-		table->simulation_should_end = 1;
-		pthread_mutex_unlock(&table->sim_end_mutex);
-		return (1);
+		start_shards(table);
+		i = -1;
+		while (++i < table->opts.shards)
+		{
+			table->pool.workers[i].job = shard_routine;
+			table->pool.workers[i].arg = &table->shards[i];
+		}
+		pool_run(&table->pool);
+		return ;
 	}
-	return (0);
+	start_schedule(table);
+	i = 0;
+	while (i < table->num_philos)
+	{
+		table->philos[i].last_meal_time = start_time
+			- table->philos[i].resume_elapsed;
+		table->pool.workers[i].job = philosopher_routine;
+		if (table->opts.scheduled)
+			table->pool.workers[i].job = scheduled_routine;
+		table->pool.workers[i].arg = &table->philos[i];
+		i++;
+	}
+	if (table->opts.detect_mode == DETECT_MONITOR)
+	{
+		table->pool.workers[i].job = monitoring_routine;
+		if (table->replay.replaying)
+			table->pool.workers[i].job = replay_monitor_routine;
+		table->pool.workers[i++].arg = table;
+	}
+	if (table->opts.timer_mode == TIMER_WHEEL)
+	{
+		table->pool.workers[i].job = timer_routine;
+		table->pool.workers[i].arg = table;
+	}
+	pool_run(&table->pool);
 }
 
 /**
- * @brief Launches all threads for the simulation (philosophers and monitor).
+ * @brief Runs the simulation `--repeat` times on one persistent thread pool.
  *
- * 1. Records the simulation start time using `get_time_ms()` and stores it in `table->start_time`.
- * 2. Calls `create_philosopher_threads` to create and start all philosopher threads.
- *    If this fails, returns 1.
- * 3. Calls `create_monitor_thread` to create and start the monitoring thread.
- *    If this fails, returns 1.
+ * With `--procs`, the run is handed to `run_procs` instead. Otherwise
+ * this function:
+ * 1. Creates one parked thread per philosopher, one for the monitor
+ *    unless `--detect=self`, and one for the timer service with
+ *    `--timer=wheel`. With `--shards`, it creates one per shard instead.
+ * 2. Applies `--realtime` to them, and takes the startup statistics.
+ * 3. For each run, resets the table first, unless it is the first run
+ *    (warm restart). The restart-to-first-event latency is measured from
+ *    this point.
+ * 4. Starts the simulation and waits until every thread is back in the
+ *    pool.
+ * 5. Flushes the output of the run.
  *
- * @param table Pointer to the t_table structure.
- * @param monitor_thread_id Pointer to a pthread_t variable for storing the monitor thread ID.
- * @return 0 if all threads are launched successfully, 1 on any error.
+ * @param table Pointer to the initialized t_table structure.
+ * @return 0 if every run completed, 1 if the pool could not be created or
+ *         a warm restart failed.
  */
-int	launch_threads(t_table *table, pthread_t *monitor_thread_id)
+int	run_simulations(t_table *table)
 {
-	long long	start_time;
+	int	run;
 
-	start_time = get_time_ms();
-	table->start_time = start_time;
-
-	if (create_philosopher_threads(table, start_time) != 0)
-	{
+	if (table->opts.procs)
+		return (run_procs(table));
+	run = table->num_philos + (table->opts.detect_mode == DETECT_MONITOR)
+		+ (table->opts.timer_mode == TIMER_WHEEL);
+	if (table->opts.shards)
+		run = table->opts.shards;
+	if (pool_init(&table->pool, &table->arena, run) != 0)
 		return (1);
-	}
-
-	if (create_monitor_thread(table, monitor_thread_id) != 0)
+	realtime_setup(table);
+	stats_end_startup(table);
+	run = 0;
+	while (run < table->opts.repeat)
 	{
-		return (1);
+		table->stats.first_event_us = 0;
+		if (run > 0)
+		{
+			table->stats.run_begin_us = real_time_us();
+			if (reset_simulation(table) != 0)
+				return (1);
+		}
+		start_simulation(table);
+		pool_wait(&table->pool);
+		log_drain(table);
+		compress_flush(table);
+		sink_flush(&table->sink);
+		stats_end_run(table);
+		run++;
 	}
 	return (0);
 }
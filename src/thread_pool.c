@@ -0,0 +1,251 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   thread_pool.c                                      :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: vrads <vrads@student.42.fr>                +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/07/03 10:31:09 by vrads             #+#    #+#             */
+/*   Updated: 2025/07/15 17:01:48 by vrads            ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#define _GNU_SOURCE // RUSAGE_THREAD
+#include "philo.h"
+
+/**
+ * @brief Reads the calling thread's CPU time and context switches.
+ *
+ * @param c Receives the counters (totals since the thread started).
+ */
+static void	thread_cost_now(t_thread_cost *c)
+{
+	struct timespec	ts;
+	struct rusage	ru;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	c->cpu_us = ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+	getrusage(RUSAGE_THREAD, &ru);
+	c->nvcsw = ru.ru_nvcsw;
+	c->nivcsw = ru.ru_nivcsw;
+}
+
+/**
+ * @brief Runs the worker's job and records what it cost the thread.
+ *
+ * Two syscalls on each side of the job, none inside it. Parking on the
+ * pool futex between rounds is not counted.
+ *
+ * @param worker Pointer to the calling worker.
+ */
+static void	run_job(t_worker *worker)
+{
+	t_thread_cost	start;
+
+	thread_cost_now(&start);
+	worker->job(worker->arg);
+	thread_cost_now(&worker->cost);
+	worker->cost.cpu_us -= start.cpu_us;
+	worker->cost.nvcsw -= start.nvcsw;
+	worker->cost.nivcsw -= start.nivcsw;
+}
+
+/**
+ * @brief Body of every pool thread.
+ *
+ * Parks on the pool's `generation` futex. Each time `pool_run` bumps the
+ * generation, the worker runs its current job once (`run_job`), then decrements
+ * `running` and wakes `pool_wait` when it was the last one. The loop ends
+ * when `pool_destroy` sets `shutdown`.
+ *
+ * @param arg Pointer to the worker's t_worker structure, passed as `void*`.
+ * @return NULL once the pool shuts down.
+ */
+static void	*worker_main(void *arg)
+{
+	t_worker	*worker;
+	t_pool		*pool;
+	uint32_t	seen;
+	uint32_t	gen;
+
+	worker = (t_worker *)arg;
+	pool = worker->pool;
+	seen = 0;
+	while (1)
+	{
+		gen = __atomic_load_n(&pool->generation, __ATOMIC_ACQUIRE);
+		while (gen == seen
+			&& !__atomic_load_n(&pool->shutdown, __ATOMIC_ACQUIRE))
+		{
+			futex_wait(&pool->generation, seen);
+			gen = __atomic_load_n(&pool->generation, __ATOMIC_ACQUIRE);
+		}
+		if (__atomic_load_n(&pool->shutdown, __ATOMIC_ACQUIRE))
+			return (NULL);
+		seen = gen;
+		run_job(worker);
+		if (__atomic_sub_fetch(&pool->running, 1, __ATOMIC_ACQ_REL) == 0)
+			futex_wake(&pool->running, INT_MAX);
+	}
+	return (NULL);
+}
+
+/**
+ * @brief Carves `count` stacks from the arena, each above a guard page.
+ *
+ * Stacks grow down, so an overflow runs into the PROT_NONE page below
+ * the stack and faults instead of corrupting the stack of the previous
+ * worker. A huge page cannot be protected in part: with `--hugepages`
+ * backed by MAP_HUGETLB, there are no guard pages and `pool->guards`
+ * stays NULL.
+ *
+ * @param pool Pointer to the t_pool structure being initialized.
+ * @param arena Arena providing the stacks.
+ * @param count Number of stacks.
+ * @return The first stack; stack `k` is `k` strides above it. NULL if
+ *         the arena is exhausted.
+ */
+static char	*alloc_stacks(t_pool *pool, t_arena *arena, int count)
+{
+	size_t	page;
+	char	*guard;
+	int		k;
+
+	page = sysconf(_SC_PAGESIZE);
+	pool->guards = NULL;
+	guard = arena_alloc(arena, (page + PHILO_STACK_SIZE) * count, page);
+	if (!guard)
+		return (NULL);
+	k = -1;
+	while (++k < count && !arena->hugepages)
+		mprotect(guard + (page + PHILO_STACK_SIZE) * k, page, PROT_NONE);
+	if (!arena->hugepages)
+		pool->guards = guard;
+	return (guard + page);
+}
+
+/**
+ * @brief Whether `addr` lies in one of the pool's guard pages, which
+ *        fault on any access (see `alloc_stacks`).
+ *
+ * @param pool Pointer to the t_pool structure.
+ * @param addr Address in the table arena.
+ * @return 1 if so, 0 otherwise.
+ */
+int	pool_is_guard(t_pool *pool, const void *addr)
+{
+	size_t	page;
+	size_t	off;
+
+	page = sysconf(_SC_PAGESIZE);
+	if (!pool->guards || (const char *)addr < pool->guards)
+		return (0);
+	off = (const char *)addr - pool->guards;
+	return (off < (page + PHILO_STACK_SIZE) * pool->count
+		&& off % (page + PHILO_STACK_SIZE) < page);
+}
+
+/**
+ * @brief Creates `count` parked worker threads with stacks from the arena.
+ *
+ * Workers and their PHILO_STACK_SIZE stacks are carved from the table
+ * arena, with a guard page below each stack (see `alloc_stacks`).
+ * Threads are created once per process; `pool_run` reuses them for
+ * every simulation. If a thread cannot be created, the ones already
+ * running stay recorded in `pool->count` so `pool_destroy` joins them.
+ *
+ * @param pool Pointer to the t_pool structure to initialize.
+ * @param arena Arena providing the worker array and stacks.
+ * @param count Number of worker threads.
+ * @return 0 on success, 1 on allocation or `pthread_create` failure.
+ */
+int	pool_init(t_pool *pool, t_arena *arena, int count)
+{
+	pthread_attr_t	attr;
+	char			*stacks;
+	size_t			stride;
+
+	pool->count = 0;
+	pool->generation = 0;
+	pool->running = 0;
+	pool->shutdown = 0;
+	pool->workers = arena_alloc(arena, sizeof(t_worker) * count, ARENA_LINE);
+	stacks = alloc_stacks(pool, arena, count);
+	stride = sysconf(_SC_PAGESIZE) + PHILO_STACK_SIZE;
+	if (!pool->workers || !stacks)
+		return (printf("Error: Allocation failed for threads.\n"), 1);
+	pthread_attr_init(&attr);
+	while (pool->count < count)
+	{
+		pool->workers[pool->count].pool = pool;
+		memset(&pool->workers[pool->count].cost, 0, sizeof(t_thread_cost));
+		if (pthread_attr_setstack(&attr, stacks + stride * pool->count,
+				PHILO_STACK_SIZE) != 0
+			|| pthread_create(&pool->workers[pool->count].thread, &attr,
+				worker_main, &pool->workers[pool->count]) != 0)
+		{
+			printf("Error: pthread_create failed for thread %d\n",
+				pool->count + 1);
+			pthread_attr_destroy(&attr);
+			return (1);
+		}
+		pool->count++;
+	}
+	pthread_attr_destroy(&attr);
+	return (0);
+}
+
+/**
+ * @brief Starts one round: every worker runs its job once.
+ *
+ * Jobs must be assigned (`job`/`arg` of each worker) before the call.
+ *
+ * @param pool Pointer to an initialized t_pool structure.
+ */
+void	pool_run(t_pool *pool)
+{
+	__atomic_store_n(&pool->running, pool->count, __ATOMIC_RELEASE);
+	__atomic_add_fetch(&pool->generation, 1, __ATOMIC_ACQ_REL);
+	futex_wake(&pool->generation, INT_MAX);
+}
+
+/**
+ * @brief Blocks until every worker finished the current round.
+ *
+ * @param pool Pointer to the t_pool structure.
+ */
+void	pool_wait(t_pool *pool)
+{
+	uint32_t	running;
+
+	running = __atomic_load_n(&pool->running, __ATOMIC_ACQUIRE);
+	while (running != 0)
+	{
+		futex_wait(&pool->running, running);
+		running = __atomic_load_n(&pool->running, __ATOMIC_ACQUIRE);
+	}
+}
+
+/**
+ * @brief Stops and joins every worker thread.
+ *
+ * Must not be called while a round is running. Safe to call on a pool
+ * that was never (or only partially) initialized.
+ *
+ * @param pool Pointer to the t_pool structure.
+ */
+void	pool_destroy(t_pool *pool)
+{
+	int	i;
+
+	__atomic_store_n(&pool->shutdown, 1, __ATOMIC_RELEASE);
+	__atomic_add_fetch(&pool->generation, 1, __ATOMIC_ACQ_REL);
+	futex_wake(&pool->generation, INT_MAX);
+	i = 0;
+	while (i < pool->count)
+	{
+		pthread_join(pool->workers[i].thread, NULL);
+		i++;
+	}
+	pool->count = 0;
+}
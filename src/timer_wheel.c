@@ -0,0 +1,502 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   timer_wheel.c                                      :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: vrads <vrads@student.42.fr>                +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/07/09 09:20:11 by vrads             #+#    #+#             */
+/*   Updated: 2025/07/15 09:58:40 by vrads            ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "philo.h"
+
+/*
+** Shared timer service for --timer=wheel. Instead of every philosopher
+** looping on its own usleep, a philosopher registers its deadline in a
+** hierarchical timing wheel and parks on its own futex (`timer.fired`).
+** One service thread sleeps until the earliest slot is due and wakes
+** every philosopher in it; philosophers whose deadlines share a tick
+** cost the service a single wake-up.
+**
+** Level 0 has one slot per WHEEL_TICK_US tick, level L one slot per
+** 64^L ticks. A slot of level L > 0 is cascaded (re-inserted one level
+** down) when `cur` reaches the start of its range, as in the classic
+** kernel timer wheel. Everything is protected by `wheel->mutex`.
+*/
+
+/**
+ * @brief Links a timer into the slot covering its tick.
+ *
+ * Deadlines already past are put in the current slot; deadlines beyond
+ * the last level are clamped to it and re-inserted by each cascade.
+ *
+ * @param w Pointer to the t_wheel structure.
+ * @param t The timer to insert.
+ */
+static void	wheel_insert(t_wheel *w, t_timer *t)
+{
+	long long	tick;
+	long long	delta;
+	int			level;
+	int			slot;
+
+	tick = t->tick;
+	if (tick < w->cur)
+		tick = w->cur;
+	delta = tick - w->cur;
+	if (delta >= 1LL << (WHEEL_BITS * WHEEL_LEVELS))
+		tick = w->cur + (1LL << (WHEEL_BITS * WHEEL_LEVELS)) - 1;
+	level = 0;
+	while (level < WHEEL_LEVELS - 1
+		&& delta >= 1LL << (WHEEL_BITS * (level + 1)))
+		level++;
+	slot = (tick >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1);
+	t->next = w->slots[level][slot];
+	w->slots[level][slot] = t;
+}
+
+/**
+ * @brief Moves the current slot of `level` one level down.
+ *
+ * @param w Pointer to the t_wheel structure.
+ * @param level The level to cascade (1 or more).
+ * @return Index of the cascaded slot; 0 means the next level is due too.
+ */
+static int	wheel_cascade(t_wheel *w, int level)
+{
+	t_timer	*t;
+	t_timer	*next;
+	int		slot;
+
+	slot = (w->cur >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1);
+	t = w->slots[level][slot];
+	w->slots[level][slot] = NULL;
+	while (t)
+	{
+		next = t->next;
+		wheel_insert(w, t);
+		t = next;
+	}
+	return (slot);
+}
+
+/**
+ * @brief Advances the wheel to `now_tick`, collecting the expired timers.
+ *
+ * An empty wheel jumps straight to `now_tick`.
+ *
+ * @param w Pointer to the t_wheel structure.
+ * @param now_tick The current time in ticks.
+ * @param expired List the expired timers are pushed on.
+ */
+static void	wheel_advance(t_wheel *w, long long now_tick, t_timer **expired)
+{
+	t_timer	*t;
+	int		slot;
+	int		level;
+
+	while (w->cur <= now_tick)
+	{
+		if (w->pending == 0)
+		{
+			w->cur = now_tick + 1;
+			return ;
+		}
+		slot = w->cur & (WHEEL_SLOTS - 1);
+		level = 1;
+		while (slot == 0 && level < WHEEL_LEVELS)
+			slot = wheel_cascade(w, level++);
+		slot = w->cur & (WHEEL_SLOTS - 1);
+		while (w->slots[0][slot])
+		{
+			t = w->slots[0][slot];
+			w->slots[0][slot] = t->next;
+			t->next = *expired;
+			*expired = t;
+			w->pending--;
+		}
+		w->cur++;
+	}
+}
+
+/**
+ * @brief Unlinks every armed timer, whatever its level.
+ *
+ * @param w Pointer to the t_wheel structure.
+ * @return The list of all timers that were armed.
+ */
+static t_timer	*wheel_take_all(t_wheel *w)
+{
+	t_timer	*all;
+	t_timer	*t;
+	int		level;
+	int		slot;
+
+	all = NULL;
+	level = 0;
+	while (level < WHEEL_LEVELS)
+	{
+		slot = 0;
+		while (slot < WHEEL_SLOTS)
+		{
+			while (w->slots[level][slot])
+			{
+				t = w->slots[level][slot];
+				w->slots[level][slot] = t->next;
+				t->next = all;
+				all = t;
+			}
+			slot++;
+		}
+		level++;
+	}
+	w->pending = 0;
+	return (all);
+}
+
+/**
+ * @brief Finds the next tick at which the wheel has work to do.
+ *
+ * That is the first non-empty level-0 slot, or the first cascade of a
+ * non-empty slot of a higher level, whichever comes first. Level 0 only
+ * holds ticks of [cur, cur + WHEEL_SLOTS), but a cascade can fall inside
+ * that range too and bring in an earlier timer, so both are compared.
+ *
+ * @param w Pointer to the t_wheel structure.
+ * @return The tick, or -1 if no timer is armed.
+ */
+static long long	wheel_next_tick(t_wheel *w)
+{
+	long long	best;
+	long long	base;
+	int			level;
+	int			i;
+
+	if (w->pending == 0)
+		return (-1);
+	best = -1;
+	i = 0;
+	while (i < WHEEL_SLOTS && !w->slots[0][(w->cur + i) & (WHEEL_SLOTS - 1)])
+		i++;
+	if (i < WHEEL_SLOTS)
+		best = w->cur + i;
+	level = 1;
+	while (level < WHEEL_LEVELS)
+	{
+		base = (w->cur + (1LL << (WHEEL_BITS * level)) - 1)
+			>> (WHEEL_BITS * level);
+		i = 0;
+		while (i < WHEEL_SLOTS && !w->slots[level][(base + i)
+				& (WHEEL_SLOTS - 1)])
+			i++;
+		if (i < WHEEL_SLOTS && (best < 0
+				|| (base + i) << (WHEEL_BITS * level) < best))
+			best = (base + i) << (WHEEL_BITS * level);
+		level++;
+	}
+	return (best);
+}
+
+/**
+ * @brief Wakes every philosopher of an expired list.
+ *
+ * Timers are fired two at a time with `futex_wake_pair`, so a tick
+ * shared by many philosophers costs half as many syscalls. `next` is
+ * read before `fired` is set: from then on the philosopher may re-arm
+ * its timer. A wake-up landing on a re-armed timer is spurious and
+ * simply re-checked by `wheel_sleep`.
+ *
+ * @param table Pointer to the t_table structure.
+ * @param t The expired list.
+ */
+static void	fire_timers(t_table *table, t_timer *t)
+{
+	t_timer	*next;
+	t_timer	*after;
+
+	while (t)
+	{
+		next = t->next;
+		__atomic_store_n(&t->fired, 1, __ATOMIC_RELEASE);
+		if (next)
+		{
+			after = next->next;
+			futex_wake_pair(&t->fired, &next->fired);
+			t = after;
+		}
+		else
+		{
+			futex_wake(&t->fired, 1);
+			t = NULL;
+		}
+		__atomic_fetch_add(&table->stats.sleep_syscalls, 1,
+			__ATOMIC_RELAXED);
+	}
+}
+
+/**
+ * @brief Initializes the wheel lock and state (`--timer=wheel` only).
+ *
+ * @param table Pointer to the t_table structure.
+ * @return 0 on success, 1 if the mutex cannot be initialized.
+ */
+int	init_timer_wheel(t_table *table)
+{
+	if (table->opts.timer_mode != TIMER_WHEEL)
+		return (0);
+	if (pthread_mutex_init(&table->wheel.mutex, NULL) != 0)
+	{
+		printf("Error: Failed to initialize timer wheel mutex.\n");
+		return (1);
+	}
+	table->wheel.mutex_initialized = 1;
+	reset_timer_wheel(table);
+	return (0);
+}
+
+/**
+ * @brief Empties the wheel before a run. The pool must be idle.
+ *
+ * @param table Pointer to the t_table structure.
+ */
+void	reset_timer_wheel(t_table *table)
+{
+	t_wheel	*w;
+
+	w = &table->wheel;
+	memset(w->slots, 0, sizeof(w->slots));
+	w->cur = get_time_us() / WHEEL_TICK_US;
+	w->next_tick = -1;
+	w->pending = 0;
+	w->stopped = 0;
+	w->sleeping = 0;
+}
+
+/**
+ * @brief Destroys the wheel lock. Safe if it was never initialized.
+ *
+ * @param table Pointer to the t_table structure.
+ */
+void	destroy_timer_wheel(t_table *table)
+{
+	if (table->wheel.mutex_initialized)
+		pthread_mutex_destroy(&table->wheel.mutex);
+	table->wheel.mutex_initialized = 0;
+}
+
+/**
+ * @brief Arms the philosopher's timer and parks until it fires.
+ *
+ * The service is only woken when the new deadline is earlier than the
+ * one it is sleeping until. Returns at once if the run is over.
+ *
+ * @param philo Pointer to the sleeping philosopher.
+ * @param deadline Simulated time to wake up at.
+ */
+static void	wheel_sleep(t_philo *philo, long long deadline)
+{
+	t_wheel	*w;
+	t_timer	*t;
+	int		kick;
+
+	w = &philo->table->wheel;
+	t = &philo->timer;
+	t->tick = (deadline + WHEEL_TICK_US - 1) / WHEEL_TICK_US;
+	__atomic_store_n(&t->fired, 0, __ATOMIC_RELAXED);
+	pthread_mutex_lock(&w->mutex);
+	if (w->stopped)
+	{
+		pthread_mutex_unlock(&w->mutex);
+		return ;
+	}
+	wheel_insert(w, t);
+	w->pending++;
+	kick = w->sleeping && (w->next_tick < 0 || t->tick < w->next_tick);
+	if (kick)
+	{
+		w->sleeping = 0;
+		w->seq++;
+	}
+	pthread_mutex_unlock(&w->mutex);
+	if (kick)
+		futex_wake(&w->seq, 1);
+	while (__atomic_load_n(&t->fired, __ATOMIC_ACQUIRE) == 0)
+	{
+		futex_wait(&t->fired, 0);
+		kick++;
+	}
+	__atomic_fetch_add(&philo->table->stats.sleep_syscalls, kick,
+		__ATOMIC_RELAXED);
+	PHILO_CHAOS_POINT(philo->table);
+}
+
+/**
+ * @brief Sleeps until the philosopher's death deadline, then declares it.
+ *
+ * `--detect=self` only, for a phase that would end after the deadline.
+ * The phase is waited out as usual until two wheel ticks before the
+ * deadline, so the end of the run still interrupts it; the rest is one
+ * absolute `clock_nanosleep`, which does not round up to a tick.
+ * Nothing is declared if the run ended meanwhile.
+ *
+ * @param philo Pointer to the t_philo structure.
+ * @param death The deadline, in simulated microseconds.
+ * @return -1 (the run is over).
+ */
+static long long	wait_for_death(t_philo *philo, long long death)
+{
+	struct timespec	abs;
+	long long		coarse_end;
+	long long		real_us;
+
+	coarse_end = death - 2 * WHEEL_TICK_US;
+	if (coarse_end > get_time_us())
+	{
+		if (philo->table->opts.timer_mode == TIMER_WHEEL)
+			wheel_sleep(philo, coarse_end);
+		else
+			precise_usleep(coarse_end - get_time_us(), philo->table);
+	}
+	if (!is_simulation_over(philo->table))
+	{
+		real_us = real_time_at(death);
+		abs.tv_sec = real_us / 1000000;
+		abs.tv_nsec = real_us % 1000000 * 1000;
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &abs, NULL)
+			== EINTR)
+			;
+	}
+	declare_death(philo, get_time_us() - death);
+	return (-1);
+}
+
+/**
+ * @brief Waits out an eat, sleep or think phase of `time_us`.
+ *
+ * Uses the timer service with `--timer=wheel` (the default) and
+ * `precise_usleep` with `--timer=sleep`. How late the philosopher woke
+ * up is recorded for `--stats`. With `--detect=self`, a phase that would
+ * outlast the philosopher's death deadline ends there, with its death.
+ * Every call, even of zero length, ends with a `--record` entry; with
+ * `--replay` the phase ends when that entry comes up (`replay_sleep`).
+ *
+ * @param philo Pointer to the t_philo structure.
+ * @param time_us Duration in simulated microseconds.
+ * @return How late the philosopher woke up, in simulated microseconds,
+ *         or -1 if the run ended meanwhile.
+ */
+long long	philo_sleep(t_philo *philo, long long time_us)
+{
+	long long	deadline;
+	long long	death;
+	long long	late;
+
+	if (philo->table->replay.replaying)
+		return (replay_sleep(philo, time_us));
+	if (time_us <= 0)
+	{
+		replay_record(philo->table, philo->id, REPLAY_WAKE);
+		return (0);
+	}
+	deadline = get_time_us() + time_us;
+	if (philo->table->opts.detect_mode == DETECT_SELF)
+	{
+		death = death_deadline(philo);
+		if (death < deadline)
+			return (wait_for_death(philo, death));
+	}
+	if (philo->table->opts.timer_mode == TIMER_WHEEL)
+		wheel_sleep(philo, deadline);
+	else
+		precise_usleep(time_us, philo->table);
+	late = get_time_us() - deadline;
+	replay_record(philo->table, philo->id, REPLAY_WAKE);
+	if (late < 0 || is_simulation_over(philo->table))
+		return (-1);
+	philo->sleeps++;
+	philo->sleep_late_us += late;
+	if (late > philo->sleep_late_max_us)
+		philo->sleep_late_max_us = late;
+	return (late);
+}
+
+/**
+ * @brief Ends the timer service for this run and releases every sleeper.
+ *
+ * Called once the end flag is set; philosophers arming a timer after
+ * this return immediately.
+ *
+ * @param table Pointer to the t_table structure.
+ */
+void	timer_stop(t_table *table)
+{
+	t_wheel	*w;
+
+	if (table->opts.timer_mode != TIMER_WHEEL)
+		return ;
+	w = &table->wheel;
+	pthread_mutex_lock(&w->mutex);
+	w->stopped = 1;
+	w->seq++;
+	pthread_mutex_unlock(&w->mutex);
+	futex_wake(&w->seq, 1);
+}
+
+/**
+ * @brief The timer service thread (one pool worker per run).
+ *
+ * Expires due slots and wakes their philosophers outside the lock, then
+ * sleeps on `seq` until the next tick with work, or until a philosopher
+ * arms an earlier deadline. Its timer slack is lowered to 1 ns so the
+ * kernel does not defer its wake-ups. On `timer_stop` every remaining
+ * timer fires.
+ *
+ * @param arg Pointer to the t_table structure, passed as `void*`.
+ * @return NULL when the run is over.
+ */
+void	*timer_routine(void *arg)
+{
+	t_table		*table;
+	t_wheel		*w;
+	t_timer		*expired;
+	uint32_t	seq;
+	long long	wait_us;
+
+	table = (t_table *)arg;
+	w = &table->wheel;
+	prctl(PR_SET_TIMERSLACK, 1UL, 0, 0, 0);
+	pthread_mutex_lock(&w->mutex);
+	while (!w->stopped)
+	{
+		expired = NULL;
+		wheel_advance(w, get_time_us() / WHEEL_TICK_US, &expired);
+		if (expired)
+		{
+			pthread_mutex_unlock(&w->mutex);
+			fire_timers(table, expired);
+			pthread_mutex_lock(&w->mutex);
+			continue ;
+		}
+		w->next_tick = wheel_next_tick(w);
+		wait_us = -1;
+		if (w->next_tick >= 0)
+			wait_us = sim_to_real_us(w->next_tick * WHEEL_TICK_US
+					- get_time_us());
+		if (w->next_tick >= 0 && wait_us <= 0)
+			continue ;
+		w->sleeping = 1;
+		seq = w->seq;
+		pthread_mutex_unlock(&w->mutex);
+		futex_wait_us(&w->seq, seq, wait_us);
+		__atomic_fetch_add(&table->stats.sleep_syscalls, 1, __ATOMIC_RELAXED);
+		pthread_mutex_lock(&w->mutex);
+		w->sleeping = 0;
+		w->wakeups++;
+	}
+	expired = wheel_take_all(w);
+	pthread_mutex_unlock(&w->mutex);
+	fire_timers(table, expired);
+	return (NULL);
+}
@@ -0,0 +1,162 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   trace_compress.c                                   :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: vrads <vrads@student.42.fr>                +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/07/08 11:15:47 by vrads             #+#    #+#             */
+/*   Updated: 2025/07/08 16:12:40 by vrads            ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "philo.h"
+
+/*
+** --compress: the output is a sequence of independently decodable frames
+**   t_frame_header   magic "PHZ1", raw/compressed sizes, checksum and the
+**                    timestamps of the first and last line
+**   payload          one lz_compress block of whole lines
+** Frames are built on the log writer thread (see log_policy.c), never by
+** a philosopher. Because each frame carries its time range and length, a
+** reader can skip to any point of a long trace without decoding what
+** comes before: `make decoder` builds tools/trace_decode.
+*/
+
+/**
+ * @brief Carves the raw and compressed frame buffers from the arena.
+ *
+ * @param table Pointer to the t_table structure (arena mapped).
+ * @return 0 on success (or without `--compress`), 1 if the arena is
+ *         exhausted.
+ */
+int	compress_init(t_table *table)
+{
+	t_compressor	*z;
+
+	z = &table->zip;
+	z->enabled = table->opts.compress;
+	if (!z->enabled)
+		return (0);
+	z->raw = arena_alloc(&table->arena, TRACE_FRAME_RAW, ARENA_LINE);
+	z->out = arena_alloc(&table->arena, LZ_BOUND(TRACE_FRAME_RAW),
+			ARENA_LINE);
+	if (!z->raw || !z->out)
+	{
+		printf("Error: Allocation failed for trace compression.\n");
+		return (1);
+	}
+	return (0);
+}
+
+/**
+ * @brief Parses the timestamp at the start of the line containing `end - 1`.
+ *
+ * @param raw Start of the frame text.
+ * @param end End of the line (just past its newline).
+ * @return The line's timestamp in ms.
+ */
+static long long	line_time(const char *raw, size_t end)
+{
+	size_t	start;
+
+	start = end - 1;
+	while (start > 0 && raw[start - 1] != '\n')
+		start--;
+	return (atoll(raw + start));
+}
+
+/**
+ * @brief Thread CPU time in nanoseconds.
+ *
+ * @return CPU time consumed by the calling thread.
+ */
+static long long	thread_cpu_ns(void)
+{
+	struct timespec	ts;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return (ts.tv_sec * 1000000000LL + ts.tv_nsec);
+}
+
+/**
+ * @brief Compresses the first `len` bytes of the frame buffer and writes
+ *        the frame to the sink; the remaining bytes move to the front.
+ *
+ * @param table Pointer to the t_table structure.
+ * @param len Bytes to put in the frame (ends on a line boundary).
+ */
+static void	emit_frame(t_table *table, size_t len)
+{
+	t_compressor	*z;
+	t_frame_header	hdr;
+	long long		cpu;
+
+	z = &table->zip;
+	memcpy(hdr.magic, TRACE_FRAME_MAGIC, 4);
+	hdr.raw_len = len;
+	hdr.checksum = lz_checksum((unsigned char *)z->raw, len);
+	hdr.first_ms = atoll(z->raw);
+	hdr.last_ms = line_time(z->raw, len);
+	cpu = thread_cpu_ns();
+	hdr.comp_len = lz_compress((unsigned char *)z->raw, len,
+			(unsigned char *)z->out);
+	z->cpu_ns += thread_cpu_ns() - cpu;
+	sink_write(&table->sink, (char *)&hdr, sizeof(hdr));
+	sink_write(&table->sink, z->out, hdr.comp_len);
+	z->frames++;
+	z->raw_bytes += len;
+	z->comp_bytes += sizeof(hdr) + hdr.comp_len;
+	memmove(z->raw, z->raw + len, z->raw_len - len);
+	z->raw_len -= len;
+}
+
+/**
+ * @brief Adds output text; a frame is emitted each time the buffer fills.
+ *
+ * A full buffer is cut after its last complete line; the partial line
+ * starts the next frame.
+ *
+ * @param table Pointer to the t_table structure.
+ * @param data Text to add (lines, possibly split anywhere).
+ * @param len Number of bytes.
+ */
+void	compress_append(t_table *table, const char *data, size_t len)
+{
+	t_compressor	*z;
+	size_t			n;
+	size_t			cut;
+
+	z = &table->zip;
+	while (len > 0)
+	{
+		n = TRACE_FRAME_RAW - z->raw_len;
+		if (n > len)
+			n = len;
+		memcpy(z->raw + z->raw_len, data, n);
+		z->raw_len += n;
+		data += n;
+		len -= n;
+		if (z->raw_len < TRACE_FRAME_RAW)
+			continue ;
+		cut = z->raw_len;
+		while (cut > 0 && z->raw[cut - 1] != '\n')
+			cut--;
+		if (cut == 0)
+			cut = z->raw_len;
+		emit_frame(table, cut);
+	}
+}
+
+/**
+ * @brief Emits whatever is buffered as a last, shorter frame.
+ *
+ * Called at the end of each run once the log writer is idle.
+ *
+ * @param table Pointer to the t_table structure.
+ */
+void	compress_flush(t_table *table)
+{
+	if (table->zip.enabled && table->zip.raw_len > 0)
+		emit_frame(table, table->zip.raw_len);
+}
@@ -6,71 +6,91 @@
 /*   By: vrads <vrads@student.42.fr>                +#+  +:+       +#+        */
 /*                                                +#+#+#+#+#+   +#+           */
 /*   Created: 2025/06/17 16:07:10 by vrads             #+#    #+#             */
-/*   Updated: 2025/06/17 16:07:16 by vrads            ###   ########.fr       */
+/*   Updated: 2025/07/15 14:07:39 by vrads            ###   ########.fr       */
 /*                                                                            */
 /* ************************************************************************** */
 
 #include "philo.h"
 
 /**
- * @brief Gets the current time in milliseconds.
+ * @brief Prints a record of one or more status lines of a philosopher.
  *
- * Uses `gettimeofday` to retrieve the current time and converts it
- * to milliseconds.
+ * The lines are formatted with their own timestamps into one buffer and
+ * handed to `log_record` in a single call, which applies the `--log`
+ * policy and writes to the output sink (`--sink`). A record costs the
+ * same locks as one line: the end-of-simulation check, then
+ * `print_mutex`. Nothing is printed once the simulation has ended, unless
+ * `override_sim_end` is set (death messages). The first line of each
+ * run also records the restart-to-first-event latency for `--stats`. A
+ * `--procs` child sends the record to the coordinator instead
+ * (`proc_print`). With `--record` the lines are logged as written; with
+ * `--replay` each waits for its turn in the log and shows its recorded
+ * time (replay.c).
  *
- * @return The current time in milliseconds since the Epoch.
- */
-long long	get_time_ms(void)
-{
-	struct timeval	tv;
-
-	gettimeofday(&tv, NULL);
-	return ((tv.tv_sec * 1000) + (tv.tv_usec / 1000));
-}
-
-/**
- * @brief Converts a string to an integer.
- *
- * Parses a string representation of an integer and returns its `int` value.
- * Handles leading whitespace and optional sign (+ or -). Stops parsing
- * at the first non-digit character.
+ * Timestamps are simulated milliseconds since the start, or wall-clock
+ * milliseconds when `--real-timestamps` is set.
  *
- * @param str The string to convert.
- * @return The integer value represented by the string.
+ * @param philo Pointer to the t_philo structure of the philosopher.
+ * @param events Lines to print, in order (at most EVENT_BATCH_MAX).
+ * @param count Number of lines.
+ * @param override_sim_end If non-zero, print even if simulation_should_end
+ *                         is set.
  */
-int	ft_atoi(const char *str)
+void	print_events(t_philo *philo, const t_event *events, int count,
+		int override_sim_end)
 {
-	int	i;
-	int	sign;
-	int	result;
+	char		buf[EVENT_BATCH_MAX * 64];
+	int			ends[EVENT_BATCH_MAX];
+	t_event		timed[EVENT_BATCH_MAX];
+	long long	time_ms;
+	int			len;
+	int			i;
 
+	if (!override_sim_end && is_simulation_over(philo->table))
+		return ;
+	if (philo->table->replay.replaying && !override_sim_end)
+	{
+		if (replay_take_lines(philo, events, timed, count) != 0)
+			return ;
+		events = timed;
+	}
+	len = 0;
 	i = 0;
-	sign = 1;
-	result = 0;
-	while (str[i] == ' ' || (str[i] >= '\t' && str[i] <= '\r'))
-		i++;
-	if (str[i] == '-' || str[i] == '+')
+	while (i < count)
 	{
-		if (str[i] == '-')
-			sign = -1;
+		time_ms = events[i].time_us - philo->table->start_time;
+		if (philo->table->opts.real_timestamps)
+			time_ms = sim_to_real_us(time_ms);
+		len += snprintf(buf + len, sizeof(buf) - len, "%lld %d %s\n",
+				time_ms / 1000, philo->id, events[i].status);
+		ends[i] = len;
 		i++;
 	}
-	while (str[i] >= '0' && str[i] <= '9')
+	if (philo->table->procs.coord_fd >= 0)
 	{
-		result = result * 10 + (str[i] - '0');
-		i++;
+		proc_print(philo->table, events, buf, ends, count, override_sim_end);
+		return ;
 	}
-	return (result * sign);
+	pthread_mutex_lock(&philo->table->print_mutex);
+	if ((!is_simulation_over(philo->table) || override_sim_end)
+		&& log_record(philo->table, events, buf, ends, count,
+			override_sim_end) == 0)
+	{
+		if (!override_sim_end)
+			replay_record_lines(philo->table, philo->id, events, count);
+		if (!philo->table->stats.first_event_us)
+			philo->table->stats.first_event_us = real_time_us()
+				- philo->table->stats.run_begin_us;
+	}
+	pthread_mutex_unlock(&philo->table->print_mutex);
 }
 
 /**
  * @brief Prints a philosopher's status message.
  *
  * Prints a timestamped status message for a philosopher, such as
- * "is eating", "is sleeping", "is thinking", "has taken a fork", or "died".
- * Message printing is synchronized using `table->print_mutex`.
- * The function first checks if the simulation should end (unless overridden)
- * before attempting to print.
+ * "is eating", "is sleeping", "is thinking", "has taken a fork", or "died",
+ * as a record of one line (see `print_events`).
  *
  * @param philo Pointer to the t_philo structure of the philosopher.
  * @param status The status message string to print.
@@ -79,23 +99,11 @@ int	ft_atoi(const char *str)
  */
 void	print_status(t_philo *philo, const char *status, int override_sim_end)
 {
-	long long	time_ms;
-
-	pthread_mutex_lock(&philo->table->sim_end_mutex);
-	if (philo->table->simulation_should_end && !override_sim_end)
-	{
-		pthread_mutex_unlock(&philo->table->sim_end_mutex);
-		return ;
-	}
-	pthread_mutex_unlock(&philo->table->sim_end_mutex);
+	t_event	event;
 
-	time_ms = get_time_ms() - philo->table->start_time;
-	pthread_mutex_lock(&philo->table->print_mutex);
-	if (!is_simulation_over(philo->table) || override_sim_end)
-	{
-		printf("%lld %d %s\n", time_ms, philo->id, status);
-	}
-	pthread_mutex_unlock(&philo->table->print_mutex);
+	event.time_us = get_time_us();
+	event.status = status;
+	print_events(philo, &event, 1, override_sim_end);
 }
 
 /**
@@ -120,30 +128,62 @@ int	is_simulation_over(t_table *table)
 /**
  * @brief Provides a more precise microsecond sleep, checking for simulation end.
  *
- * Sleeps for the specified duration in milliseconds (`time_ms`).
- * It converts the duration to microseconds and sleeps in smaller intervals
- * (or the full remaining time if small enough) to allow for more frequent
- * checks of the `is_simulation_over` flag. This helps in making the
- * simulation more responsive to termination conditions.
+ * Sleeps for the specified simulated duration in microseconds (`time_us`).
+ * It sleeps in smaller intervals (or the full remaining time if small
+ * enough) to allow for more frequent checks of the `is_simulation_over`
+ * flag. This helps in making the simulation more responsive to termination
+ * conditions. The remaining simulated time is converted to wall-clock time
+ * with `sim_to_real_us` before each `usleep`, which never exceeds one
+ * second (`useconds_t` is 32 bits wide). Used by `--timer=sleep`;
+ * every `usleep` is counted for `--stats`.
  *
- * @param time_ms The time to sleep in milliseconds.
+ * @param time_us The time to sleep in simulated microseconds.
  * @param table Pointer to the t_table structure, used for `is_simulation_over` check.
  */
-void	precise_usleep(long long time_ms, t_table *table)
+void	precise_usleep(long long time_us, t_table *table)
 {
 	long long	start;
 	long long	elapsed;
 	long long	remaining;
 
-	start = get_time_ms();
-	remaining = time_ms * 1000;
+	start = get_time_us();
+	remaining = time_us;
 	while (remaining > 0 && !is_simulation_over(table))
 	{
-		elapsed = get_time_ms() - start;
-		remaining = (time_ms * 1000) - (elapsed * 1000);
-		if (remaining > 100000)
+		elapsed = get_time_us() - start;
+		remaining = sim_to_real_us(time_us - elapsed);
+		if (remaining > 2000000)
+			usleep(1000000);
+		else if (remaining > 100000)
 			usleep(remaining / 2);
 		else if (remaining > 0)
 			usleep(remaining);
+		else
+			break ;
+		__atomic_fetch_add(&table->stats.sleep_syscalls, 1, __ATOMIC_RELAXED);
+		PHILO_CHAOS_POINT(table);
+	}
+}
+
+/**
+ * @brief Writes `len` bytes to `fd`, retrying on short writes.
+ *
+ * @param fd Destination file descriptor.
+ * @param buf Bytes to write.
+ * @param len Number of bytes.
+ * @return 0 on success, 1 on error.
+ */
+int	write_all(int fd, const void *buf, size_t len)
+{
+	ssize_t	n;
+
+	while (len > 0)
+	{
+		n = write(fd, buf, len);
+		if (n <= 0)
+			return (1);
+		buf = (const char *)buf + n;
+		len -= n;
 	}
+	return (0);
 }
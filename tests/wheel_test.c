@@ -0,0 +1,133 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   wheel_test.c                                       :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: vrads <vrads@student.42.fr>                +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/07/15 10:02:17 by vrads             #+#    #+#             */
+/*   Updated: 2025/07/15 10:02:17 by vrads            ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+/*
+** make test-wheel: drives the timing wheel's static helpers directly, in
+** ticks, without any thread or clock. Each case arms timers at given
+** ticks, then repeatedly jumps to `wheel_next_tick` as the service
+** thread does, and checks every timer expires exactly on its tick.
+*/
+
+#include "../src/timer_wheel.c"
+
+void	print_usage(void)
+{
+}
+
+/**
+ * @brief Arms a timer for `tick` at the wheel's current position.
+ */
+static void	arm(t_wheel *w, t_timer *t, long long tick)
+{
+	t->tick = tick;
+	wheel_insert(w, t);
+	w->pending++;
+}
+
+/**
+ * @brief Runs the wheel as `timer_routine` would until it is empty.
+ *
+ * @return The number of timers that expired on another tick than theirs.
+ */
+static int	run_wheel(const char *name, t_wheel *w)
+{
+	t_timer		*expired;
+	long long	next;
+	int			errors;
+
+	errors = 0;
+	while (w->pending)
+	{
+		next = wheel_next_tick(w);
+		expired = NULL;
+		wheel_advance(w, next, &expired);
+		while (expired)
+		{
+			if (expired->tick != next)
+			{
+				printf("%s: timer %lld expired at %lld\n", name,
+					expired->tick, next);
+				errors++;
+			}
+			expired = expired->next;
+		}
+	}
+	return (errors);
+}
+
+/**
+ * @brief A level-1 timer armed before a later level-0 one.
+ *
+ * At cur 60, tick 130 goes to level 1. At cur 100, tick 160 goes to
+ * level 0. The cascade at 128 must not be hidden by the level-0 slot.
+ */
+static int	test_mixed_levels(void)
+{
+	t_wheel		w;
+	t_timer		timers[2];
+	t_timer		*expired;
+
+	memset(&w, 0, sizeof(w));
+	w.cur = 60;
+	arm(&w, &timers[0], 130);
+	expired = NULL;
+	wheel_advance(&w, 99, &expired);
+	arm(&w, &timers[1], 160);
+	if (wheel_next_tick(&w) != 128)
+	{
+		printf("mixed_levels: next tick %lld, expected 128\n",
+			wheel_next_tick(&w));
+		return (1 + run_wheel("mixed_levels", &w));
+	}
+	return (run_wheel("mixed_levels", &w));
+}
+
+/**
+ * @brief Timers spread over every level, armed from an unaligned tick.
+ */
+static int	test_spread(void)
+{
+	static t_timer	timers[64];
+	t_wheel			w;
+	long long		tick;
+	int				span;
+	int				i;
+
+	memset(&w, 0, sizeof(w));
+	w.cur = 1000003;
+	tick = w.cur;
+	i = 0;
+	while (i < 64)
+	{
+		span = 9001;
+		if (i < 32)
+			span = 97;
+		tick += 1 + (i * 7919) % span;
+		arm(&w, &timers[i++], tick);
+	}
+	return (run_wheel("spread", &w));
+}
+
+int	main(void)
+{
+	int	errors;
+
+	errors = test_mixed_levels();
+	errors += test_spread();
+	if (errors)
+	{
+		printf("wheel_test: %d failure(s)\n", errors);
+		return (1);
+	}
+	printf("wheel_test: OK\n");
+	return (0);
+}
@@ -0,0 +1,186 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   chaos_load.c                                       :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: vrads <vrads@student.42.fr>                +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/07/12 11:02:09 by vrads             #+#    #+#             */
+/*   Updated: 2025/07/12 11:40:22 by vrads            ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "philo.h"
+#include <sys/wait.h>
+
+/*
+** Background load for bench/chaos_harness.sh: CPU hogs and memory
+** pressure on the host while philo runs.
+**
+**   make chaos
+**   tools/chaos_load --cpu=4 --mem=256 --time=30s &
+**
+** --cpu=N forks N children that spin (one per CPU to contend for every
+** core, more to oversubscribe them). --mem=MB maps MB of anonymous
+** memory and keeps faulting it in and dropping it again (MADV_DONTNEED),
+** which churns the page allocator and the LRU the way a neighbour under
+** memory pressure does. Runs until --time expires or SIGTERM/SIGINT.
+*/
+
+typedef struct s_load_opts
+{
+	long long	cpu;
+	long long	mem_mb;
+	long long	time_us;
+}	t_load_opts;
+
+static volatile sig_atomic_t	g_stop;
+
+static long long	now_us(void)
+{
+	struct timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ts.tv_sec * 1000000LL + ts.tv_nsec / 1000);
+}
+
+static void	on_stop(int sig)
+{
+	(void)sig;
+	g_stop = 1;
+}
+
+/**
+ * @brief Spins until killed by the parent.
+ */
+static void	spin(void)
+{
+	volatile unsigned long	x;
+
+	x = 0;
+	while (1)
+		x++;
+}
+
+/**
+ * @brief Touches every page of `mem`, then gives them back, once.
+ *
+ * @param mem The mapping.
+ * @param len Its length.
+ * @param page The page size.
+ * @return The number of pages touched.
+ */
+static long long	churn(char *mem, size_t len, size_t page)
+{
+	size_t	off;
+
+	off = 0;
+	while (off < len && !g_stop)
+	{
+		mem[off] = (char)off;
+		off += page;
+	}
+	madvise(mem, len, MADV_DONTNEED);
+	return (off / page);
+}
+
+/**
+ * @brief Applies the memory pressure until stopped or `end_us`.
+ *
+ * Without --mem the parent only waits.
+ *
+ * @param o The options.
+ * @param end_us When to stop (LLONG_MAX: on a signal only).
+ * @return 0 on success, 1 if the memory cannot be mapped.
+ */
+static int	pressure(t_load_opts *o, long long end_us)
+{
+	char		*mem;
+	size_t		len;
+	long long	pages;
+
+	mem = NULL;
+	len = (size_t)o->mem_mb << 20;
+	if (len)
+		mem = mmap(NULL, len, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (mem == MAP_FAILED)
+	{
+		perror("chaos_load: mmap");
+		return (1);
+	}
+	pages = 0;
+	while (!g_stop && now_us() < end_us)
+	{
+		if (mem)
+			pages += churn(mem, len, sysconf(_SC_PAGESIZE));
+		else
+			usleep(10000);
+	}
+	if (mem)
+		munmap(mem, len);
+	fprintf(stderr, "chaos_load: cpu=%lld mem_mb=%lld pages_touched=%lld\n",
+		o->cpu, o->mem_mb, pages);
+	return (0);
+}
+
+static int	parse_load_opts(int argc, char **argv, t_load_opts *o)
+{
+	int	i;
+	int	bad;
+
+	o->cpu = 0;
+	o->mem_mb = 0;
+	o->time_us = 0;
+	i = 1;
+	bad = 0;
+	while (i < argc && !bad)
+	{
+		if (strncmp(argv[i], "--cpu=", 6) == 0)
+			bad = parse_count(argv[i] + 6, 1024, &o->cpu);
+		else if (strncmp(argv[i], "--mem=", 6) == 0)
+			bad = parse_count(argv[i] + 6, 1 << 20, &o->mem_mb);
+		else if (strncmp(argv[i], "--time=", 7) == 0)
+			bad = parse_duration(argv[i] + 7, &o->time_us);
+		else
+			bad = 1;
+		i++;
+	}
+	return (bad);
+}
+
+int	main(int argc, char **argv)
+{
+	t_load_opts	o;
+	pid_t		*kids;
+	long long	i;
+	int			status;
+
+	if (parse_load_opts(argc, argv, &o) != 0)
+	{
+		fprintf(stderr, "Usage: chaos_load [--cpu=N] [--mem=MB]"
+			" [--time=DURATION]\n");
+		return (2);
+	}
+	signal(SIGTERM, on_stop);
+	signal(SIGINT, on_stop);
+	kids = calloc(o.cpu + 1, sizeof(*kids));
+	if (!kids)
+		return (1);
+	i = 0;
+	while (i < o.cpu)
+	{
+		kids[i] = fork();
+		if (kids[i] == 0)
+			spin();
+		i++;
+	}
+	status = pressure(&o, o.time_us ? now_us() + o.time_us : LLONG_MAX);
+	while (i-- > 0)
+		if (kids[i] > 0)
+			kill(kids[i], SIGKILL);
+	while (wait(NULL) > 0)
+		;
+	free(kids);
+	return (status);
+}
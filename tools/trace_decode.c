@@ -0,0 +1,201 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   trace_decode.c                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: vrads <vrads@student.42.fr>                +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/07/08 14:02:26 by vrads             #+#    #+#             */
+/*   Updated: 2025/07/08 16:12:40 by vrads            ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "philo.h"
+
+/*
+** Expands a `./philo --compress` trace back to the usual status lines.
+**
+**   make decoder
+**   ./philo --compress 200 410 200 200 > run.phz
+**   tools/trace_decode run.phz | less
+**   tools/trace_decode --from=60000 --to=61000 run.phz
+**   tools/trace_decode --index run.phz
+**
+** Frames entirely outside [--from, --to] are skipped without being
+** decompressed (seeked over when reading a file), so a window of a long
+** trace is cheap to extract. --index lists the frames instead.
+*/
+
+typedef struct s_decode_opts
+{
+	long long	from;
+	long long	to;
+	int			index;
+}	t_decode_opts;
+
+/**
+ * @brief Prints the lines of a frame whose timestamp is in the window.
+ *
+ * @param text Decompressed frame text.
+ * @param len Its length.
+ * @param o Decoder options.
+ */
+static void	print_window(const char *text, size_t len, t_decode_opts *o)
+{
+	size_t		start;
+	size_t		end;
+	long long	ms;
+
+	start = 0;
+	while (start < len)
+	{
+		end = start;
+		while (end < len && text[end] != '\n')
+			end++;
+		ms = atoll(text + start);
+		if (ms >= o->from && ms <= o->to)
+			fwrite(text + start, 1, end - start + (end < len), stdout);
+		start = end + 1;
+	}
+}
+
+/**
+ * @brief Skips `n` payload bytes, seeking when the input allows it.
+ *
+ * @return 0 on success, 1 if the input ended.
+ */
+static int	skip_payload(FILE *in, size_t n)
+{
+	char	buf[4096];
+	size_t	chunk;
+
+	if (fseek(in, n, SEEK_CUR) == 0)
+		return (0);
+	while (n > 0)
+	{
+		chunk = n < sizeof(buf) ? n : sizeof(buf);
+		if (fread(buf, 1, chunk, in) != chunk)
+			return (1);
+		n -= chunk;
+	}
+	return (0);
+}
+
+/**
+ * @brief Reads, checks and prints one frame.
+ *
+ * @param in Input stream positioned on a payload.
+ * @param h The frame header just read.
+ * @param o Decoder options.
+ * @return 0 on success, 1 if the frame is damaged.
+ */
+static int	decode_frame(FILE *in, t_frame_header *h, t_decode_opts *o)
+{
+	static unsigned char	comp[LZ_BOUND(TRACE_FRAME_RAW)];
+	static unsigned char	text[TRACE_FRAME_RAW];
+
+	if (o->index)
+		printf("frame %lld-%lld ms raw=%u comp=%u\n", (long long)h->first_ms,
+			(long long)h->last_ms, h->raw_len, h->comp_len);
+	if (o->index || h->last_ms < o->from || h->first_ms > o->to)
+		return (skip_payload(in, h->comp_len));
+	if (h->comp_len > sizeof(comp) || h->raw_len > sizeof(text)
+		|| fread(comp, 1, h->comp_len, in) != h->comp_len
+		|| lz_decompress(comp, h->comp_len, text, sizeof(text))
+		!= (long)h->raw_len
+		|| lz_checksum(text, h->raw_len) != h->checksum)
+		return (1);
+	print_window((char *)text, h->raw_len, o);
+	return (0);
+}
+
+/**
+ * @brief Decodes every frame of `in`.
+ *
+ * @param in Input stream.
+ * @param name Input name for error messages.
+ * @param o Decoder options.
+ * @return 0 on success, 1 on a damaged or truncated trace.
+ */
+static int	decode_stream(FILE *in, const char *name, t_decode_opts *o)
+{
+	t_frame_header	h;
+	long long		frame;
+	size_t			got;
+
+	frame = 0;
+	while (1)
+	{
+		got = fread(&h, 1, sizeof(h), in);
+		if (got == 0)
+			return (0);
+		if (got != sizeof(h) || memcmp(h.magic, TRACE_FRAME_MAGIC, 4) != 0
+			|| decode_frame(in, &h, o) != 0)
+		{
+			fprintf(stderr, "trace_decode: %s: frame %lld is damaged\n",
+				name, frame);
+			return (1);
+		}
+		frame++;
+	}
+}
+
+/**
+ * @brief Parses `--from=MS`, `--to=MS` and `--index`.
+ *
+ * @return Index of the first file argument, or -1 on a bad option.
+ */
+static int	parse_decode_opts(int argc, char **argv, t_decode_opts *o)
+{
+	int	i;
+
+	o->from = LLONG_MIN;
+	o->to = LLONG_MAX;
+	o->index = 0;
+	i = 1;
+	while (i < argc && strncmp(argv[i], "--", 2) == 0)
+	{
+		if (strncmp(argv[i], "--from=", 7) == 0)
+			o->from = atoll(argv[i] + 7);
+		else if (strncmp(argv[i], "--to=", 5) == 0)
+			o->to = atoll(argv[i] + 5);
+		else if (strcmp(argv[i], "--index") == 0)
+			o->index = 1;
+		else
+			return (-1);
+		i++;
+	}
+	return (i);
+}
+
+int	main(int argc, char **argv)
+{
+	t_decode_opts	o;
+	FILE			*in;
+	int				i;
+	int				status;
+
+	i = parse_decode_opts(argc, argv, &o);
+	if (i < 0)
+	{
+		fprintf(stderr, "Usage: trace_decode [--from=MS] [--to=MS] [--index]"
+			" [FILE...]\n");
+		return (2);
+	}
+	if (i == argc)
+		return (decode_stream(stdin, "stdin", &o));
+	status = 0;
+	while (i < argc)
+	{
+		in = fopen(argv[i], "rb");
+		if (!in)
+		{
+			fprintf(stderr, "trace_decode: cannot open %s\n", argv[i]);
+			return (1);
+		}
+		status |= decode_stream(in, argv[i], &o);
+		fclose(in);
+		i++;
+	}
+	return (status);
+}
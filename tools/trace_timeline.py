@@ -0,0 +1,171 @@
+#!/usr/bin/env python3
+"""Turn a philo USDT trace into per-philosopher timelines.
+
+Record with a TRACE=1 build (see inc/philo_trace.h), then:
+
+    perf script | tools/trace_timeline.py --die 800 > philo.folded
+    flamegraph.pl --countname=us philo.folded > philo.svg
+
+Output on stdout is in folded-stack format ("frame;frame weight"), one
+stack per philosopher and phase, weighted in microseconds:
+
+    philo_3;wait_fork;hunger 50-90% of die 18342
+    philo_3;eat 400120
+
+Fork waits are bucketed by how much of time_to_die had elapsed since the
+philosopher's previous meal when the wait ended, so waits that pushed a
+philosopher close to (or past) its deadline stand out in the flamegraph.
+A per-philosopher summary (meals, worst wait, worst gap between meals and
+the resulting minimum slack) is printed on stderr. --svg writes a plain
+timeline chart as well, with late meals marked in red.
+"""
+
+import argparse
+import re
+import sys
+from collections import defaultdict
+
+EVENT_RE = re.compile(
+    r"\s(\d+\.\d+):\s+(?:sdt_|probe_)?philo:(\w+):.*?arg1=(-?\d+)"
+    r"(?:\s+arg2=(-?\d+))?")
+
+PHASE_START = {"eat_start": "eat", "sleep_start": "sleep",
+               "think_start": "think"}
+PHASE_END = {"eat_end": "eat", "sleep_end": "sleep", "think_end": "think"}
+COLORS = {"wait_fork": "#e8a33d", "eat": "#4caf50", "sleep": "#5c8bd6",
+          "think": "#b0b0b0"}
+
+
+def hunger_bucket(fraction):
+    if fraction > 1.0:
+        return "hunger >100% of die (late)"
+    if fraction > 0.9:
+        return "hunger 90-100% of die"
+    if fraction > 0.5:
+        return "hunger 50-90% of die"
+    return "hunger <50% of die"
+
+
+def parse(stream):
+    """Yield (time_us, probe, arg1, arg2) for every philo probe hit."""
+    for line in stream:
+        m = EVENT_RE.search(line)
+        if not m:
+            continue
+        arg2 = int(m.group(4)) if m.group(4) is not None else None
+        yield (float(m.group(1)) * 1e6, m.group(2), int(m.group(3)), arg2)
+
+
+def build(events, die_us):
+    """Build (start, end, phase) intervals and meal times per philosopher."""
+    intervals = defaultdict(list)
+    meals = defaultdict(list)
+    open_phase = {}
+    wait_start = {}
+    first_ts = None
+    for ts, probe, pid, arg in events:
+        if first_ts is None:
+            first_ts = ts
+        if probe == "monitor_scan":
+            continue
+        if probe == "fork_request" and pid not in wait_start:
+            wait_start[pid] = ts
+        elif probe == "fork_acquire" and pid in wait_start:
+            # The wait ends with the second fork; eat_start follows at once.
+            pass
+        elif probe in PHASE_START:
+            if probe == "eat_start":
+                if pid in wait_start:
+                    intervals[pid].append((wait_start.pop(pid), ts,
+                                           "wait_fork"))
+                meals[pid].append(ts)
+            open_phase[pid] = (ts, PHASE_START[probe])
+        elif probe in PHASE_END and pid in open_phase:
+            start, phase = open_phase.pop(pid)
+            intervals[pid].append((start, ts, phase))
+    return intervals, meals, first_ts or 0.0
+
+
+def last_meal_before(meal_times, ts, origin):
+    last = origin
+    for meal in meal_times:
+        if meal > ts:
+            break
+        last = meal
+    return last
+
+
+def folded(intervals, meals, die_us, origin, out):
+    weights = defaultdict(float)
+    for pid, spans in intervals.items():
+        for start, end, phase in spans:
+            stack = "philo_%d;%s" % (pid, phase)
+            if phase == "wait_fork":
+                last = last_meal_before(meals[pid], start, origin)
+                stack += ";" + hunger_bucket((end - last) / die_us)
+            weights[stack] += end - start
+    for stack in sorted(weights):
+        out.write("%s %d\n" % (stack, weights[stack]))
+
+
+def summary(intervals, meals, die_us, origin, out):
+    out.write("%6s %6s %12s %14s %12s\n" % ("philo", "meals", "max_wait_ms",
+                                            "max_gap_ms", "min_slack_ms"))
+    for pid in sorted(intervals):
+        waits = [e - s for s, e, p in intervals[pid] if p == "wait_fork"]
+        times = [origin] + meals[pid]
+        gaps = [b - a for a, b in zip(times, times[1:])] or [0.0]
+        out.write("%6d %6d %12.3f %14.3f %12.3f\n" % (
+            pid, len(meals[pid]), max(waits or [0.0]) / 1000,
+            max(gaps) / 1000, (die_us - max(gaps)) / 1000))
+
+
+def svg(intervals, meals, die_us, origin, path):
+    if not intervals:
+        return
+    end_ts = max(e for spans in intervals.values() for _, e, _ in spans)
+    width, row = 1200.0, 14
+    scale = (width - 80) / max(end_ts - origin, 1.0)
+    pids = sorted(intervals)
+    with open(path, "w") as f:
+        f.write('<svg xmlns="http://www.w3.org/2000/svg" width="%d" '
+                'height="%d" font-family="monospace" font-size="10">\n'
+                % (width, row * (len(pids) + 1)))
+        for y, pid in enumerate(pids):
+            top = y * row
+            f.write('<text x="2" y="%d">philo %d</text>\n' % (top + 10, pid))
+            for start, end, phase in intervals[pid]:
+                f.write('<rect x="%.1f" y="%d" width="%.1f" height="%d" '
+                        'fill="%s"><title>%s %.3f ms</title></rect>\n' % (
+                            80 + (start - origin) * scale, top + 1,
+                            max((end - start) * scale, 0.5), row - 2,
+                            COLORS[phase], phase, (end - start) / 1000))
+            times = [origin] + meals[pid]
+            for a, b in zip(times, times[1:]):
+                if b - a > die_us:
+                    f.write('<rect x="%.1f" y="%d" width="2" height="%d" '
+                            'fill="red"><title>meal %.3f ms late</title>'
+                            '</rect>\n' % (80 + (b - origin) * scale, top,
+                                           row, (b - a - die_us) / 1000))
+        f.write("</svg>\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--die", type=float, required=True,
+                        help="time_to_die in ms (as passed to philo)")
+    parser.add_argument("--svg", help="also write a timeline chart here")
+    parser.add_argument("trace", nargs="?", help="perf script output "
+                        "(default: stdin)")
+    args = parser.parse_args()
+    die_us = args.die * 1000
+    stream = open(args.trace) if args.trace else sys.stdin
+    intervals, meals, origin = build(parse(stream), die_us)
+    folded(intervals, meals, die_us, origin, sys.stdout)
+    summary(intervals, meals, die_us, origin, sys.stderr)
+    if args.svg:
+        svg(intervals, meals, die_us, origin, args.svg)
+
+
+if __name__ == "__main__":
+    main()